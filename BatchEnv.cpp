@@ -0,0 +1,231 @@
+#include "BatchEnv.h"
+#include "Pieces.h"
+#include "TetrisEnv.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+using namespace std;
+
+static_assert(TETRIS_ENV_ROWS == NUM_ROWS && TETRIS_ENV_COLS == NUM_COLS, "TetrisEnv.h is out of date");
+static_assert(TETRIS_ACTION_NONE == ENV_ACTION_NONE, "TetrisEnv.h is out of date");
+
+//----------------------------------------------------------------------------
+
+BatchEnv::BatchEnv(int count, unsigned int seed) : _count(count > 0 ? count : 1), _seed(seed ? seed : 1) {
+    // one block, every array starting on its own cache line
+    size_t size = 0;
+    auto take = [&size](size_t bytes){
+        size_t at = size;
+        size += (bytes + 63) & ~(size_t)63;
+        return at;
+    };
+    size_t n = _count;
+    size_t rows = take(n * NUM_ROWS * sizeof(unsigned short));
+    size_t obs = take(n * NUM_ROWS * sizeof(unsigned short));
+    size_t reward = take(n * sizeof(float));
+    size_t done = take(n);
+    size_t x = take(n), y = take(n), shape = take(n), orient = take(n);
+    size_t down = take(n), counter = take(n), fall = take(n);
+    size_t rng = take(n * sizeof(unsigned int));
+    size_t lines = take(n * sizeof(int)), placed = take(n * sizeof(int));
+
+    void* p = nullptr;
+    if(posix_memalign(&p, 64, size) != 0) throw bad_alloc();
+    _arena = (unsigned char*)p;
+    memset(_arena, 0, size);
+
+    _rows = (unsigned short*)(_arena + rows);
+    _obs = (unsigned short*)(_arena + obs);
+    _reward = (float*)(_arena + reward);
+    _done = _arena + done;
+    _x = (signed char*)(_arena + x);
+    _y = (signed char*)(_arena + y);
+    _shape = _arena + shape;
+    _orient = _arena + orient;
+    _downPressed = _arena + down;
+    _updateCounter = _arena + counter;
+    _fall = _arena + fall;
+    _rng = (unsigned int*)(_arena + rng);
+    _lines = (int*)(_arena + lines);
+    _pieces = (int*)(_arena + placed);
+
+    pieceTable();
+    reset();
+}
+
+BatchEnv::~BatchEnv() {
+    free(_arena);
+}
+
+// xorshift32, the Game's generator
+unsigned int BatchEnv::nextRandom(int k) {
+    unsigned int r = _rng[k];
+    r ^= r << 13;
+    r ^= r >> 17;
+    r ^= r << 5;
+    return _rng[k] = r;
+}
+
+void BatchEnv::reset(const unsigned int* seeds) {
+    for(int k=0; k<_count; k++){
+        unsigned int seed;
+        if(seeds) seed = seeds[k];
+        else {
+            _seed ^= _seed << 13;
+            _seed ^= _seed >> 17;
+            _seed ^= _seed << 5;
+            seed = _seed;
+        }
+        resetGame(k, seed);
+        _reward[k] = 0;
+        _done[k] = 0;
+        observe(k);
+    }
+}
+
+void BatchEnv::resetGame(int k, unsigned int seed) {
+    memset(_rows + k * NUM_ROWS, 0, NUM_ROWS * sizeof(unsigned short));
+    _rng[k] = seed ? seed : 1;
+    _downPressed[k] = 0;
+    _updateCounter[k] = 0;
+    _lines[k] = 0;
+    _pieces[k] = 0;
+    spawn(k);
+}
+
+void BatchEnv::spawn(int k) {
+    _shape[k] = nextRandom(k) % NUM_SHAPES;
+    nextRandom(k);      // the colour
+    _orient[k] = 0;
+    _x[k] = SPAWN_X;
+    _y[k] = SPAWN_Y;
+}
+
+bool BatchEnv::collides(int k, int shape, int orient, int x, int y) const {
+    return pieceTable().collides(_rows + k * NUM_ROWS, shape, orient, x, y);
+}
+
+void BatchEnv::observe(int k) {
+    const PieceTable& t = pieceTable();
+    unsigned short* obs = _obs + k * NUM_ROWS;
+    memcpy(obs, _rows + k * NUM_ROWS, NUM_ROWS * sizeof(unsigned short));
+    for(int c=0; c<PIECE_CELLS; c++){
+        int cx = _x[k] + t.dx[_shape[k]][_orient[k]][c];
+        int cy = _y[k] + t.dy[_shape[k]][_orient[k]][c];
+        if(cy >= 0 && cy < NUM_ROWS) obs[cy] |= 1 << cx;
+    }
+}
+
+void BatchEnv::step(const int* actions) {
+    const PieceTable& t = pieceTable();
+
+    // key presses, as Game::input
+    for(int k=0; k<_count; k++){
+        int s = _shape[k], o = _orient[k], x = _x[k], y = _y[k];
+        switch(actions[k]){
+            case INPUT_LEFT:
+                if(!collides(k, s, o, x - 1, y)) _x[k] = x - 1;
+                break;
+            case INPUT_RIGHT:
+                if(!collides(k, s, o, x + 1, y)) _x[k] = x + 1;
+                break;
+            case INPUT_ROTATE:
+                if(t.rotate(_rows + k * NUM_ROWS, s, o, x, y)){
+                    _orient[k] = o;
+                    _x[k] = x;
+                    _y[k] = y;
+                }
+                break;
+            case INPUT_DOWN_PRESS:
+                _downPressed[k] = 1;
+                break;
+            case INPUT_DOWN_RELEASE:
+                _downPressed[k] = 0;
+                break;
+            default:
+                break;
+        }
+    }
+
+    // gravity timing, as Game::tick; no branches, so this one vectorizes
+    for(int k=0; k<_count; k++){
+        unsigned char next = _updateCounter[k] + 1;
+        unsigned char fall = _downPressed[k] | (next > REGULAR_GRAVITY_FACTOR);
+        _updateCounter[k] = fall ? 0 : next;
+        _fall[k] = fall;
+        _reward[k] = 0;
+        _done[k] = 0;
+    }
+
+    // falling pieces move down or lock, as Game::gravity and setNewCurr
+    for(int k=0; k<_count; k++){
+        if(!_fall[k]) continue;
+        int s = _shape[k], o = _orient[k], x = _x[k], y = _y[k];
+        if(!collides(k, s, o, x, y - 1)){
+            _y[k] = y - 1;
+            continue;
+        }
+
+        _pieces[k]++;
+        int cleared = t.lock(_rows + k * NUM_ROWS, s, o, x, y);
+        _lines[k] += cleared;
+        _reward[k] = cleared;
+
+        spawn(k);
+        _done[k] = collides(k, _shape[k], _orient[k], _x[k], _y[k]);
+    }
+
+    // finished games start over at once, from the seed a restart would use
+    for(int k=0; k<_count; k++){
+        if(_done[k]) resetGame(k, nextRandom(k));
+        observe(k);
+    }
+}
+
+//----------------------------------------------------------------------------
+
+struct TetrisEnv : public BatchEnv {
+    TetrisEnv(int count, unsigned int seed) : BatchEnv(count, seed) {}
+};
+
+extern "C" {
+
+TetrisEnv* tetris_env_create(int count, unsigned int seed) {
+    try {
+        return new TetrisEnv(count, seed);
+    } catch(...) {
+        return nullptr;
+    }
+}
+
+void tetris_env_destroy(TetrisEnv* env) {
+    delete env;
+}
+
+int tetris_env_count(const TetrisEnv* env) {
+    return env->count();
+}
+
+void tetris_env_reset(TetrisEnv* env, const unsigned int* seeds) {
+    env->reset(seeds);
+}
+
+void tetris_env_step(TetrisEnv* env, const int* actions) {
+    env->step(actions);
+}
+
+const unsigned short* tetris_env_observations(const TetrisEnv* env) {
+    return env->observations();
+}
+
+const float* tetris_env_rewards(const TetrisEnv* env) {
+    return env->rewards();
+}
+
+const unsigned char* tetris_env_dones(const TetrisEnv* env) {
+    return env->dones();
+}
+
+}
@@ -0,0 +1,91 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- BatchEnv.h ---
+//
+//   K games stepped together for reinforcement learning. Every field of
+//   every game lives in one arena, one array per field (board rows,
+//   piece x, piece y, ...), and step() works through the batch a phase
+//   at a time, so each loop touches a few contiguous arrays and the
+//   branch-free phases vectorize. Rows are bitboards, bit c for column c.
+//
+//   The rules are the Game's: one step is one key press (or none) and one
+//   UPDATE_INTERVAL tick, and from the same seed and actions a BatchEnv
+//   game and a Game stay cell for cell identical. Colours are not
+//   tracked, but their draws from the generator still happen so the
+//   piece sequence matches. A game that ends is reset right away; its
+//   done flag is set for that step and its observation is already the
+//   new game.
+//
+//   TetrisEnv.h wraps this in a plain C ABI.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __BATCHENV_H__
+#define __BATCHENV_H__
+
+#include "Game.h"
+
+// any action outside INPUT_LEFT..INPUT_DOWN_RELEASE means no key press
+const int ENV_ACTION_NONE = INPUT_RESTART;
+
+class BatchEnv {
+public:
+    explicit BatchEnv(int count, unsigned int seed = 1);
+    ~BatchEnv();
+    BatchEnv(const BatchEnv&) = delete;
+    BatchEnv& operator=(const BatchEnv&) = delete;
+
+    int count() const { return _count; }
+
+    // Starts every game over, from seeds[k] or, without seeds, from
+    // seeds drawn from the batch's own generator.
+    void reset(const unsigned int* seeds = nullptr);
+    void step(const int* actions);
+
+    // [count][NUM_ROWS] settled cells plus the falling piece
+    const unsigned short* observations() const { return _obs; }
+    // lines cleared by the last step
+    const float* rewards() const { return _reward; }
+    const unsigned char* dones() const { return _done; }
+
+    // settled cells only, [count][NUM_ROWS]
+    const unsigned short* rows() const { return _rows; }
+    const int* linesCleared() const { return _lines; }
+    const int* piecesPlaced() const { return _pieces; }
+
+    // the falling pieces, for bots playing the batch
+    const unsigned char* shapes() const { return _shape; }
+    const unsigned char* orients() const { return _orient; }
+    const signed char* pieceX() const { return _x; }
+    const signed char* pieceY() const { return _y; }
+    const unsigned char* downPressed() const { return _downPressed; }
+
+private:
+    void resetGame(int k, unsigned int seed);
+    void spawn(int k);
+    bool collides(int k, int shape, int orient, int x, int y) const;
+    unsigned int nextRandom(int k);
+    void observe(int k);
+
+    int _count;
+    unsigned int _seed;
+    unsigned char* _arena = nullptr;
+
+    // per game fields, each one array in _arena
+    unsigned short* _rows;
+    unsigned short* _obs;
+    float* _reward;
+    unsigned char* _done;
+    signed char* _x;
+    signed char* _y;
+    unsigned char* _shape;
+    unsigned char* _orient;
+    unsigned char* _downPressed;
+    unsigned char* _updateCounter;
+    unsigned char* _fall;
+    unsigned int* _rng;
+    int* _lines;
+    int* _pieces;
+};
+
+#endif // __BATCHENV_H__
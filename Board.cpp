@@ -0,0 +1,59 @@
+#include "Board.h"
+
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+void writeBoardText(const BoardSnapshot& snap, ostream& out) {
+    char rows[NUM_ROWS][NUM_COLS];
+    for(int i=0; i<NUM_ROWS; i++){
+        for(int j=0; j<NUM_COLS; j++){
+            rows[i][j] = snap.cells[i][j] == EMPTY_CELL ? '.' : '0' + snap.cells[i][j];
+        }
+    }
+    for(int k=0; k<snap.pieceCells; k++){
+        rows[snap.pieceY[k]][snap.pieceX[k]] = 'a' + snap.pieceColor - 1;
+    }
+    for(int i=NUM_ROWS-1; i>=0; i--){
+        out.write(rows[i], NUM_COLS);
+        out<<'\n';
+    }
+    out<<'\n';
+}
+
+bool readBoardText(istream& in, BoardSnapshot& snap) {
+    snap = BoardSnapshot();
+    string line;
+    int i = NUM_ROWS-1;
+    while(i >= 0 && getline(in, line)){
+        if(line.empty() || line[0] == '#'){
+            if(i == NUM_ROWS-1) continue;   // leading separators
+            break;
+        }
+        if((int)line.size() < NUM_COLS) return false;
+        for(int j=0; j<NUM_COLS; j++){
+            char c = line[j];
+            snap.cells[i][j] = EMPTY_CELL;
+            if(c >= '1' && c < '1' + NUM_COLORS) snap.cells[i][j] = c - '0';
+            else if(c >= 'a' && c < 'a' + NUM_COLORS && snap.pieceCells < PIECE_CELLS){
+                snap.pieceX[snap.pieceCells] = j;
+                snap.pieceY[snap.pieceCells] = i;
+                snap.pieceCells++;
+                snap.pieceColor = c - 'a' + 1;
+            }
+        }
+        i--;
+    }
+    if(i >= 0) return false;
+
+    // the ghost, as the game would have worked it out
+    for(bool free = snap.pieceCells > 0; free; ){
+        for(int k=0; k<snap.pieceCells && free; k++){
+            int y = snap.pieceY[k] - snap.ghostDrop - 1;
+            free = y >= 0 && snap.cells[y][snap.pieceX[k]] == EMPTY_CELL;
+        }
+        if(free) snap.ghostDrop++;
+    }
+    return true;
+}
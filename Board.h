@@ -0,0 +1,110 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- Board.h ---
+//
+//   Board dimensions, screen layout and palette shared by the GL game and
+//   the GL-free tools. Nothing in here may depend on a GL header.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __BOARD_H__
+#define __BOARD_H__
+
+#include <iosfwd>
+
+const int NUM_ROWS = 20;
+const int NUM_COLS = 10;
+const int WINDOWS_SIZE_SCALE=35;
+const int WINDOW_SIZE_X = WINDOWS_SIZE_SCALE * (NUM_COLS+2);
+const int WINDOW_SIZE_Y = WINDOWS_SIZE_SCALE * (NUM_ROWS+2);
+const int NUM_GRID_LINE_POINTS = 4 + 2*NUM_ROWS + 2*NUM_COLS;
+const float diffX = 2.0/(NUM_COLS+1), diffY=2.0/(NUM_ROWS+1); // this should give half a cell border
+const float cornerX = diffX*5, cornerY = diffY*10;
+
+const int NUM_COLORS = 6;
+const float PALETTE[NUM_COLORS][3] = {
+    { 1.0, 0.0, 0.0 },
+    { 0.0, 1.0, 0.0 },
+    { 0.0, 0.0, 1.0 },
+    { 1.0, 1.0, 0.0 },
+    { 0.0, 1.0, 1.0 },
+    { 1.0, 0.0, 1.0 }
+};
+const float GRID_LINE_COLOR[3] = { 0.5, 0.5, 0.5 };
+
+const int PIECE_CELLS = 4;
+const unsigned char EMPTY_CELL = 0;
+// versus mode garbage rows reuse the last palette entry
+const unsigned char GARBAGE_CELL = NUM_COLORS;
+
+// Everything needed to draw one frame. cells[row][col] holds 0 for an empty
+// cell or palette index + 1, row 0 being the bottom of the board.
+struct BoardSnapshot {
+    unsigned char cells[NUM_ROWS][NUM_COLS] = {};
+    int pieceCells = 0;
+    int pieceX[PIECE_CELLS], pieceY[PIECE_CELLS];
+    unsigned char pieceColor = 0;
+    // rows the piece can drop straight down; the ghost is drawn there
+    int ghostDrop = 0;
+    bool gameOver = false;
+    // changes whenever cells does, so a renderer can keep its ground geometry
+    unsigned int groundVersion = 0;
+};
+
+// Text form of a snapshot: NUM_ROWS lines of NUM_COLS characters, top row
+// first. '.' is empty, '1'..'6' a settled cell and 'a'..'f' the falling
+// piece in that colour. Boards in one stream are separated by a blank line.
+void writeBoardText(const BoardSnapshot& snap, std::ostream& out);
+bool readBoardText(std::istream& in, BoardSnapshot& snap);
+
+// The end points of the GL_LINES grid, in the order init_grid_lines uploads
+// them. Accumulates the offsets the same way so tools get identical floats.
+inline void gridLinePoints(float grid[NUM_GRID_LINE_POINTS][2]) {
+    grid[0][0] = -cornerX; grid[0][1] = 0;
+    grid[1][0] = cornerX;  grid[1][1] = 0;
+    grid[2][0] = 0;        grid[2][1] = -cornerY;
+    grid[3][0] = 0;        grid[3][1] = cornerY;
+
+    float temp = 0.0;
+    for(int i=4; i<4 + 2*NUM_COLS; i+=4){
+        temp += diffX;
+        grid[i][0] = temp;    grid[i][1] = -cornerY;
+        grid[i+1][0] = temp;  grid[i+1][1] = cornerY;
+        grid[i+2][0] = -temp; grid[i+2][1] = -cornerY;
+        grid[i+3][0] = -temp; grid[i+3][1] = cornerY;
+    }
+    temp = 0.0;
+    for(int i=4 + 2*NUM_COLS; i<NUM_GRID_LINE_POINTS; i+=4){
+        temp += diffY;
+        grid[i][0] = -cornerX;   grid[i][1] = temp;
+        grid[i+1][0] = cornerX;  grid[i+1][1] = temp;
+        grid[i+2][0] = -cornerX; grid[i+2][1] = -temp;
+        grid[i+3][0] = cornerX;  grid[i+3][1] = -temp;
+    }
+}
+
+// The ghost piece's outline: GL_LINES end points of a square inset in
+// each cell the falling piece would land on, clear of the grid lines.
+// Returns the number of points, none when the piece is already down.
+const int NUM_GHOST_POINTS = 8 * PIECE_CELLS;
+const float GHOST_INSET = 0.2f;
+inline int ghostLinePoints(const BoardSnapshot& snap, float points[NUM_GHOST_POINTS][2]) {
+    if(snap.ghostDrop <= 0 || snap.gameOver) return 0;
+    int n = 0;
+    for(int k=0; k<snap.pieceCells; k++){
+        float x0 = snap.pieceX[k] * diffX - cornerX + diffX * GHOST_INSET;
+        float y0 = (snap.pieceY[k] - snap.ghostDrop) * diffY - cornerY + diffY * GHOST_INSET;
+        float x1 = x0 + diffX * (1 - 2 * GHOST_INSET);
+        float y1 = y0 + diffY * (1 - 2 * GHOST_INSET);
+        const float corners[8][2] = { {x0, y0}, {x1, y0}, {x1, y0}, {x1, y1},
+                                      {x1, y1}, {x0, y1}, {x0, y1}, {x0, y0} };
+        for(const auto& c: corners){
+            points[n][0] = c[0];
+            points[n][1] = c[1];
+            n++;
+        }
+    }
+    return n;
+}
+
+#endif // __BOARD_H__
@@ -0,0 +1,194 @@
+#include "Bot.h"
+#include "BatchEnv.h"
+#include "Features.h"
+#include "OpeningBook.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+// below any board score, so a placement that tops out is only chosen when
+// every one does
+const float LOSS_SCORE = -1e9f;
+
+float scoreBoard(const unsigned short* rows, int lines, const BotWeights& w) {
+    BoardFeatureSet f;
+    boardFeatureSet(rows, f);
+    return w.height * f.aggregateHeight + w.lines * lines + w.holes * f.holes + w.bumpiness * f.bumpiness;
+}
+
+//----------------------------------------------------------------------------
+
+Bot::Bot(int threads, const BotWeights& weights) : _weights(weights), _pool(threads < 1 ? 1 : threads) {
+    for(int i=0; i<_pool.size(); i++) _workers.push_back(new Worker());
+}
+
+Bot::~Bot() {
+    for(Worker* w: _workers) delete w;
+}
+
+// scores first placements until there are none left to take
+void Bot::search(Worker& w) {
+    const PieceTable& t = pieceTable();
+    for(int i=_nextJob++; i<_count; i=_nextJob++){
+        const Placement& p = _first[i];
+        BoardRows after;
+        memcpy(after, _rows, sizeof(after));
+        int lines = t.lock(after, _shape, p.orient, p.x, p.y);
+        if(_next < 0){
+            _scores[i] = scoreBoard(after, lines, _weights);
+            continue;
+        }
+
+        int n = w.finder.find(after, _next, w.out);
+        float best = LOSS_SCORE + scoreBoard(after, lines, _weights);
+        for(int j=0; j<n; j++){
+            BoardRows then;
+            memcpy(then, after, sizeof(then));
+            int more = t.lock(then, _next, w.out[j].orient, w.out[j].x, w.out[j].y);
+            float score = scoreBoard(then, lines + more, _weights);
+            if(j == 0 || score > best) best = score;
+        }
+        _scores[i] = best;
+    }
+}
+
+bool Bot::choose(const unsigned short* rows, int shape, int orient, int x, int y, int next, Placement& best) {
+    _count = _finder.find(rows, shape, orient, x, y, _first);
+    if(_count == 0) return false;
+    Placement book;
+    if(_book && next >= 0 && _book->lookup(rows, shape, next, book)){
+        for(int i=0; i<_count; i++){
+            if(_first[i].x == book.x && _first[i].y == book.y && _first[i].orient == book.orient){
+                // a replan of the same piece comes back to the same position
+                unsigned long long key = bookKey(rows, shape, next);
+                if(key != _lastBookKey) _bookMoves++;
+                _lastBookKey = key;
+                best = book;
+                return true;
+            }
+        }
+    }
+    _rows = rows;
+    _shape = shape;
+    _next = next;
+    _nextJob = 0;
+
+    // a single placement needs no search
+    if(_count > 1) _pool.run([this](int t){ search(*_workers[t]); });
+
+    int pick = 0;
+    for(int i=1; i<_count; i++){
+        if(_scores[i] > _scores[pick]) pick = i;
+    }
+    best = _first[pick];
+    return true;
+}
+
+bool Bot::choose(const Game& game, Placement& best) {
+    int shape, orient, x, y;
+    if(game.isOver() || !pieceTable().locate(game.current(), shape, orient, x, y)) return false;
+    BoardRows rows;
+    rowsFromCells(game.cells(), rows);
+    return choose(rows, shape, orient, x, y, _lookahead ? game.nextShape() : -1, best);
+}
+
+//----------------------------------------------------------------------------
+
+// The key press that takes the piece at (shape, orient, x, y) on towards
+// target, false when this tick needs none. When gravity has taken the
+// piece past a tuck, replan() chooses target again from here; false from
+// it gives up.
+template<class Replan>
+static bool steer(PlacementFinder& finder, Placement* out, Placement_move* moves,
+                  const unsigned short* rows, int shape, int orient, int x, int y,
+                  bool downPressed, const Placement& target, Replan replan, Input& in) {
+    finder.find(rows, shape, orient, x, y, out);
+    int len = finder.path(target, moves, MAX_PLACEMENTS);
+    if(len < 0){
+        if(!replan()) return false;
+        finder.find(rows, shape, orient, x, y, out);
+        len = finder.path(target, moves, MAX_PLACEMENTS);
+        if(len < 0) return false;
+    }
+
+    // hold down through falls, let go for anything else
+    bool fall = len == 0 || moves[0] == MOVE_DOWN;
+    if(fall != downPressed){
+        in = fall ? INPUT_DOWN_PRESS : INPUT_DOWN_RELEASE;
+        return true;
+    }
+    if(fall) return false;
+    in = moves[0] == MOVE_LEFT ? INPUT_LEFT : moves[0] == MOVE_RIGHT ? INPUT_RIGHT : INPUT_ROTATE;
+    return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool Autopilot::plan(const Game& game) {
+    auto start = chrono::steady_clock::now();
+    _planned = _bot.choose(game, _target);
+    _plannedGround = game.groundVersion();
+    double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+    _searchMicros += micros;
+    _maxSearchMicros = max(_maxSearchMicros, micros);
+    _searches++;
+    return _planned;
+}
+
+bool Autopilot::step(const Game& game, Input& in) {
+    if(game.isOver()){
+        _planned = false;
+        return false;
+    }
+    // a new piece, a new game or a jump back in time
+    if(!_planned || game.groundVersion() != _plannedGround){
+        if(!plan(game)) return false;
+    }
+
+    int shape, orient, x, y;
+    if(!pieceTable().locate(game.current(), shape, orient, x, y)) return false;
+    BoardRows rows;
+    rowsFromCells(game.cells(), rows);
+    return steer(_finder, _out, _moves, rows, shape, orient, x, y, game.downPressed(), _target,
+                 [&]{ return plan(game); }, in);
+}
+
+bool Autopilot::release(const Game& game, Input& in) {
+    _planned = false;
+    if(!game.downPressed()) return false;
+    in = INPUT_DOWN_RELEASE;
+    return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool BatchPilot::plan(const BatchEnv& env, int k) {
+    const unsigned short* rows = env.rows() + k * NUM_ROWS;
+    _plannedPiece[k] = -1;
+    if(!_bot.choose(rows, env.shapes()[k], env.orients()[k], env.pieceX()[k], env.pieceY()[k], -1, _targets[k])) return false;
+    _plannedPiece[k] = env.piecesPlaced()[k];
+    return true;
+}
+
+void BatchPilot::actions(const BatchEnv& env, int* actions) {
+    if((int)_targets.size() != env.count()){
+        _targets.assign(env.count(), Placement());
+        _plannedPiece.assign(env.count(), -1);
+    }
+    for(int k=0; k<env.count(); k++){
+        actions[k] = ENV_ACTION_NONE;
+        const unsigned short* rows = env.rows() + k * NUM_ROWS;
+        int shape = env.shapes()[k], orient = env.orients()[k], x = env.pieceX()[k], y = env.pieceY()[k];
+        // a new piece, or a new game after one that ended on the same count
+        if(env.dones()[k] || _plannedPiece[k] != env.piecesPlaced()[k]){
+            if(!plan(env, k)) continue;
+        }
+
+        Input in;
+        if(steer(_finder, _out, _moves, rows, shape, orient, x, y, env.downPressed()[k] != 0, _targets[k],
+                 [&]{ return plan(env, k); }, in)) actions[k] = in;
+    }
+}
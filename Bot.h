@@ -0,0 +1,155 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- Bot.h ---
+//
+//   A heuristic player. The Bot scores every placement of the current
+//   piece by the best board it leaves after also placing the previewed
+//   next piece, judged on aggregate height, holes, bumpiness and lines
+//   cleared. The first placements are shared out over a small pool of
+//   threads that sleep between searches; a 2-ply search takes well under
+//   a millisecond, against a 50 ms tick.
+//
+//   The Autopilot turns the Bot's choices into one key press per tick, so
+//   it plays a Game the way a player at the keyboard would, and recorded
+//   games replay like any other. The BatchPilot does the same for every
+//   game of a BatchEnv at once.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __BOT_H__
+#define __BOT_H__
+
+#include "JobPool.h"
+#include "Placement.h"
+
+#include <atomic>
+#include <vector>
+
+class BatchEnv;
+class OpeningBook;
+
+// per unit of each feature; the defaults are a well known hand tuned set
+struct BotWeights {
+    float height = -0.510066f;
+    float lines = 0.760666f;
+    float holes = -0.35663f;
+    float bumpiness = -0.184483f;
+};
+
+// the weighted features of Features.h, plus the lines just cleared
+float scoreBoard(const unsigned short* rows, int lines, const BotWeights& w);
+
+class Bot {
+public:
+    // threads counts the caller, which always takes part in the search
+    explicit Bot(int threads = 1, const BotWeights& weights = BotWeights());
+    ~Bot();
+    Bot(const Bot&) = delete;
+    Bot& operator=(const Bot&) = delete;
+
+    const BotWeights& weights() const { return _weights; }
+    void setWeights(const BotWeights& weights) { _weights = weights; }
+    int threads() const { return _pool.size(); }
+    // whether choose(game) looks at the preview; on by default
+    void setLookahead(bool on) { _lookahead = on; }
+    // Placements in the book are played without a search. The book must
+    // outlive the Bot; nullptr to stop using it.
+    void setBook(const OpeningBook* book) { _book = book; }
+    // pieces placed from the book, each counted once however often it's
+    // chosen again
+    long long bookMoves() const { return _bookMoves; }
+
+    // Best placement of shape from (orient, x, y), looking ahead to next,
+    // or only one piece deep when next is -1. False when the piece has
+    // nowhere to go. Ties go to the first placement found, so the choice
+    // doesn't depend on the number of threads. A book placement needs
+    // next, and wins when the piece can reach it.
+    bool choose(const unsigned short* rows, int shape, int orient, int x, int y, int next, Placement& best);
+    // for a Game's falling piece, from where it is now, with its preview
+    bool choose(const Game& game, Placement& best);
+
+private:
+    struct Worker {
+        PlacementFinder finder;
+        Placement out[MAX_PLACEMENTS];
+    };
+
+    void search(Worker& w);
+
+    BotWeights _weights;
+    bool _lookahead = true;
+    const OpeningBook* _book = nullptr;
+    long long _bookMoves = 0;
+    unsigned long long _lastBookKey = 0;
+    JobPool _pool;
+    std::vector<Worker*> _workers;
+
+    // the search in progress
+    PlacementFinder _finder;
+    Placement _first[MAX_PLACEMENTS];
+    float _scores[MAX_PLACEMENTS];
+    int _count = 0;
+    const unsigned short* _rows = nullptr;
+    int _shape = 0, _next = -1;
+    std::atomic<int> _nextJob{0};
+};
+
+class Autopilot {
+public:
+    explicit Autopilot(int threads = 1, const BotWeights& weights = BotWeights()) : _bot(threads, weights) {}
+
+    Bot& bot() { return _bot; }
+
+    // The key press that takes the falling piece on towards the placement
+    // the Bot chose for it, false when this tick needs none. Call once per
+    // tick.
+    bool step(const Game& game, Input& in);
+    // Lets go of the down key if it is held, before handing the game back
+    // to a player.
+    bool release(const Game& game, Input& in);
+
+    // microseconds spent choosing placements, in all and at most
+    double searchMicros() const { return _searchMicros; }
+    double maxSearchMicros() const { return _maxSearchMicros; }
+    long long searches() const { return _searches; }
+
+private:
+    bool plan(const Game& game);
+
+    Bot _bot;
+    PlacementFinder _finder;
+    Placement _out[MAX_PLACEMENTS];
+    Placement_move _moves[MAX_PLACEMENTS];
+
+    Placement _target;
+    bool _planned = false;
+    unsigned int _plannedGround = 0;
+    double _searchMicros = 0;
+    double _maxSearchMicros = 0;
+    long long _searches = 0;
+};
+
+// The Autopilot's key presses for all the games of a BatchEnv, with one
+// Bot choosing for every game in turn. The batch has no preview, so the
+// search is one piece deep.
+class BatchPilot {
+public:
+    explicit BatchPilot(const BotWeights& weights = BotWeights()) : _bot(1, weights) {}
+
+    // actions[k] for the next env.step(), for every game
+    void actions(const BatchEnv& env, int* actions);
+
+private:
+    bool plan(const BatchEnv& env, int k);
+
+    Bot _bot;
+    PlacementFinder _finder;
+    Placement _out[MAX_PLACEMENTS];
+    Placement_move _moves[MAX_PLACEMENTS];
+
+    // per game: the placement and the piece it was chosen for, -1 for none
+    std::vector<Placement> _targets;
+    std::vector<int> _plannedPiece;
+};
+
+#endif // __BOT_H__
@@ -0,0 +1,68 @@
+#include "Controller.h"
+#include "Bot.h"
+
+#include <cstdio>
+
+using namespace std;
+
+class AutopilotController : public Controller {
+public:
+    AutopilotController(const BotWeights& weights, bool lookahead) : _pilot(1, weights) {
+        _pilot.bot().setLookahead(lookahead);
+    }
+    bool step(const Game& game, Input& in) override { return _pilot.step(game, in); }
+
+private:
+    Autopilot _pilot;
+};
+
+// presses one of the moves at random, on percent of the ticks
+class RandomController : public Controller {
+public:
+    RandomController(int percent, unsigned int seed) : _percent(percent), _rng(seed ? seed : 1) {}
+    bool step(const Game&, Input& in) override {
+        if((int)(random() % 100) >= _percent) return false;
+        const Input moves[] = { INPUT_LEFT, INPUT_RIGHT, INPUT_ROTATE, INPUT_HARD_DROP };
+        in = moves[random() % 4];
+        return true;
+    }
+
+private:
+    unsigned int random() {
+        _rng ^= _rng << 13;
+        _rng ^= _rng >> 17;
+        _rng ^= _rng << 5;
+        return _rng;
+    }
+
+    int _percent;
+    unsigned int _rng;
+};
+
+// lets gravity do everything
+class IdleController : public Controller {
+public:
+    bool step(const Game&, Input&) override { return false; }
+};
+
+unique_ptr<Controller> makeController(const string& spec, unsigned int seed, string& error) {
+    error.clear();
+    if(spec == "bot") return unique_ptr<Controller>(new AutopilotController(BotWeights(), true));
+    if(spec == "bot-1ply") return unique_ptr<Controller>(new AutopilotController(BotWeights(), false));
+    if(spec.compare(0, 4, "bot:") == 0){
+        BotWeights w;
+        if(sscanf(spec.c_str() + 4, "%f,%f,%f,%f", &w.height, &w.lines, &w.holes, &w.bumpiness) == 4){
+            return unique_ptr<Controller>(new AutopilotController(w, true));
+        }
+    }
+    else if(spec == "random") return unique_ptr<Controller>(new RandomController(20, seed));
+    else if(spec.compare(0, 7, "random:") == 0){
+        int percent;
+        if(sscanf(spec.c_str() + 7, "%d", &percent) == 1 && percent >= 0 && percent <= 100){
+            return unique_ptr<Controller>(new RandomController(percent, seed));
+        }
+    }
+    else if(spec == "idle") return unique_ptr<Controller>(new IdleController());
+    error = "unknown controller " + spec + ", expected one of " + CONTROLLER_SPECS;
+    return nullptr;
+}
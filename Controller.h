@@ -0,0 +1,37 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- Controller.h ---
+//
+//   Anything that plays a Game one key press per tick, the way a player at
+//   the keyboard would: the Bot's Autopilot, random mashing, or a new
+//   strategy under test. Tools that pit players against each other build
+//   them from a short text spec, so adding a strategy means one class and
+//   one line in makeController().
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __CONTROLLER_H__
+#define __CONTROLLER_H__
+
+#include "Game.h"
+
+#include <memory>
+#include <string>
+
+class Controller {
+public:
+    virtual ~Controller() {}
+    // The key press for this tick, false for none. Called once per tick,
+    // before the tick.
+    virtual bool step(const Game& game, Input& in) = 0;
+};
+
+// the specs makeController() knows, for usage messages
+const char CONTROLLER_SPECS[] =
+    "bot, bot-1ply, bot:h,l,o,b (weights for height, lines, holes, bumpiness), random[:percent], idle";
+
+// A new controller for spec, or nullptr with error set. seed is for
+// controllers that draw random numbers; the others ignore it.
+std::unique_ptr<Controller> makeController(const std::string& spec, unsigned int seed, std::string& error);
+
+#endif // __CONTROLLER_H__
@@ -0,0 +1,211 @@
+#include "Expectimax.h"
+
+#include <cstring>
+
+using namespace std;
+
+// the worth of a shape that has nowhere to go, far below any board
+const float TOP_OUT = -10000.0f;
+
+// splitmix64, so the keys are the same in every build
+static unsigned long long splitmix(unsigned long long& state) {
+    unsigned long long z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+struct ZobristKeys {
+    unsigned long long cell[NUM_ROWS][NUM_COLS];
+    unsigned long long depth[EXPECTIMAX_MAX_DEPTH + 1];
+
+    ZobristKeys(){
+        unsigned long long state = 0x5445545249535a4bull;
+        for(auto& row: cell){
+            for(auto& key: row) key = splitmix(state);
+        }
+        for(auto& key: depth) key = splitmix(state);
+    }
+};
+
+static const ZobristKeys& keys() {
+    static ZobristKeys k;
+    return k;
+}
+
+unsigned long long zobristKey(int row, int col) {
+    return keys().cell[row][col];
+}
+
+unsigned long long zobristHash(const unsigned short* rows) {
+    const ZobristKeys& k = keys();
+    unsigned long long hash = 0;
+    for(int r=0; r<NUM_ROWS; r++){
+        for(unsigned int bits = rows[r]; bits; bits &= bits - 1) hash ^= k.cell[r][__builtin_ctz(bits)];
+    }
+    return hash;
+}
+
+//----------------------------------------------------------------------------
+
+TranspositionTable::TranspositionTable(size_t megabytes) {
+    size_t n = 1;
+    while(n * 2 * sizeof(Entry) <= (megabytes << 20)) n *= 2;
+    _entries = new Entry[n];
+    _mask = n - 1;
+    clear();
+}
+
+TranspositionTable::~TranspositionTable() {
+    delete[] _entries;
+}
+
+void TranspositionTable::clear() {
+    for(size_t i=0; i<=_mask; i++){
+        _entries[i].check.store(0, memory_order_relaxed);
+        _entries[i].data.store(0, memory_order_relaxed);
+    }
+}
+
+// the depth goes into the key, so each depth of a board has its own slot
+bool TranspositionTable::probe(unsigned long long hash, int depth, float& value) const {
+    hash ^= keys().depth[depth];
+    const Entry& e = _entries[hash & _mask];
+    unsigned long long data = e.data.load(memory_order_relaxed);
+    unsigned long long check = e.check.load(memory_order_relaxed);
+    if((check ^ data) != hash || (int)(data >> 32) != depth) return false;
+    unsigned int bits = (unsigned int)data;
+    memcpy(&value, &bits, sizeof(value));
+    return true;
+}
+
+void TranspositionTable::store(unsigned long long hash, int depth, float value) {
+    hash ^= keys().depth[depth];
+    Entry& e = _entries[hash & _mask];
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    unsigned long long data = bits | (unsigned long long)depth << 32;
+    e.data.store(data, memory_order_relaxed);
+    e.check.store(hash ^ data, memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+
+Expectimax::Expectimax(int threads, size_t ttMegabytes, const BotWeights& weights)
+    : _weights(weights), _table(ttMegabytes), _pool(threads < 1 ? 1 : threads) {
+    keys();
+    for(int i=0; i<_pool.size(); i++) _workers.push_back(new Worker());
+}
+
+Expectimax::~Expectimax() {
+    for(Worker* w: _workers) delete w;
+}
+
+// Looks at the clock every so many nodes; once one thread runs out of
+// time they all stop.
+bool Expectimax::aborted(Worker& w) {
+    if(_abort.load(memory_order_relaxed)) return true;
+    if(!_timed || ++w.sinceClock < 256) return false;
+    w.sinceClock = 0;
+    if(chrono::steady_clock::now() < _deadline) return false;
+    _abort = true;
+    return true;
+}
+
+float Expectimax::after(Worker& w, const unsigned short* rows, unsigned long long hash, int depth, int ply) {
+    if(depth == 0) return scoreBoard(rows, 0, _weights);
+    return chanceNode(w, rows, hash, depth, ply);
+}
+
+float Expectimax::maxNode(Worker& w, const unsigned short* rows, unsigned long long hash, int shape, int depth, int ply) {
+    if(aborted(w)) return 0;
+    const PieceTable& t = pieceTable();
+    Placement* out = w.out[ply];
+    int n = w.finder.find(rows, shape, out);
+    w.stats.nodes += n;
+    if(n == 0) return TOP_OUT;
+
+    float best = 0;
+    for(int i=0; i<n; i++){
+        const Placement& p = out[i];
+        BoardRows child;
+        memcpy(child, rows, sizeof(child));
+        int lines = t.lock(child, shape, p.orient, p.x, p.y);
+        unsigned long long childHash = hash;
+        if(lines) childHash = zobristHash(child);
+        else {
+            for(int k=0; k<PIECE_CELLS; k++) childHash ^= zobristKey(p.y + t.dy[shape][p.orient][k], p.x + t.dx[shape][p.orient][k]);
+        }
+        float value = _weights.lines * lines + after(w, child, childHash, depth, ply + 1);
+        if(i == 0 || value > best) best = value;
+    }
+    return best;
+}
+
+float Expectimax::chanceNode(Worker& w, const unsigned short* rows, unsigned long long hash, int depth, int ply) {
+    float value;
+    w.stats.probes++;
+    if(_table.probe(hash, depth, value)){
+        w.stats.hits++;
+        return value;
+    }
+    float sum = 0;
+    for(int s=0; s<NUM_SHAPES; s++) sum += maxNode(w, rows, hash, s, depth - 1, ply);
+    value = sum / NUM_SHAPES;
+    // a value put together after the abort may be missing pieces
+    if(!_abort.load(memory_order_relaxed)) _table.store(hash, depth, value);
+    return value;
+}
+
+bool Expectimax::search(const unsigned short* rows, int shape, int orient, int x, int y, int next,
+                        int maxDepth, double budgetMs, Result& result) {
+    auto start = chrono::steady_clock::now();
+    _count = _finder.find(rows, shape, orient, x, y, _root);
+    if(_count == 0) return false;
+    _rows = rows;
+    _shape = shape;
+    _next = next;
+    _deadline = start + chrono::microseconds((long long)(budgetMs * 1000));
+    _abort = false;
+    for(Worker* w: _workers) w->stats = ExpectimaxStats();
+    maxDepth = max(0, min(maxDepth, EXPECTIMAX_MAX_DEPTH));
+
+    auto job = [this](int thread){
+        Worker& w = *_workers[thread];
+        const PieceTable& t = pieceTable();
+        for(int i=_nextJob++; i<_count; i=_nextJob++){
+            if(aborted(w)) return;
+            const Placement& p = _root[i];
+            BoardRows child;
+            memcpy(child, _rows, sizeof(child));
+            int lines = t.lock(child, _shape, p.orient, p.x, p.y);
+            unsigned long long childHash = zobristHash(child);
+            w.stats.nodes++;
+            float rest = _next >= 0 ? maxNode(w, child, childHash, _next, _depth, 1) : after(w, child, childHash, _depth, 1);
+            _scores[i] = _weights.lines * lines + rest;
+        }
+    };
+
+    for(int d=0; d<=maxDepth; d++){
+        // the shallowest search always finishes, so there is an answer
+        _timed = d > 0 && budgetMs > 0;
+        _depth = d;
+        _nextJob = 0;
+        _pool.run(job);
+        if(_abort) break;
+
+        int pick = 0;
+        for(int i=1; i<_count; i++){
+            if(_scores[i] > _scores[pick]) pick = i;
+        }
+        result.best = _root[pick];
+        result.value = _scores[pick];
+        result.depth = d;
+        if(_timed && chrono::steady_clock::now() >= _deadline) break;
+    }
+
+    result.stats = ExpectimaxStats();
+    for(Worker* w: _workers) result.stats.add(w->stats);
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return true;
+}
@@ -0,0 +1,136 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- Expectimax.h ---
+//
+//   A deeper search than the Bot's. The Game draws every piece uniformly
+//   from the seven shapes, so a position's worth is the average, over the
+//   seven, of the best placement of that shape: chance layers alternate
+//   with max layers, down to the Bot's board heuristic at the leaves.
+//   Lines cleared on the way count as they happen, which keeps a value a
+//   function of the board alone and lets equal boards share it.
+//
+//   Chance node values go in a transposition table keyed by a Zobrist
+//   hash of the settled cells and the depth left. The table is shared by
+//   all threads without locks: an entry is two 64 bit words, the data and
+//   the key XOR the data, so a reader that catches a half written entry
+//   sees a key that doesn't match and treats it as a miss. Values are
+//   exact expectations, never bounds, so what a thread finds there is
+//   what it would have computed, and the choice doesn't depend on timing
+//   or the number of threads.
+//
+//   search() deepens one chance layer at a time and returns the deepest
+//   one that finished inside the time budget.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __EXPECTIMAX_H__
+#define __EXPECTIMAX_H__
+
+#include "Bot.h"
+#include "JobPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+const int EXPECTIMAX_MAX_DEPTH = 6;
+
+// Zobrist key of a settled cell; a board's hash is the XOR over its cells
+unsigned long long zobristKey(int row, int col);
+unsigned long long zobristHash(const unsigned short* rows);
+
+class TranspositionTable {
+public:
+    // rounded down to a power of two entries
+    explicit TranspositionTable(size_t megabytes);
+    ~TranspositionTable();
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    bool probe(unsigned long long hash, int depth, float& value) const;
+    void store(unsigned long long hash, int depth, float value);
+    void clear();
+    size_t entries() const { return _mask + 1; }
+
+private:
+    struct Entry {
+        std::atomic<unsigned long long> check;  // hash ^ data
+        std::atomic<unsigned long long> data;   // value bits, depth above them
+    };
+    Entry* _entries;
+    size_t _mask;
+};
+
+struct ExpectimaxStats {
+    long long nodes = 0;        // boards reached by a placement
+    long long probes = 0;
+    long long hits = 0;
+
+    void add(const ExpectimaxStats& other) {
+        nodes += other.nodes;
+        probes += other.probes;
+        hits += other.hits;
+    }
+};
+
+class Expectimax {
+public:
+    explicit Expectimax(int threads = 1, size_t ttMegabytes = 64, const BotWeights& weights = BotWeights());
+    ~Expectimax();
+    Expectimax(const Expectimax&) = delete;
+    Expectimax& operator=(const Expectimax&) = delete;
+
+    struct Result {
+        Placement best;
+        float value;
+        int depth;              // chance layers of the search that gave best
+        ExpectimaxStats stats;  // every iteration, the unfinished one included
+        double seconds;
+    };
+
+    // Best placement of shape from (orient, x, y). With the preview next
+    // (-1 for none) placed too, then up to maxDepth chance layers, for
+    // budgetMs milliseconds at most (0 for no limit). False when the piece
+    // has nowhere to go; otherwise depth 0 always finishes.
+    bool search(const unsigned short* rows, int shape, int orient, int x, int y, int next,
+                int maxDepth, double budgetMs, Result& result);
+
+    TranspositionTable& table() { return _table; }
+    int threads() const { return _pool.size(); }
+
+private:
+    // one max layer per chance layer, plus the preview's; the root's
+    // placements have their own array
+    static const int MAX_PLIES = EXPECTIMAX_MAX_DEPTH + 2;
+
+    struct Worker {
+        PlacementFinder finder;
+        Placement out[MAX_PLIES][MAX_PLACEMENTS];
+        ExpectimaxStats stats;
+        int sinceClock = 0;
+    };
+
+    float maxNode(Worker& w, const unsigned short* rows, unsigned long long hash, int shape, int depth, int ply);
+    float chanceNode(Worker& w, const unsigned short* rows, unsigned long long hash, int depth, int ply);
+    float after(Worker& w, const unsigned short* rows, unsigned long long hash, int depth, int ply);
+    bool aborted(Worker& w);
+
+    BotWeights _weights;
+    TranspositionTable _table;
+    JobPool _pool;
+    std::vector<Worker*> _workers;
+
+    // the iteration in progress
+    PlacementFinder _finder;
+    Placement _root[MAX_PLACEMENTS];
+    float _scores[MAX_PLACEMENTS];
+    int _count = 0;
+    int _shape = 0, _next = -1, _depth = 0;
+    const unsigned short* _rows = nullptr;
+    std::atomic<int> _nextJob{0};
+    std::atomic<bool> _abort{false};
+    std::chrono::steady_clock::time_point _deadline;
+    bool _timed = false;
+};
+
+#endif // __EXPECTIMAX_H__
@@ -0,0 +1,131 @@
+#include "ExternalControl.h"
+
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+static ControlRegion* mapRegion(int fd) {
+    void* p = mmap(nullptr, sizeof(ControlRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return p == MAP_FAILED ? nullptr : (ControlRegion*)p;
+}
+
+//----------------------------------------------------------------------------
+
+bool ControlHost::open(const char* name) {
+    close();
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if(fd < 0 || ftruncate(fd, sizeof(ControlRegion)) < 0){
+        cerr<<"Failed to create shared memory "<<name<<endl;
+        if(fd >= 0){
+            ::close(fd);
+            shm_unlink(name);
+        }
+        return false;
+    }
+    _region = mapRegion(fd);
+    if(_region == nullptr){
+        shm_unlink(name);
+        return false;
+    }
+
+    new (_region) ControlRegion();
+    strncpy(_name, name, sizeof(_name) - 1);
+    _ack = _publishedAck = 0;
+    atomic_thread_fence(memory_order_release);
+    _region->magic = CONTROL_MAGIC;
+    return true;
+}
+
+void ControlHost::close() {
+    if(_region == nullptr) return;
+    munmap(_region, sizeof(ControlRegion));
+    shm_unlink(_name);
+    _region = nullptr;
+}
+
+bool ControlHost::poll(Input& in) {
+    if(_region == nullptr) return false;
+    ControlCommand cmd;
+    while(_region->commands.pop(cmd)){
+        _ack = cmd.id;
+        // an agent can't crash the game with a bad byte
+        if(cmd.input > INPUT_HARD_DROP) continue;
+        in = Input(cmd.input);
+        return true;
+    }
+    return false;
+}
+
+void ControlHost::publish(const Game& game) {
+    if(_region == nullptr) return;
+    ControlView view;
+    view.ack = _publishedAck = _ack;
+    view.tick = game.ticks();
+    view.piecesPlaced = game.piecesPlaced();
+    view.linesCleared = game.linesCleared();
+    view.board = game.snapshot();
+
+    unsigned int seq = _region->viewSeq.load(memory_order_relaxed);
+    _region->viewSeq.store(seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy((void*)&_region->view, &view, sizeof(view));
+    _region->viewSeq.store(seq + 2, memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+
+bool ControlClient::open(const char* name) {
+    close();
+    int fd = shm_open(name, O_RDWR, 0);
+    if(fd < 0) return false;
+    _region = mapRegion(fd);
+    if(_region == nullptr) return false;
+    if(_region->magic != CONTROL_MAGIC || _region->version != CONTROL_VERSION ||
+       _region->viewSize != sizeof(ControlView)){
+        cerr<<name<<" is not a compatible control region"<<endl;
+        close();
+        return false;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    // carry on numbering after whatever an earlier agent sent
+    ControlView view;
+    read(view);
+    _nextId = view.ack + 1;
+    return true;
+}
+
+void ControlClient::close() {
+    if(_region == nullptr) return;
+    munmap(_region, sizeof(ControlRegion));
+    _region = nullptr;
+}
+
+unsigned int ControlClient::send(Input in) {
+    if(_region == nullptr) return 0;
+    ControlCommand cmd;
+    cmd.id = _nextId;
+    cmd.input = in;
+    if(!_region->commands.push(cmd)) return 0;
+    // 0 means "queue full", so skip it when the ids wrap
+    if(++_nextId == 0) _nextId = 1;
+    return cmd.id;
+}
+
+unsigned int ControlClient::read(ControlView& out) const {
+    if(_region == nullptr) return 0;
+    for(;;){
+        unsigned int before = _region->viewSeq.load(memory_order_acquire);
+        if(before & 1) continue;
+        memcpy(&out, (const void*)&_region->view, sizeof(out));
+        atomic_thread_fence(memory_order_acquire);
+        if(_region->viewSeq.load(memory_order_relaxed) == before) return before;
+    }
+}
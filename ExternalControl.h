@@ -0,0 +1,104 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- ExternalControl.h ---
+//
+//   Lets another process (an AI agent, a test harness) play the live
+//   game through POSIX shared memory. The game publishes its state into
+//   the mapping after every change, under a sequence counter so readers
+//   can tell a torn copy from a good one; the agent queues commands in an
+//   SpscQueue that lives in the same mapping. Neither side makes a system
+//   call to pass a command or a state: the game looks at the queue every
+//   time its loop wakes up, which is at least once a millisecond.
+//
+//   Every command carries an id, and the state says which id the game
+//   applied last, so an agent can wait for the effect of its own move.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __EXTERNALCONTROL_H__
+#define __EXTERNALCONTROL_H__
+
+#include "Game.h"
+#include "SpscQueue.h"
+
+#include <atomic>
+
+const char* const CONTROL_DEFAULT_NAME = "/tetris-control";
+const unsigned int CONTROL_MAGIC = 0x43545454;  // "TTTC"
+const unsigned int CONTROL_VERSION = 1;
+const int CONTROL_QUEUE = 64;
+
+struct ControlCommand {
+    unsigned int id;
+    unsigned char input;    // an Input value
+};
+
+// what the agent sees
+struct ControlView {
+    unsigned int ack = 0;           // id of the last command the game applied
+    long long tick = 0;
+    long long piecesPlaced = 0;
+    long long linesCleared = 0;
+    BoardSnapshot board;
+};
+
+struct ControlRegion {
+    unsigned int magic = 0;
+    unsigned int version = CONTROL_VERSION;
+    unsigned int viewSize = sizeof(ControlView);
+    // odd while the game is writing view
+    alignas(64) std::atomic<unsigned int> viewSeq{0};
+    ControlView view;
+    SpscQueue<ControlCommand, CONTROL_QUEUE> commands;
+};
+
+// game side
+class ControlHost {
+public:
+    ControlHost() {}
+    ~ControlHost() { close(); }
+    ControlHost(const ControlHost&) = delete;
+    ControlHost& operator=(const ControlHost&) = delete;
+
+    bool open(const char* name);
+    void close();
+
+    // Next queued command, false when there is none. Only atomics, no
+    // system call. Invalid commands are dropped but still acknowledged.
+    bool poll(Input& in);
+    void publish(const Game& game);
+    // Commands acknowledged since the last publish, so an agent waiting
+    // on a dropped one still sees its ack when nothing else changed.
+    bool ackPending() const { return _ack != _publishedAck; }
+
+private:
+    ControlRegion* _region = nullptr;
+    char _name[64] = {};
+    unsigned int _ack = 0;
+    unsigned int _publishedAck = 0;
+};
+
+// agent side
+class ControlClient {
+public:
+    ControlClient() {}
+    ~ControlClient() { close(); }
+    ControlClient(const ControlClient&) = delete;
+    ControlClient& operator=(const ControlClient&) = delete;
+
+    bool open(const char* name);
+    void close();
+
+    // Queues a command and returns its id, 0 when the queue is full.
+    unsigned int send(Input in);
+    // Copies out the latest complete view, retrying while the game is
+    // in the middle of writing it. Returns the view's sequence number,
+    // which changes whenever the game publishes.
+    unsigned int read(ControlView& out) const;
+
+private:
+    ControlRegion* _region = nullptr;
+    unsigned int _nextId = 1;
+};
+
+#endif // __EXTERNALCONTROL_H__
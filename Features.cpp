@@ -0,0 +1,212 @@
+#include "Features.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// binary digits of a height, or of a well depth
+const int DEPTH_BITS = 5;
+static_assert(NUM_ROWS < (1 << DEPTH_BITS), "heights fit in DEPTH_BITS");
+
+// a row with a filled wall either side of it, wall bits 0 and NUM_COLS + 1
+const unsigned int WALLS = 1 | 1 << (NUM_COLS + 1);
+const unsigned int ROW_PAIRS = (1 << (NUM_COLS + 1)) - 1;
+
+bool operator==(const BoardFeatureSet& a, const BoardFeatureSet& b) {
+    return memcmp(a.heights, b.heights, sizeof(a.heights)) == 0 && a.aggregateHeight == b.aggregateHeight &&
+           a.maxHeight == b.maxHeight && a.holes == b.holes && a.bumpiness == b.bumpiness && a.wells == b.wells &&
+           a.rowTransitions == b.rowTransitions && a.colTransitions == b.colTransitions;
+}
+
+// the column heights out of their bit slices, and what follows from them
+static void fromHeights(const unsigned int* height, BoardFeatureSet& f) {
+    f.aggregateHeight = f.maxHeight = f.bumpiness = 0;
+    for(int c=0; c<NUM_COLS; c++){
+        int h = 0;
+        for(int b=0; b<DEPTH_BITS; b++) h |= (height[b] >> c & 1) << b;
+        f.heights[c] = h;
+        f.aggregateHeight += h;
+        if(h > f.maxHeight) f.maxHeight = h;
+        if(c > 0) f.bumpiness += abs(h - f.heights[c-1]);
+    }
+}
+
+void boardFeatureSet(const unsigned short* rows, BoardFeatureSet& f) {
+    unsigned int height[DEPTH_BITS] = {};
+    unsigned int depth[DEPTH_BITS] = {};
+    unsigned int covered = 0;
+    int holes = 0, wells = 0, rowTransitions = 0, colTransitions = 0;
+
+    // empty rows above the first one over the stack only add their two
+    // wall transitions
+    int top = NUM_ROWS - 1;
+    while(top > 0 && rows[top-1] == 0 && rows[top] == 0) top--;
+    rowTransitions = 2 * (NUM_ROWS - 1 - top);
+
+    for(int r=top; r>=0; r--){
+        unsigned int row = rows[r];
+        unsigned int below = r > 0 ? rows[r-1] : FULL_ROW;
+        unsigned int tops = row & ~covered;
+        for(int b=0; b<DEPTH_BITS; b++){
+            if((r + 1) >> b & 1) height[b] |= tops;
+        }
+        holes += bitCount(~row & covered & FULL_ROW);
+
+        unsigned int walled = row << 1 | WALLS;
+        rowTransitions += bitCount((walled ^ walled >> 1) & ROW_PAIRS);
+        colTransitions += bitCount(row ^ below);
+
+        // open cells between two filled ones; their depth down the well
+        // counts up, a bit-sliced increment, and drops to 0 elsewhere
+        unsigned int well = ~(row | covered) & walled & walled >> 2 & FULL_ROW;
+        if(well){
+            unsigned int carry = FULL_ROW;
+            for(int b=0; b<DEPTH_BITS; b++){
+                unsigned int next = depth[b] & carry;
+                depth[b] = (depth[b] ^ carry) & well;
+                carry = next;
+                wells += bitCount(depth[b]) << b;
+            }
+        }
+        else memset(depth, 0, sizeof(depth));
+        covered |= row;
+    }
+
+    fromHeights(height, f);
+    f.holes = holes;
+    f.wells = wells;
+    f.rowTransitions = rowTransitions;
+    f.colTransitions = colTransitions;
+}
+
+#ifdef __AVX2__
+
+// popcount of each 16 bit lane: a nibble lookup per byte, then the pairs
+static inline __m256i popcount16(__m256i v) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, _mm256_and_si256(v, nibble)),
+                                    _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+    return _mm256_add_epi16(_mm256_and_si256(bytes, _mm256_set1_epi16(0xff)), _mm256_srli_epi16(bytes, 8));
+}
+
+const int LANES = 16;
+
+// boardFeatureSet() on sixteen boards, one per lane
+static void boardFeatureSet16(const BoardRows* boards, BoardFeatureSet* out) {
+    alignas(32) unsigned short rows[NUM_ROWS][LANES];
+    for(int i=0; i<LANES; i++){
+        for(int r=0; r<NUM_ROWS; r++) rows[r][i] = boards[i][r];
+    }
+
+    const __m256i full = _mm256_set1_epi16(FULL_ROW);
+    const __m256i walls = _mm256_set1_epi16(WALLS);
+    const __m256i pairs = _mm256_set1_epi16(ROW_PAIRS);
+    __m256i height[DEPTH_BITS], depth[DEPTH_BITS];
+    for(int b=0; b<DEPTH_BITS; b++) height[b] = depth[b] = _mm256_setzero_si256();
+    __m256i covered = _mm256_setzero_si256();
+    __m256i holes = covered, wells = covered, rowTransitions = covered, colTransitions = covered;
+
+    __m256i below = _mm256_load_si256((const __m256i*)rows[NUM_ROWS-1]);
+    for(int r=NUM_ROWS-1; r>=0; r--){
+        __m256i row = below;
+        below = r > 0 ? _mm256_load_si256((const __m256i*)rows[r-1]) : full;
+        __m256i tops = _mm256_andnot_si256(covered, row);
+        for(int b=0; b<DEPTH_BITS; b++){
+            if((r + 1) >> b & 1) height[b] = _mm256_or_si256(height[b], tops);
+        }
+        holes = _mm256_add_epi16(holes, popcount16(_mm256_and_si256(_mm256_andnot_si256(row, covered), full)));
+
+        __m256i walled = _mm256_or_si256(_mm256_slli_epi16(row, 1), walls);
+        __m256i changes = _mm256_and_si256(_mm256_xor_si256(walled, _mm256_srli_epi16(walled, 1)), pairs);
+        rowTransitions = _mm256_add_epi16(rowTransitions, popcount16(changes));
+        colTransitions = _mm256_add_epi16(colTransitions, popcount16(_mm256_xor_si256(row, below)));
+
+        __m256i sides = _mm256_and_si256(walled, _mm256_srli_epi16(walled, 2));
+        __m256i well = _mm256_and_si256(_mm256_andnot_si256(_mm256_or_si256(row, covered), sides), full);
+        __m256i carry = full;
+        for(int b=0; b<DEPTH_BITS; b++){
+            __m256i next = _mm256_and_si256(depth[b], carry);
+            depth[b] = _mm256_and_si256(_mm256_xor_si256(depth[b], carry), well);
+            carry = next;
+            wells = _mm256_add_epi16(wells, _mm256_slli_epi16(popcount16(depth[b]), b));
+        }
+        covered = _mm256_or_si256(covered, row);
+    }
+
+    alignas(32) unsigned short lanes[DEPTH_BITS + 4][LANES];
+    for(int b=0; b<DEPTH_BITS; b++) _mm256_store_si256((__m256i*)lanes[b], height[b]);
+    _mm256_store_si256((__m256i*)lanes[DEPTH_BITS], holes);
+    _mm256_store_si256((__m256i*)lanes[DEPTH_BITS + 1], wells);
+    _mm256_store_si256((__m256i*)lanes[DEPTH_BITS + 2], rowTransitions);
+    _mm256_store_si256((__m256i*)lanes[DEPTH_BITS + 3], colTransitions);
+    for(int i=0; i<LANES; i++){
+        unsigned int h[DEPTH_BITS];
+        for(int b=0; b<DEPTH_BITS; b++) h[b] = lanes[b][i];
+        fromHeights(h, out[i]);
+        out[i].holes = lanes[DEPTH_BITS][i];
+        out[i].wells = lanes[DEPTH_BITS + 1][i];
+        out[i].rowTransitions = lanes[DEPTH_BITS + 2][i];
+        out[i].colTransitions = lanes[DEPTH_BITS + 3][i];
+    }
+}
+
+#endif
+
+void boardFeatureSets(const BoardRows* boards, int count, BoardFeatureSet* out) {
+    int i = 0;
+#ifdef __AVX2__
+    for(; i+LANES<=count; i+=LANES) boardFeatureSet16(boards + i, out + i);
+#endif
+    for(; i<count; i++) boardFeatureSet(boards[i], out[i]);
+}
+
+const char* boardFeatureKernel() {
+#ifdef __AVX2__
+    return "AVX2, 16 boards a pass";
+#else
+    return "scalar";
+#endif
+}
+
+//----------------------------------------------------------------------------
+
+void boardFeatureSetReference(const Cells& cells, BoardFeatureSet& f) {
+    auto filled = [&cells](int r, int c){
+        if(c < 0 || c >= NUM_COLS || r < 0) return true;
+        return cells[r][c] != EMPTY_CELL;
+    };
+    memset(&f, 0, sizeof(f));
+    for(int c=0; c<NUM_COLS; c++){
+        int h = 0;
+        for(int r=NUM_ROWS-1; r>=0 && !h; r--){
+            if(filled(r, c)) h = r + 1;
+        }
+        f.heights[c] = h;
+        f.aggregateHeight += h;
+        if(h > f.maxHeight) f.maxHeight = h;
+        if(c > 0) f.bumpiness += abs(h - f.heights[c-1]);
+        for(int r=0; r<h; r++){
+            if(!filled(r, c)) f.holes++;
+        }
+        int depth = 0;
+        for(int r=NUM_ROWS-1; r>=h; r--){
+            if(filled(r, c-1) && filled(r, c+1)) f.wells += ++depth;
+            else depth = 0;
+        }
+        for(int r=0; r<NUM_ROWS; r++){
+            if(filled(r, c) != filled(r-1, c)) f.colTransitions++;
+        }
+    }
+    for(int r=0; r<NUM_ROWS; r++){
+        for(int c=0; c<=NUM_COLS; c++){
+            if(filled(r, c) != filled(r, c-1)) f.rowTransitions++;
+        }
+    }
+}
@@ -0,0 +1,46 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- Features.h ---
+//
+//   The board features evaluators are built from, computed straight from
+//   the row bitboards. Each row is handled as a whole: holes, wells and
+//   transitions come from shifts, masks and popcounts, and the per column
+//   heights and well depths are kept bit-sliced (one word per binary
+//   digit, one bit per column), so nothing loops over cells.
+//
+//   boardFeatureSets() does many boards at once. Built with -mavx2 it
+//   runs the same kernel on sixteen boards per pass, one in each 16 bit
+//   lane; otherwise it calls boardFeatureSet() on each. The cell by cell
+//   version works on a Game's Cells and is the reference the others are
+//   checked against.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __FEATURES_H__
+#define __FEATURES_H__
+
+#include "Pieces.h"
+
+struct BoardFeatureSet {
+    unsigned char heights[NUM_COLS];    // top filled cell + 1, 0 when empty
+    short aggregateHeight;
+    short maxHeight;
+    short holes;            // empty cells with a filled cell above them
+    short bumpiness;        // sum of height steps between neighbours
+    short wells;            // open cells with both sides filled, counted
+                            // 1, 2, 3 ... going down each well
+    short rowTransitions;   // filled/empty changes along each row, the
+                            // walls counting as filled
+    short colTransitions;   // the same up each column from the filled floor
+};
+
+bool operator==(const BoardFeatureSet& a, const BoardFeatureSet& b);
+
+void boardFeatureSet(const unsigned short* rows, BoardFeatureSet& f);
+void boardFeatureSets(const BoardRows* boards, int count, BoardFeatureSet* out);
+void boardFeatureSetReference(const Cells& cells, BoardFeatureSet& f);
+
+// what boardFeatureSets() runs on, for reports
+const char* boardFeatureKernel();
+
+#endif // __FEATURES_H__
@@ -0,0 +1,133 @@
+#include "FrameCapture.h"
+
+#include <cstring>
+
+using namespace std;
+
+FrameCapture::FrameCapture(const char* target, int width, int height)
+    : _width(width), _height(height), _frameBytes(size_t(width) * height * 3) {
+    if(target[0] == '|') {
+        _out = popen(target + 1, "w");
+        _isPipe = true;
+    }
+    else _out = fopen(target, "wb");
+
+    if(_out == nullptr) {
+        cerr<<"Failed to open capture target "<<target<<endl;
+        return;
+    }
+
+    glGenBuffers( CAPTURE_PBOS, _pbos );
+    for(int i=0; i<CAPTURE_PBOS; i++){
+        glBindBuffer( GL_PIXEL_PACK_BUFFER, _pbos[i] );
+        glBufferData( GL_PIXEL_PACK_BUFFER, _frameBytes, nullptr, GL_STREAM_READ );
+        _pboPending[i] = false;
+    }
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+    _buffers.assign(CAPTURE_BUFFERS, vector<unsigned char>(_frameBytes));
+    for(int i=0; i<CAPTURE_BUFFERS; i++) _free.push_back(i);
+
+    _writer = thread(&FrameCapture::writerLoop, this);
+}
+
+FrameCapture::~FrameCapture() {
+    finish();
+}
+
+void FrameCapture::captureFrame() {
+    if(!ok()) return;
+    int slot = _frame % CAPTURE_PBOS;
+
+    // the slot about to be reused was filled CAPTURE_PBOS frames ago
+    if(_pboPending[slot]) collect(slot);
+
+    glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, _pbos[slot] );
+    glReadPixels( 0, 0, _width, _height, GL_RGB, GL_UNSIGNED_BYTE, BUFFER_OFFSET(0) );
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+    _pboPending[slot] = true;
+    _frame++;
+}
+
+void FrameCapture::collect(int slot) {
+    _pboPending[slot] = false;
+
+    int buffer = -1;
+    {
+        lock_guard<mutex> guard(_lock);
+        if(!_free.empty()){
+            buffer = _free.back();
+            _free.pop_back();
+        }
+    }
+    if(buffer < 0){
+        _dropped++;
+        return;
+    }
+
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, _pbos[slot] );
+    void* pixels = glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, _frameBytes, GL_MAP_READ_BIT );
+    if(pixels != nullptr){
+        memcpy(&_buffers[buffer][0], pixels, _frameBytes);
+        glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+    }
+    glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+    lock_guard<mutex> guard(_lock);
+    if(pixels == nullptr){
+        _free.push_back(buffer);
+        _dropped++;
+        return;
+    }
+    _filled.push_back(buffer);
+    _wake.notify_one();
+}
+
+void FrameCapture::writerLoop() {
+    size_t rowBytes = size_t(_width) * 3;
+    while(true){
+        int buffer;
+        {
+            unique_lock<mutex> guard(_lock);
+            _wake.wait(guard, [this]{ return _stop || !_filled.empty(); });
+            if(_filled.empty()) return;
+            buffer = _filled.front();
+            _filled.pop_front();
+        }
+
+        // GL rows are bottom-up, raw video is top-down
+        const unsigned char* pixels = &_buffers[buffer][0];
+        for(int y=_height-1; y>=0; y--){
+            fwrite(pixels + y * rowBytes, 1, rowBytes, _out);
+        }
+        _written++;
+
+        lock_guard<mutex> guard(_lock);
+        _free.push_back(buffer);
+    }
+}
+
+void FrameCapture::finish() {
+    if(!ok()) return;
+
+    for(int i=0; i<CAPTURE_PBOS; i++){
+        int slot = (_frame + i) % CAPTURE_PBOS;
+        if(_pboPending[slot]) collect(slot);
+    }
+    glDeleteBuffers( CAPTURE_PBOS, _pbos );
+
+    {
+        lock_guard<mutex> guard(_lock);
+        _stop = true;
+    }
+    _wake.notify_one();
+    _writer.join();
+
+    fflush(_out);
+    if(_isPipe) pclose(_out);
+    else fclose(_out);
+    _out = nullptr;
+
+    cerr<<"capture: "<<_written<<" frames written, "<<_dropped<<" dropped"<<endl;
+}
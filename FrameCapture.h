@@ -0,0 +1,76 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- FrameCapture.h ---
+//
+//   Streams rendered frames as raw top-down RGB24 to a file or pipe.
+//   glReadPixels goes into a ring of pixel pack buffers and each one is
+//   mapped CAPTURE_PBOS frames later, when its slot comes round again,
+//   so the read back never waits on the GPU. Writing happens on a
+//   background thread; if it falls behind frames are dropped instead of
+//   slowing the render loop.
+//
+//   Play back with e.g.
+//     ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH -r FPS -i capture.rgb out.mp4
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __FRAMECAPTURE_H__
+#define __FRAMECAPTURE_H__
+
+#include "include/Angel.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class FrameCapture {
+public:
+    // target is a file name (a FIFO works too) or "|command" to pipe into
+    // a process, e.g. "|ffmpeg -f rawvideo ...".
+    FrameCapture(const char* target, int width, int height);
+    ~FrameCapture();
+
+    bool ok() const { return _out != nullptr; }
+
+    // Queues a read of the current read framebuffer (the window, or any
+    // bound FBO). Call after drawing and before the buffers are swapped.
+    void captureFrame();
+
+    // Drains the frames still in flight and closes the output.
+    void finish();
+
+    long long framesWritten() const { return _written; }
+    long long framesDropped() const { return _dropped; }
+
+private:
+    static const int CAPTURE_PBOS = 3;
+    static const int CAPTURE_BUFFERS = 6;
+
+    void collect(int slot);
+    void writerLoop();
+
+    int _width, _height;
+    size_t _frameBytes;
+    FILE* _out = nullptr;
+    bool _isPipe = false;
+
+    GLuint _pbos[CAPTURE_PBOS];
+    bool _pboPending[CAPTURE_PBOS];
+    int _frame = 0;
+
+    std::vector<std::vector<unsigned char>> _buffers;
+    std::vector<int> _free;
+    std::deque<int> _filled;
+    std::mutex _lock;
+    std::condition_variable _wake;
+    bool _stop = false;
+    std::thread _writer;
+
+    long long _written = 0;     // only touched by the writer thread
+    long long _dropped = 0;     // only touched by the render thread
+};
+
+#endif // __FRAMECAPTURE_H__
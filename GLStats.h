@@ -0,0 +1,188 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- GLStats.h ---
+//
+//   Counting wrappers for the GL entry points used by the renderer.
+//   Build with -DTETRIS_GL_STATS to count calls, uploaded bytes and
+//   objects created/destroyed per frame. Without it every gls* name is
+//   just the plain GL function and nothing is compiled in.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __GLSTATS_H__
+#define __GLSTATS_H__
+
+#include "include/Angel.h"
+
+#ifdef TETRIS_GL_STATS
+
+#include <cstdlib>
+
+struct GLCallCounts {
+    long long calls = 0;
+    long long draws = 0;
+    long long vertices = 0;
+    long long bytesUploaded = 0;
+    long long created = 0;
+    long long destroyed = 0;
+
+    void add(const GLCallCounts& o){
+        calls += o.calls;
+        draws += o.draws;
+        vertices += o.vertices;
+        bytesUploaded += o.bytesUploaded;
+        created += o.created;
+        destroyed += o.destroyed;
+    }
+};
+
+struct GLStats {
+    GLCallCounts frame;     // frame in progress
+    GLCallCounts last;      // last finished frame
+    GLCallCounts total;
+    long long frames = 0;
+};
+
+inline GLStats& glStats(){
+    static GLStats stats;
+    return stats;
+}
+
+inline void glsBufferData(GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage){
+    glStats().frame.calls++;
+    glStats().frame.bytesUploaded += size;
+    glBufferData(target, size, data, usage);
+}
+
+inline void glsBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid* data){
+    glStats().frame.calls++;
+    glStats().frame.bytesUploaded += size;
+    glBufferSubData(target, offset, size, data);
+}
+
+inline void glsDrawArrays(GLenum mode, GLint first, GLsizei count){
+    glStats().frame.calls++;
+    glStats().frame.draws++;
+    glStats().frame.vertices += count;
+    glDrawArrays(mode, first, count);
+}
+
+inline void glsDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances){
+    glStats().frame.calls++;
+    glStats().frame.draws++;
+    glStats().frame.vertices += (long long)count * instances;
+    glDrawArraysInstanced(mode, first, count, instances);
+}
+
+// bytes in a width x height upload, for the formats the renderer uses
+inline long long glsPixelBytes(GLsizei width, GLsizei height, GLenum format, GLenum type){
+    int components = format == GL_RED || format == GL_RED_INTEGER ? 1 : format == GL_RG || format == GL_RG_INTEGER ? 2 :
+                     format == GL_RGB || format == GL_RGB_INTEGER ? 3 : 4;
+    int size = type == GL_UNSIGNED_BYTE || type == GL_BYTE ? 1 : type == GL_UNSIGNED_SHORT || type == GL_SHORT ? 2 : 4;
+    return (long long)width * height * components * size;
+}
+
+inline void glsTexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height,
+                          GLint border, GLenum format, GLenum type, const GLvoid* data){
+    glStats().frame.calls++;
+    glStats().frame.bytesUploaded += glsPixelBytes(width, height, format, type);
+    glTexImage2D(target, level, internalFormat, width, height, border, format, type, data);
+}
+
+inline void glsTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+                             GLenum format, GLenum type, const GLvoid* data){
+    glStats().frame.calls++;
+    glStats().frame.bytesUploaded += glsPixelBytes(width, height, format, type);
+    glTexSubImage2D(target, level, x, y, width, height, format, type, data);
+}
+
+inline void glsGenTextures(GLsizei n, GLuint* textures){
+    glStats().frame.calls++;
+    glStats().frame.created += n;
+    glGenTextures(n, textures);
+}
+
+inline void glsGenVertexArrays(GLsizei n, GLuint* arrays){
+    glStats().frame.calls++;
+    glStats().frame.created += n;
+    glGenVertexArrays(n, arrays);
+}
+
+inline void glsGenBuffers(GLsizei n, GLuint* buffers){
+    glStats().frame.calls++;
+    glStats().frame.created += n;
+    glGenBuffers(n, buffers);
+}
+
+inline void glsDeleteVertexArrays(GLsizei n, const GLuint* arrays){
+    glStats().frame.calls++;
+    glStats().frame.destroyed += n;
+    glDeleteVertexArrays(n, arrays);
+}
+
+inline void glsDeleteBuffers(GLsizei n, const GLuint* buffers){
+    glStats().frame.calls++;
+    glStats().frame.destroyed += n;
+    glDeleteBuffers(n, buffers);
+}
+
+inline void glsBindVertexArray(GLuint array){
+    glStats().frame.calls++;
+    glBindVertexArray(array);
+}
+
+inline void glsBindBuffer(GLenum target, GLuint buffer){
+    glStats().frame.calls++;
+    glBindBuffer(target, buffer);
+}
+
+// Call once per presented frame to roll the running counts over.
+inline void glStatsEndFrame(){
+    GLStats& s = glStats();
+    s.total.add(s.frame);
+    s.last = s.frame;
+    s.frame = GLCallCounts();
+    s.frames++;
+}
+
+inline void glStatsPrint(){
+    const GLStats& s = glStats();
+    double n = s.frames ? s.frames : 1;
+    std::cout<<"GL calls over "<<s.frames<<" frames (last frame / average per frame)\n";
+    std::cout<<"  calls: "<<s.last.calls<<" / "<<s.total.calls / n<<"\n";
+    std::cout<<"  draws: "<<s.last.draws<<" / "<<s.total.draws / n<<"\n";
+    std::cout<<"  vertices: "<<s.last.vertices<<" / "<<s.total.vertices / n<<"\n";
+    std::cout<<"  bytes uploaded: "<<s.last.bytesUploaded<<" / "<<s.total.bytesUploaded / n<<"\n";
+    std::cout<<"  objects created: "<<s.last.created<<" / "<<s.total.created / n<<"\n";
+    std::cout<<"  objects destroyed: "<<s.last.destroyed<<" / "<<s.total.destroyed / n<<"\n";
+    std::cout<<"  objects still alive: "<<s.total.created + s.frame.created - s.total.destroyed - s.frame.destroyed<<"\n";
+    std::cout<<std::endl;
+}
+
+inline void glStatsInstallExitReport(){
+    atexit(glStatsPrint);
+}
+
+#else // !TETRIS_GL_STATS
+
+#define glsBufferData glBufferData
+#define glsBufferSubData glBufferSubData
+#define glsDrawArrays glDrawArrays
+#define glsDrawArraysInstanced glDrawArraysInstanced
+#define glsTexImage2D glTexImage2D
+#define glsTexSubImage2D glTexSubImage2D
+#define glsGenTextures glGenTextures
+#define glsGenVertexArrays glGenVertexArrays
+#define glsGenBuffers glGenBuffers
+#define glsDeleteVertexArrays glDeleteVertexArrays
+#define glsDeleteBuffers glDeleteBuffers
+#define glsBindVertexArray glBindVertexArray
+#define glsBindBuffer glBindBuffer
+
+#define glStatsEndFrame() do {} while(0)
+#define glStatsPrint() do {} while(0)
+#define glStatsInstallExitReport() do {} while(0)
+
+#endif // TETRIS_GL_STATS
+
+#endif // __GLSTATS_H__
@@ -0,0 +1,421 @@
+#include "Game.h"
+#include "Pieces.h"
+#include "Varint.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+coord Shape::_START_POS = coord(NUM_COLS/2, NUM_ROWS-1);
+
+const Shape SHAPES[NUM_SHAPES] = {
+    // O
+    Shape({ coord(0, 0), coord(0, -1), coord(1, 0), coord(1, -1) }, NONE),
+    // I
+    Shape({ coord(-2, 0), coord(-1, 0), coord(0, 0), coord(1, 0) }, SEMI),
+    // S
+    Shape({ coord(0, 0), coord(1, 0), coord(-1, -1), coord(0, -1) }, SEMI),
+    // Z
+    Shape({ coord(-1, 0), coord(0, 0), coord(0, -1), coord(1, -1) }, SEMI),
+    // L
+    Shape({ coord(-1, 0), coord(0, 0), coord(1, 0), coord(-1, -1) }, FULL),
+    // J
+    Shape({ coord(-1, 0), coord(0, 0), coord(1, 0), coord(1, -1) }, FULL),
+    // T
+    Shape({ coord(-1, 0), coord(0, 0), coord(1, 0), coord(0, -1) }, FULL)
+};
+
+//----------------------------------------------------------------------------
+
+void Shape::rotate(const Cells& cells) {
+    if(_rmode == NONE) return;
+    coord backup_pos[PIECE_CELLS];
+    copy(_pos, _pos + PIECE_CELLS, backup_pos);
+    coord backup_center=_center;
+
+    if(_straight) {
+        for(coord& v: _pos) {
+            v = coord(-v.y , v.x);
+        }
+    }
+    else{
+        for(coord& v: _pos) {
+            v = coord(v.y , -v.x);
+        }
+    }
+        
+    if(_rmode == SEMI) _straight = !_straight;
+
+    // check rotation moved out of bounds
+    int minX=NUM_COLS-1, minY=NUM_ROWS-1, maxX=0, maxY=0;
+    for(auto v: getPos()){
+        minX = min(v.x, minX);
+        minY = min(v.y, minY);
+        maxX = max(v.x, maxX);
+        maxY = max(v.y, maxY);
+    }
+
+    if(minX<0) _center.x-=minX;
+    else if(maxX>=NUM_COLS) _center.x -= NUM_COLS - maxX - 1;
+    if(minY<0) _center.y-=minY;
+    else if(maxY>=NUM_ROWS) _center.y -= NUM_ROWS - maxY - 1;
+
+    if(hasCollision(cells)){
+        copy(backup_pos, backup_pos + PIECE_CELLS, _pos);
+        _center = backup_center;
+        if(_rmode == SEMI) _straight = !_straight;
+    }
+}
+
+vector<coord> Shape::getPos() const {
+    vector<coord> v(PIECE_CELLS);
+    for(unsigned int i=0;i<v.size();i++){
+        v[i] = coord(_pos[i].x + _center.x, _pos[i].y + _center.y);
+    }
+    return v;
+}
+
+void Shape::moveHorizontal(bool right, const Cells& cells) {
+    _center.x += right ? 1 : -1;
+    if(hasCollision(cells)){
+        _center.x -= right ? 1 : -1;
+    }
+}
+
+bool Shape::moveDown(const Cells& cells) {
+    _center.y--;
+    if(hasCollision(cells)){
+        _center.y++;
+        return true;
+    }
+    return false;
+}
+
+bool Shape::hasCollision(const Cells& cells) const {
+    for(const coord& p: _pos){
+        int x = p.x + _center.x, y = p.y + _center.y;
+        if(x<0 || x>=NUM_COLS || y<0 || y>=NUM_ROWS || cells[y][x]!=EMPTY_CELL){
+            return true;
+        }
+    }
+    return false;
+}
+
+//----------------------------------------------------------------------------
+
+Game::Game(unsigned int seed) {
+    reset(seed);
+}
+
+void Game::reset(unsigned int seed) {
+    memset(_cells, EMPTY_CELL, sizeof(_cells));
+    memset(_heights, 0, sizeof(_heights));
+    memset(_rowFill, 0, sizeof(_rowFill));
+    _seed = seed;
+    _rng = seed ? seed : 1;
+    _downPressed = false;
+    _gameOver = false;
+    _updateCounter = 0;
+    _ticks = 0;
+    _piecesPlaced = 0;
+    _linesCleared = 0;
+    _groundVersion++;
+
+    _curr = SHAPES[nextRandom()%NUM_SHAPES];
+    _curr.setColor(nextRandom()%NUM_COLORS + 1);
+}
+
+// xorshift32, small enough to copy along with the rest of the game state
+unsigned int Game::nextRandom() {
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+    return _rng;
+}
+
+// heights and fills from scratch, after the board changed wholesale
+void Game::countCells() {
+    memset(_heights, 0, sizeof(_heights));
+    for(int r=0; r<NUM_ROWS; r++){
+        _rowFill[r] = 0;
+        for(int c=0; c<NUM_COLS; c++){
+            if(_cells[r][c] == EMPTY_CELL) continue;
+            _rowFill[r]++;
+            _heights[c] = r + 1;
+        }
+    }
+}
+
+int Game::dropDistance() const {
+    if(_gameOver) return 0;
+    int drop = NUM_ROWS;
+    for(const coord& p: _curr._pos){
+        int x = p.x + _curr._center.x, y = p.y + _curr._center.y;
+        if(y < _heights[x]){
+            // below the top of its column, where the heights say nothing
+            Shape piece = _curr;
+            drop = 0;
+            while(!piece.moveDown(_cells)) drop++;
+            return drop;
+        }
+        drop = min(drop, y - _heights[x]);
+    }
+    return drop;
+}
+
+int Game::nextShape() const {
+    unsigned int r = _rng;
+    r ^= r << 13;
+    r ^= r >> 17;
+    r ^= r << 5;
+    return r % NUM_SHAPES;
+}
+
+void Game::input(Input in) {
+    if(in == INPUT_RESTART){
+        reset(nextRandom());
+        return;
+    }
+    if(_gameOver) return;
+
+    switch(in){
+        case INPUT_LEFT:
+            _curr.moveHorizontal(false, _cells);
+            break;
+        case INPUT_RIGHT:
+            _curr.moveHorizontal(true, _cells);
+            break;
+        case INPUT_ROTATE:
+            _curr.rotate(_cells);
+            break;
+        case INPUT_DOWN_PRESS:
+            _downPressed = true;
+            break;
+        case INPUT_DOWN_RELEASE:
+            _downPressed = false;
+            break;
+        case INPUT_HARD_DROP:
+            // locking is left to gravity, so a piece still only ever
+            // locks in tick()
+            _curr._center.y -= dropDistance();
+            _updateCounter = REGULAR_GRAVITY_FACTOR;
+            break;
+        default:
+            break;
+    }
+}
+
+bool Game::tick() {
+    if(_gameOver) return false;
+    _ticks++;
+    if(_downPressed || ++_updateCounter > REGULAR_GRAVITY_FACTOR) {
+        _updateCounter = 0;
+        gravity();
+        return true;
+    }
+    return false;
+}
+
+void Game::addGarbage(int rows, int hole) {
+    if(_gameOver || rows <= 0) return;
+    rows = min(rows, NUM_ROWS);
+    for(int i=NUM_ROWS-rows; i<NUM_ROWS; i++){
+        for(auto x: _cells[i]){
+            if(x != EMPTY_CELL) _gameOver = true;
+        }
+    }
+    memmove(_cells[rows], _cells[0], (NUM_ROWS - rows) * NUM_COLS);
+    for(int i=0; i<rows; i++){
+        memset(_cells[i], GARBAGE_CELL, NUM_COLS);
+        _cells[i][hole] = EMPTY_CELL;
+    }
+    countCells();
+    _groundVersion++;
+    if(_curr.hasCollision(_cells)) _gameOver = true;
+}
+
+void Game::gravity() {
+    if(_curr.moveDown(_cells)){
+        setNewCurr();
+    }
+}
+
+void Game::setNewCurr() {
+    auto pos=_curr.getPos();
+    unsigned char color=_curr.getColor();
+    for(auto& v: pos){
+        if(v.x<0||v.y<0) {
+            cout<<"should not get here\n";
+            cout<<v.x<<" while limit: "<<NUM_COLS<<"\n"<<v.y<<" while limit: "<<NUM_ROWS<<endl<<endl;
+            continue;
+        }
+        _cells[v.y][v.x]=color;
+        _rowFill[v.y]++;
+        _heights[v.x] = max<int>(_heights[v.x], v.y + 1);
+    }
+    _piecesPlaced++;
+    _groundVersion++;
+
+    // only the rows the piece landed in can have filled up
+    int full[PIECE_CELLS];
+    int cleared = 0;
+    for(auto& v: pos){
+        if(v.y<0 || _rowFill[v.y]!=NUM_COLS || find(full, full + cleared, v.y) != full + cleared) continue;
+        // kept in order, lowest first
+        int i = cleared++;
+        for(; i>0 && full[i-1] > v.y; i--) full[i] = full[i-1];
+        full[i] = v.y;
+    }
+    if(cleared){
+        // close each gap with one move of the rows between it and the
+        // next, up to the top of the stack; nothing above it is filled
+        int top = *max_element(_heights, _heights + NUM_COLS);
+        int dst = full[0];
+        for(int i=0; i<cleared; i++){
+            int src = full[i] + 1;
+            int n = (i + 1 < cleared ? full[i+1] : top) - src;
+            memmove(_cells[dst], _cells[src], n * NUM_COLS);
+            memmove(_rowFill + dst, _rowFill + src, n);
+            dst += n;
+        }
+        memset(_cells[dst], EMPTY_CELL, cleared * NUM_COLS);
+        memset(_rowFill + dst, 0, cleared);
+        _linesCleared += cleared;
+
+        // every cleared row was full, so lies below every column's top; a
+        // top that was itself cleared leaves empty cells to skip under it
+        for(int c=0; c<NUM_COLS; c++){
+            int h = _heights[c] - cleared;
+            while(h > 0 && _cells[h-1][c] == EMPTY_CELL) h--;
+            _heights[c] = h;
+        }
+    }
+
+    _curr = SHAPES[nextRandom()%NUM_SHAPES];
+    _curr.setColor(nextRandom()%NUM_COLORS + 1);
+    if(_curr.hasCollision(_cells)){
+        _gameOver=true;
+    }
+}
+
+BoardSnapshot Game::snapshot() const {
+    BoardSnapshot snap;
+    for(int i=0; i<NUM_ROWS; i++){
+        for(int j=0; j<NUM_COLS; j++){
+            snap.cells[i][j] = _cells[i][j];
+        }
+    }
+    auto pos = _curr.getPos();
+    snap.pieceCells = pos.size();
+    for(int k=0; k<snap.pieceCells; k++){
+        snap.pieceX[k] = pos[k].x;
+        snap.pieceY[k] = pos[k].y;
+    }
+    snap.pieceColor = _curr.getColor();
+    snap.ghostDrop = dropDistance();
+    snap.gameOver = _gameOver;
+    snap.groundVersion = _groundVersion;
+    return snap;
+}
+
+//----------------------------------------------------------------------------
+
+void Game::writeState(vector<unsigned char>& out) const {
+    for(int i=0; i<NUM_ROWS; i++){
+        unsigned int bits = 0;
+        for(int j=0; j<NUM_COLS; j++){
+            if(_cells[i][j] != EMPTY_CELL) bits |= 1u << j;
+        }
+        putVarint(out, bits);
+    }
+    // colours of the occupied cells, two per byte
+    int nibbles = 0;
+    for(int i=0; i<NUM_ROWS; i++){
+        for(int j=0; j<NUM_COLS; j++){
+            if(_cells[i][j] == EMPTY_CELL) continue;
+            if(nibbles++ % 2 == 0) out.push_back(_cells[i][j]);
+            else out.back() |= _cells[i][j] << 4;
+        }
+    }
+
+    out.push_back(PIECE_CELLS);
+    for(const coord& v: _curr._pos) out.push_back(((v.x + 8) & 0xF) | ((v.y + 8) << 4));
+    out.push_back(_curr._center.x);
+    out.push_back(_curr._center.y);
+    out.push_back(_curr._color | (_curr._rmode << 4) | (_curr._straight << 6));
+
+    putU32(out, _rng);
+    putU32(out, _seed);
+    out.push_back(_updateCounter | (_downPressed << 6) | (_gameOver << 7));
+    putVarint(out, _ticks);
+    putVarint(out, _piecesPlaced);
+    putVarint(out, _linesCleared);
+}
+
+bool Game::readState(const unsigned char*& p, const unsigned char* end) {
+    unsigned int rows[NUM_ROWS];
+    int occupied = 0;
+    for(int i=0; i<NUM_ROWS; i++){
+        unsigned long long bits;
+        if(!getVarint(p, end, bits) || bits >> NUM_COLS) return false;
+        rows[i] = bits;
+        for(int j=0; j<NUM_COLS; j++) occupied += (bits >> j) & 1;
+    }
+    if(end - p < (occupied + 1) / 2 + 1) return false;
+
+    int nibbles = 0;
+    for(int i=0; i<NUM_ROWS; i++){
+        for(int j=0; j<NUM_COLS; j++){
+            unsigned char c = EMPTY_CELL;
+            if((rows[i] >> j) & 1){
+                c = nibbles % 2 == 0 ? (p[nibbles / 2] & 0xF) : (p[nibbles / 2] >> 4);
+                nibbles++;
+                if(c == EMPTY_CELL || c > NUM_COLORS) return false;
+            }
+            _cells[i][j] = c;
+        }
+    }
+    p += (occupied + 1) / 2;
+
+    unsigned int n = *p++;
+    if(n != PIECE_CELLS || end - p < (long)n + 3 + 9 + 1) return false;
+    for(coord& v: _curr._pos){
+        v = coord((*p & 0xF) - 8, (*p >> 4) - 8);
+        p++;
+    }
+    _curr._center = coord((signed char)p[0], (signed char)p[1]);
+    _curr._color = p[2] & 0xF;
+    if(_curr._color == EMPTY_CELL || _curr._color > NUM_COLORS || ((p[2] >> 4) & 3) > FULL) return false;
+    _curr._rmode = Rotation_mode((p[2] >> 4) & 3);
+    _curr._straight = (p[2] >> 6) & 1;
+    p += 3;
+
+    _rng = getU32(p);
+    _seed = getU32(p + 4);
+    _updateCounter = p[8] & 0x3F;
+    _downPressed = (p[8] >> 6) & 1;
+    _gameOver = (p[8] >> 7) & 1;
+    p += 9;
+
+    // the piece must be one of SHAPES on the board; only a game that has
+    // ended may have it overlap settled cells, the spawn that ended it
+    int shape, orient, x, y;
+    if(!pieceTable().locate(_curr, shape, orient, x, y) || _curr._rmode != SHAPES[shape]._rmode) return false;
+    for(const coord& v: _curr._pos){
+        x = v.x + _curr._center.x;
+        y = v.y + _curr._center.y;
+        if(x < 0 || x >= NUM_COLS || y < 0 || y >= NUM_ROWS) return false;
+        if(!_gameOver && _cells[y][x] != EMPTY_CELL) return false;
+    }
+
+    unsigned long long ticks, pieces, lines;
+    if(!getVarint(p, end, ticks) || !getVarint(p, end, pieces) || !getVarint(p, end, lines)) return false;
+    _ticks = ticks;
+    _piecesPlaced = pieces;
+    _linesCleared = lines;
+    countCells();
+    _groundVersion++;
+    return true;
+}
@@ -0,0 +1,151 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- Game.h ---
+//
+//   The game rules without any rendering: pieces, the settled cells,
+//   gravity and line clears. The GL front end drives one Game from its
+//   simulation thread; tools can run as many as they like headless.
+//   Pieces and colours come from the game's own generator, so a seed
+//   plus the input sequence reproduces a game exactly.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __GAME_H__
+#define __GAME_H__
+
+#include "Board.h"
+
+#include <initializer_list>
+#include <vector>
+
+const float UPDATE_INTERVAL = 50.0;
+const int REGULAR_GRAVITY_FACTOR = 5;
+
+enum Rotation_mode { NONE, SEMI, FULL};
+
+enum Input {
+    INPUT_LEFT,
+    INPUT_RIGHT,
+    INPUT_ROTATE,
+    INPUT_DOWN_PRESS,
+    INPUT_DOWN_RELEASE,
+    INPUT_RESTART,
+    // drops the piece straight to where the ghost shows it; it locks on
+    // the next tick
+    INPUT_HARD_DROP
+};
+
+struct coord{
+    int x, y;
+    coord(){}
+    coord(int a, int b): x(a), y(b) {}
+};
+
+// settled cells, [row][col] holding EMPTY_CELL or palette index + 1
+typedef unsigned char Cells[NUM_ROWS][NUM_COLS];
+
+class Shape{
+public:
+    Shape(std::initializer_list<coord> pos, Rotation_mode rmode) : _rmode(rmode) {
+        int i=0;
+        for(const coord& v: pos) _pos[i++] = v;
+    }
+
+    void rotate(const Cells& cells);
+    std::vector<coord> getPos() const;
+
+    unsigned char getColor() const { return _color; }
+    void setColor(unsigned char val) { _color = val; }
+
+    void moveHorizontal(bool right, const Cells& cells);
+    // returns true when the piece could not move, i.e. it has landed
+    bool moveDown(const Cells& cells);
+    bool hasCollision(const Cells& cells) const;
+
+private:
+    friend class Game;
+    static coord _START_POS;
+
+    coord _pos[PIECE_CELLS];
+    unsigned char _color = EMPTY_CELL;
+    coord _center = _START_POS;
+    Rotation_mode _rmode;
+    bool _straight = true;
+};
+
+const int NUM_SHAPES = 7;
+extern const Shape SHAPES[NUM_SHAPES];
+
+// Game holds no pointers or heap memory, so copying one (a couple of
+// hundred bytes) is a complete, independent snapshot of the game.
+class Game {
+public:
+    explicit Game(unsigned int seed = 0);
+
+    void reset(unsigned int seed);
+
+    // Applies one player input right away.
+    void input(Input in);
+    // Advances the game by one UPDATE_INTERVAL. Returns true when gravity
+    // moved or locked the piece on this tick.
+    bool tick();
+    // Versus garbage: pushes the settled cells up by rows and fills the
+    // bottom with GARBAGE_CELL rows open at column hole. Anything pushed
+    // off the top, or into the falling piece, ends the game.
+    void addGarbage(int rows, int hole);
+
+    bool isOver() const { return _gameOver; }
+    bool downPressed() const { return _downPressed; }
+    const Cells& cells() const { return _cells; }
+    const Shape& current() const { return _curr; }
+    // top filled cell + 1 of a column, filled cells in a row; kept up to
+    // date on every lock and clear
+    int columnHeight(int col) const { return _heights[col]; }
+    int rowFill(int row) const { return _rowFill[row]; }
+    // Rows the falling piece can drop straight down, where the ghost is.
+    // Constant time from the column heights, unless the piece is tucked
+    // under an overhang.
+    int dropDistance() const;
+    // index into SHAPES of the piece the next spawn brings, the preview
+    int nextShape() const;
+
+    long long ticks() const { return _ticks; }
+    long long piecesPlaced() const { return _piecesPlaced; }
+    long long linesCleared() const { return _linesCleared; }
+    // bumped whenever the settled cells change
+    unsigned int groundVersion() const { return _groundVersion; }
+
+    BoardSnapshot snapshot() const;
+
+    // Seed the game was last reset with.
+    unsigned int seed() const { return _seed; }
+
+    // Compact serialisation of the complete state: row bitboards, packed
+    // cell colours, the falling piece, generator and counters. Typically
+    // 40-70 bytes. readState returns false on malformed input.
+    void writeState(std::vector<unsigned char>& out) const;
+    bool readState(const unsigned char*& p, const unsigned char* end);
+
+private:
+    unsigned int nextRandom();
+    void gravity();
+    void setNewCurr();
+    void countCells();
+
+    Cells _cells;
+    unsigned char _heights[NUM_COLS];
+    unsigned char _rowFill[NUM_ROWS];
+    Shape _curr = SHAPES[0];
+    unsigned int _seed = 1;
+    unsigned int _rng = 1;
+    bool _downPressed = false;
+    bool _gameOver = false;
+    int _updateCounter = 0;
+
+    long long _ticks = 0;
+    long long _piecesPlaced = 0;
+    long long _linesCleared = 0;
+    unsigned int _groundVersion = 0;
+};
+
+#endif // __GAME_H__
@@ -0,0 +1,90 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- JobPool.h ---
+//
+//   A fixed set of threads for searches that fan one job out over every
+//   core and wait for it: run() hands the job to each helper thread and
+//   runs it on the calling thread as well, so a pool of one is just a
+//   function call. The job divides the work itself, usually by taking
+//   items off a shared atomic counter. Helpers sleep between jobs.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __JOBPOOL_H__
+#define __JOBPOOL_H__
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobPool {
+public:
+    // threads counts the caller of run()
+    explicit JobPool(int threads) {
+        for(int i=1; i<threads; i++) _helpers.emplace_back(&JobPool::helper, this, i);
+    }
+
+    ~JobPool() {
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _stop = true;
+        }
+        _wake.notify_all();
+        for(auto& t: _helpers) t.join();
+    }
+
+    JobPool(const JobPool&) = delete;
+    JobPool& operator=(const JobPool&) = delete;
+
+    int size() const { return (int)_helpers.size() + 1; }
+
+    // Calls job(thread) on every thread, the caller being thread 0, and
+    // returns when all of them have.
+    void run(const std::function<void(int)>& job) {
+        if(_helpers.empty()){
+            job(0);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _job = &job;
+            _generation++;
+            _running = _helpers.size();
+        }
+        _wake.notify_all();
+        job(0);
+        std::unique_lock<std::mutex> guard(_lock);
+        _done.wait(guard, [this]{ return _running == 0; });
+        _job = nullptr;
+    }
+
+private:
+    void helper(int id) {
+        unsigned long long seen = 0;
+        for(;;){
+            const std::function<void(int)>* job;
+            {
+                std::unique_lock<std::mutex> guard(_lock);
+                _wake.wait(guard, [&]{ return _stop || _generation != seen; });
+                if(_stop) return;
+                seen = _generation;
+                job = _job;
+            }
+            (*job)(id);
+            std::lock_guard<std::mutex> guard(_lock);
+            if(--_running == 0) _done.notify_one();
+        }
+    }
+
+    std::vector<std::thread> _helpers;
+    std::mutex _lock;
+    std::condition_variable _wake, _done;
+    const std::function<void(int)>* _job = nullptr;
+    unsigned long long _generation = 0;
+    int _running = 0;
+    bool _stop = false;
+};
+
+#endif // __JOBPOOL_H__
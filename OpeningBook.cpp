@@ -0,0 +1,118 @@
+#include "OpeningBook.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+const int FINGERPRINT_SHIFT = 24;
+
+// part of the file format, like hashRows: a change here needs a new
+// BOOK_VERSION
+unsigned long long bookKey(const unsigned short* rows, int shape, int next) {
+    return hashRows(rows, (unsigned long long)(shape + 1) << 8 ^ (unsigned int)(next + 1));
+}
+
+static unsigned long long fingerprint(unsigned long long key) {
+    return (key >> FINGERPRINT_SHIFT | 1) << FINGERPRINT_SHIFT;
+}
+
+bool writeOpeningBook(const char* path, const vector<BookMove>& moves, int pieces, int depth) {
+    BookHeader h;
+    h.magic = BOOK_MAGIC;
+    h.version = BOOK_VERSION;
+    h.rows = NUM_ROWS;
+    h.cols = NUM_COLS;
+    h.pieces = pieces;
+    h.depth = depth;
+    h.slots = 2;
+    while(h.slots < 2 * moves.size()) h.slots *= 2;
+    h.entries = moves.size();
+
+    vector<unsigned long long> slots(h.slots, 0);
+    for(const BookMove& m: moves){
+        unsigned long long word = fingerprint(m.key) | (unsigned long long)(unsigned char)m.placement.x << 16 |
+                                  (unsigned char)m.placement.y << 8 | (unsigned char)m.placement.orient;
+        size_t i = m.key & (h.slots - 1);
+        while(slots[i] != 0) i = (i + 1) & (h.slots - 1);
+        slots[i] = word;
+    }
+
+    // written aside and renamed, so a reader never maps half a book
+    string tmp = string(path) + ".tmp";
+    ofstream out(tmp, ios::binary);
+    out.write((const char*)&h, sizeof(h));
+    out.write((const char*)slots.data(), slots.size() * sizeof(slots[0]));
+    out.close();
+    if(!out || rename(tmp.c_str(), path) != 0){
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool OpeningBook::open(const char* path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0) return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BookHeader)){
+        ::close(fd);
+        return false;
+    }
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(p == MAP_FAILED) return false;
+
+    _header = (const BookHeader*)p;
+    _slots = (const unsigned long long*)(_header + 1);
+    _size = st.st_size;
+    const BookHeader& h = *_header;
+    // slots is checked against the size before it's multiplied, so a huge
+    // count can't wrap around to match
+    size_t maxSlots = (_size - sizeof(BookHeader)) / sizeof(unsigned long long);
+    if(h.magic != BOOK_MAGIC || h.version != BOOK_VERSION || h.rows != NUM_ROWS || h.cols != NUM_COLS ||
+       h.pieces == 0 || h.slots == 0 || h.slots > maxSlots || (h.slots & (h.slots - 1)) != 0 ||
+       h.entries == 0 || h.entries >= h.slots ||
+       _size != sizeof(BookHeader) + h.slots * sizeof(unsigned long long)){
+        cerr<<path<<" is not a compatible opening book"<<endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void OpeningBook::close() {
+    if(_header == nullptr) return;
+    munmap((void*)_header, _size);
+    _header = nullptr;
+    _slots = nullptr;
+    _size = 0;
+}
+
+bool OpeningBook::lookup(const unsigned short* rows, int shape, int next, Placement& placement) const {
+    if(_header == nullptr) return false;
+    unsigned long long key = bookKey(rows, shape, next);
+    unsigned long long mask = _header->slots - 1, want = fingerprint(key);
+    // a well formed book always has an empty slot to end a miss, but the
+    // file can't be trusted to
+    size_t i = key & mask;
+    for(unsigned long long n = 0; n < _header->slots && _slots[i] != 0; n++, i = (i + 1) & mask){
+        if((_slots[i] & ~((1ull << FINGERPRINT_SHIFT) - 1)) != want) continue;
+        placement.x = _slots[i] >> 16 & 0xff;
+        placement.y = _slots[i] >> 8 & 0xff;
+        placement.orient = _slots[i] & 0xff;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,74 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- OpeningBook.h ---
+//
+//   Placements worked out ahead of time for the first pieces of a game,
+//   keyed by the board, the piece and the preview. tetris-book searches
+//   them offline, much deeper than the Bot can afford in a tick, and
+//   writes them to a file the Bot maps read-only: opening it is an
+//   mmap() and a header check, and a lookup a hash and a probe or two.
+//
+//   The file is a header and an open addressed table of 64 bit words,
+//   at most half full. A word holds the top 40 bits of the position's
+//   hash, never 0, above the placement's x, y and orientation, a byte
+//   each; 0 is an empty slot. The low bits of the hash pick where the
+//   probe starts, but a match is not checked against its home slot, so
+//   only the 40 bits tell positions apart: two whose top bits agree
+//   share a placement, odds of about one in 2^40 per probe.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __OPENINGBOOK_H__
+#define __OPENINGBOOK_H__
+
+#include "Placement.h"
+
+#include <vector>
+
+const unsigned int BOOK_MAGIC = 0x4b425454;     // "TTBK"
+const unsigned int BOOK_VERSION = 1;
+
+struct BookHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int rows, cols;    // the board it was made for
+    unsigned int pieces;        // how many pieces into the game it covers
+    unsigned int depth;         // chance layers searched for each
+    unsigned long long slots;   // power of two
+    unsigned long long entries;
+};
+
+struct BookMove {
+    unsigned long long key;
+    Placement placement;
+};
+
+// the position a book entry is for
+unsigned long long bookKey(const unsigned short* rows, int shape, int next);
+
+// Writes moves, one per key, as a book file. False on a write error.
+bool writeOpeningBook(const char* path, const std::vector<BookMove>& moves, int pieces, int depth);
+
+class OpeningBook {
+public:
+    OpeningBook() {}
+    ~OpeningBook() { close(); }
+    OpeningBook(const OpeningBook&) = delete;
+    OpeningBook& operator=(const OpeningBook&) = delete;
+
+    // Maps the file; false if it can't, or it isn't a book for this board.
+    bool open(const char* path);
+    void close();
+    bool isOpen() const { return _header != nullptr; }
+    const BookHeader& header() const { return *_header; }
+
+    // The book's placement of shape on rows with next in the preview.
+    bool lookup(const unsigned short* rows, int shape, int next, Placement& placement) const;
+
+private:
+    const BookHeader* _header = nullptr;
+    const unsigned long long* _slots = nullptr;
+    size_t _size = 0;
+};
+
+#endif // __OPENINGBOOK_H__
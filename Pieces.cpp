@@ -0,0 +1,128 @@
+#include "Pieces.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+void rowsFromCells(const Cells& cells, BoardRows& rows) {
+    for(int r=0; r<NUM_ROWS; r++){
+        unsigned short bits = 0;
+        for(int c=0; c<NUM_COLS; c++){
+            if(cells[r][c] != EMPTY_CELL) bits |= 1 << c;
+        }
+        rows[r] = bits;
+    }
+}
+
+int shapeFromName(char c) {
+    if(c >= 'a' && c <= 'z') c += 'A' - 'a';
+    for(int s=0; s<NUM_SHAPES; s++){
+        if(SHAPE_NAMES[s] == c) return s;
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------------
+
+// Cell offsets of every orientation of every piece, taken from the Game's
+// own SHAPES and Shape::rotate so the two can't drift apart.
+PieceTable::PieceTable() {
+    Cells empty;
+    memset(empty, EMPTY_CELL, sizeof(empty));
+    const int drop = 4;     // clear of the top, so no rotation is refused
+    for(int s=0; s<NUM_SHAPES; s++){
+        Shape piece = SHAPES[s];
+        for(int i=0; i<drop; i++) piece.moveDown(empty);
+        int n = 0;
+        for(;;){
+            auto pos = piece.getPos();
+            for(int k=0; k<PIECE_CELLS; k++){
+                dx[s][n][k] = pos[k].x - SPAWN_X;
+                dy[s][n][k] = pos[k].y - (SPAWN_Y - drop);
+            }
+            n++;
+            piece.rotate(empty);
+            auto next = piece.getPos();
+            bool same = true;
+            for(int k=0; k<PIECE_CELLS; k++){
+                same = same && next[k].x - SPAWN_X == dx[s][0][k] && next[k].y - (SPAWN_Y - drop) == dy[s][0][k];
+            }
+            if(same || n == MAX_ORIENTATIONS) break;
+        }
+        orientations[s] = n;
+
+        for(int o=0; o<n; o++){
+            Box& b = box[s][o];
+            b.minX = *min_element(dx[s][o], dx[s][o] + PIECE_CELLS);
+            b.maxX = *max_element(dx[s][o], dx[s][o] + PIECE_CELLS);
+            b.minY = *min_element(dy[s][o], dy[s][o] + PIECE_CELLS);
+            b.maxY = *max_element(dy[s][o], dy[s][o] + PIECE_CELLS);
+            memset(b.rowMask, 0, sizeof(b.rowMask));
+            for(int k=0; k<PIECE_CELLS; k++) b.rowMask[dy[s][o][k] - b.minY] |= 1 << (dx[s][o][k] - b.minX);
+        }
+    }
+}
+
+bool PieceTable::rotate(const unsigned short* rows, int shape, int& orient, int& x, int& y) const {
+    if(orientations[shape] == 1) return false;
+    int r = (orient + 1) % orientations[shape];
+    const Box& b = box[shape][r];
+    // same bounds correction as Shape::rotate, which pushes the wrong way
+    // at the right and top walls, so those turns are refused
+    int nx = x, ny = y;
+    if(x + b.minX < 0) nx -= x + b.minX;
+    else if(x + b.maxX >= NUM_COLS) nx -= NUM_COLS - (x + b.maxX) - 1;
+    if(y + b.minY < 0) ny -= y + b.minY;
+    else if(y + b.maxY >= NUM_ROWS) ny -= NUM_ROWS - (y + b.maxY) - 1;
+    if(collides(rows, shape, r, nx, ny)) return false;
+    orient = r;
+    x = nx;
+    y = ny;
+    return true;
+}
+
+int PieceTable::lock(unsigned short* rows, int shape, int orient, int x, int y) const {
+    for(int c=0; c<PIECE_CELLS; c++) rows[y + dy[shape][orient][c]] |= 1 << (x + dx[shape][orient][c]);
+
+    // only rows the piece reaches can have filled up
+    const Box& b = box[shape][orient];
+    unsigned int full = 0;
+    for(int r=0; r<=b.maxY-b.minY; r++) full |= (rows[y + b.minY + r] == FULL_ROW) << r;
+    if(full == 0) return 0;
+
+    int dst = y + b.minY + __builtin_ctz(full);
+    for(int src=dst+1; src<NUM_ROWS; src++){
+        rows[dst] = rows[src];
+        dst += rows[src] != FULL_ROW;
+    }
+    int cleared = NUM_ROWS - dst;
+    for(; dst<NUM_ROWS; dst++) rows[dst] = 0;
+    return cleared;
+}
+
+bool PieceTable::locate(const Shape& piece, int& shape, int& orient, int& x, int& y) const {
+    auto pos = piece.getPos();
+    for(int s=0; s<NUM_SHAPES; s++){
+        for(int o=0; o<orientations[s]; o++){
+            int cx = pos[0].x - dx[s][o][0], cy = pos[0].y - dy[s][o][0];
+            bool match = true;
+            for(int k=1; k<PIECE_CELLS && match; k++){
+                match = pos[k].x == cx + dx[s][o][k] && pos[k].y == cy + dy[s][o][k];
+            }
+            if(match){
+                shape = s;
+                orient = o;
+                x = cx;
+                y = cy;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+const PieceTable& pieceTable() {
+    static PieceTable table;
+    return table;
+}
@@ -0,0 +1,101 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- Pieces.h ---
+//
+//   The pieces on row bitboards, for code that simulates or searches
+//   many positions and can't afford a Game per position. A piece is a
+//   shape, an orientation and the cell its offsets are relative to; the
+//   table of offsets is built from the Game's SHAPES and Shape::rotate,
+//   so moves here land exactly where the Game puts them.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __PIECES_H__
+#define __PIECES_H__
+
+#include "Game.h"
+
+static_assert(NUM_COLS <= 16, "rows are 16 bit bitboards");
+
+// one bitboard per row, bit c for column c, row 0 at the bottom
+typedef unsigned short BoardRows[NUM_ROWS];
+
+const unsigned short FULL_ROW = (1 << NUM_COLS) - 1;
+
+// Cells set in a row. Without -mpopcnt __builtin_popcount is a library
+// call, slower than these few operations.
+inline int bitCount(unsigned int row) {
+#ifdef __POPCNT__
+    return __builtin_popcount(row);
+#else
+    row = row - (row >> 1 & 0x5555);
+    row = (row & 0x3333) + (row >> 2 & 0x3333);
+    row = (row + (row >> 4)) & 0x0f0f;
+    return (row + (row >> 8)) & 0x1f;
+#endif
+}
+
+// Hash of the rows and then tag, which goes in after them so it can't
+// cancel cells. Opening books store it: a change here needs a new
+// BOOK_VERSION.
+inline unsigned long long hashRows(const unsigned short* rows, unsigned long long tag) {
+    unsigned long long h = 0;
+    for(int r=0; r<NUM_ROWS; r+=4){
+        unsigned long long word = 0;
+        for(int k=0; k<4 && r + k < NUM_ROWS; k++) word |= (unsigned long long)rows[r + k] << (16 * k);
+        h = (h ^ word) * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 29;
+    }
+    h = (h ^ tag) * 0xBF58476D1CE4E5B9ull;
+    return h ^ (h >> 32);
+}
+const int SPAWN_X = NUM_COLS / 2, SPAWN_Y = NUM_ROWS - 1;
+const int MAX_ORIENTATIONS = 4;
+
+// one letter per shape, in SHAPES order
+const char SHAPE_NAMES[NUM_SHAPES + 1] = "OISZLJT";
+
+void rowsFromCells(const Cells& cells, BoardRows& rows);
+// index into SHAPES of a letter from SHAPE_NAMES, either case; -1 if none
+int shapeFromName(char c);
+
+struct PieceTable {
+    int orientations[NUM_SHAPES];
+    signed char dx[NUM_SHAPES][MAX_ORIENTATIONS][PIECE_CELLS];
+    signed char dy[NUM_SHAPES][MAX_ORIENTATIONS][PIECE_CELLS];
+
+    // bounding box and one mask per row of it, bit 0 = column minX
+    struct Box {
+        signed char minX, maxX, minY, maxY;
+        unsigned short rowMask[PIECE_CELLS];
+    };
+    Box box[NUM_SHAPES][MAX_ORIENTATIONS];
+
+    PieceTable();
+
+    bool collides(const unsigned short* rows, int shape, int orient, int x, int y) const {
+        const Box& b = box[shape][orient];
+        int left = x + b.minX, bottom = y + b.minY;
+        if(left < 0 || x + b.maxX >= NUM_COLS || bottom < 0 || y + b.maxY >= NUM_ROWS) return true;
+        for(int r=0; r<=b.maxY-b.minY; r++){
+            if(rows[bottom + r] & (b.rowMask[r] << left)) return true;
+        }
+        return false;
+    }
+
+    // Shape::rotate, bounds correction included. Updates the piece and
+    // returns true when it turned.
+    bool rotate(const unsigned short* rows, int shape, int& orient, int& x, int& y) const;
+
+    // Sets the piece's cells in rows, clears full rows and returns how
+    // many there were.
+    int lock(unsigned short* rows, int shape, int orient, int x, int y) const;
+
+    // Works out shape, orientation and position of a Game's falling piece.
+    bool locate(const Shape& piece, int& shape, int& orient, int& x, int& y) const;
+};
+
+// built on first use, after SHAPES exists
+const PieceTable& pieceTable();
+
+#endif // __PIECES_H__
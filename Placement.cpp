@@ -0,0 +1,172 @@
+#include "Placement.h"
+
+#include <cstring>
+
+using namespace std;
+
+const unsigned int BOARD_ROWS = (1u << NUM_ROWS) - 1;
+
+// Rows reached from gen by falling through pro, a Kogge-Stone fill
+// towards bit 0.
+static inline unsigned int fallThrough(unsigned int gen, unsigned int pro) {
+    gen |= pro & (gen >> 1);
+    pro &= pro >> 1;
+    gen |= pro & (gen >> 2);
+    pro &= pro >> 2;
+    gen |= pro & (gen >> 4);
+    pro &= pro >> 4;
+    gen |= pro & (gen >> 8);
+    pro &= pro >> 8;
+    gen |= pro & (gen >> 16);
+    return gen;
+}
+
+PlacementFinder::PlacementFinder() : _table(pieceTable()) {
+    // turns, with Shape::rotate's bounds correction: pushed right off the
+    // left wall and up off the floor, refused at the right wall and the top
+    for(int s=0; s<NUM_SHAPES; s++){
+        for(int o=0; o<MAX_ORIENTATIONS; o++){
+            int to = (o + 1) % _table.orientations[s];
+            const PieceTable::Box& b = _table.box[s][to];
+            int lo = b.minY < 0 ? -b.minY : 0;
+            int hi = NUM_ROWS - 1 - b.maxY;
+            _turnRows[s][o] = ((2u << hi) - 1) & ~((1u << lo) - 1);
+            _turnFloor[s][o] = (1u << lo) - 1;
+            for(int cx=0; cx<NUM_COLS; cx++){
+                bool turns = o < _table.orientations[s] && to != o && cx + b.maxX < NUM_COLS;
+                _turnTo[s][o][cx] = turns ? to * NUM_COLS + (cx + b.minX < 0 ? -b.minX : cx) : -1;
+            }
+        }
+    }
+}
+
+int PlacementFinder::find(const unsigned short* rows, int shape, int orient, int x, int y, Placement* out) {
+    memcpy(_rows, rows, sizeof(_rows));
+    _shape = shape;
+    _startOrient = orient;
+    _startX = x;
+    _startY = y;
+    if(_table.collides(rows, shape, orient, x, y)) return 0;
+
+    // the board a column at a time, with everything above the top taken
+    unsigned int cols[NUM_COLS];
+    for(int c=0; c<NUM_COLS; c++) cols[c] = ~BOARD_ROWS;
+    for(int r=0; r<NUM_ROWS; r++){
+        for(unsigned int bits = rows[r]; bits; bits &= bits - 1) cols[__builtin_ctz(bits)] |= 1u << r;
+    }
+
+    // bit y of _free[o][x] says the piece fits with its centre at (x, y)
+    const int orientations = _table.orientations[shape];
+    for(int o=0; o<orientations; o++){
+        const PieceTable::Box& b = _table.box[shape][o];
+        for(int cx=0; cx<NUM_COLS; cx++){
+            _reach[o][cx] = 0;
+            if(cx + b.minX < 0 || cx + b.maxX >= NUM_COLS){
+                _free[o][cx] = 0;
+                continue;
+            }
+            unsigned int blocked = 0;
+            for(int k=0; k<PIECE_CELLS; k++){
+                unsigned int col = cols[cx + _table.dx[shape][o][k]];
+                int dy = _table.dy[shape][o][k];
+                // below the floor counts as taken too
+                blocked |= dy >= 0 ? col >> dy : (col << -dy) | ((1u << -dy) - 1);
+            }
+            _free[o][cx] = ~blocked & BOARD_ROWS;
+        }
+    }
+
+    // columns still to spread from, bit o * NUM_COLS + x
+    _reach[orient][x] = 1u << y;
+    unsigned long long work = 1ull << (orient * NUM_COLS + x);
+    auto spread = [&](int o, int cx, unsigned int bits){
+        bits &= _free[o][cx] & ~_reach[o][cx];
+        if(bits == 0) return;
+        _reach[o][cx] |= bits;
+        work |= 1ull << (o * NUM_COLS + cx);
+    };
+
+    while(work){
+        int i = __builtin_ctzll(work);
+        work &= work - 1;
+        int o = i / NUM_COLS, cx = i % NUM_COLS;
+        unsigned int r = _reach[o][cx] = fallThrough(_reach[o][cx], _free[o][cx]);
+
+        if(cx > 0) spread(o, cx - 1, r);
+        if(cx < NUM_COLS - 1) spread(o, cx + 1, r);
+
+        int to = _turnTo[shape][o][cx];
+        if(to < 0) continue;
+        unsigned int turned = r & _turnRows[shape][o];
+        if(r & _turnFloor[shape][o]) turned |= _turnFloor[shape][o] + 1;
+        spread(to / NUM_COLS, to % NUM_COLS, turned);
+    }
+
+    // a reached position locks where the row below it is not free
+    int n = 0;
+    for(int o=0; o<orientations; o++){
+        for(int cx=0; cx<NUM_COLS; cx++){
+            for(unsigned int locks = _reach[o][cx] & ~(_free[o][cx] << 1); locks; locks &= locks - 1){
+                Placement& p = out[n++];
+                p.x = cx;
+                p.y = __builtin_ctz(locks);
+                p.orient = o;
+            }
+        }
+    }
+    return n;
+}
+
+int PlacementFinder::find(const Game& game, Placement* out) {
+    int shape, orient, x, y;
+    if(game.isOver() || !_table.locate(game.current(), shape, orient, x, y)) return 0;
+    BoardRows rows;
+    rowsFromCells(game.cells(), rows);
+    return find(rows, shape, orient, x, y, out);
+}
+
+//----------------------------------------------------------------------------
+
+static inline int stateIndex(int orient, int x, int y) {
+    return (orient * NUM_ROWS + y) * NUM_COLS + x;
+}
+
+int PlacementFinder::path(const Placement& p, Placement_move* moves, int max) {
+    const int s = _shape;
+    if(p.orient < 0 || p.orient >= _table.orientations[s] || p.x < 0 || p.x >= NUM_COLS ||
+       p.y < 0 || p.y >= NUM_ROWS || _table.collides(_rows, s, _startOrient, _startX, _startY)) return -1;
+
+    memset(_seen, 0, sizeof(_seen));
+    int start = stateIndex(_startOrient, _startX, _startY);
+    int target = stateIndex(p.orient, p.x, p.y);
+    int head = 0, tail = 0;
+    _queue[tail++] = start;
+    _seen[start >> 6] |= 1ull << (start & 63);
+
+    while(head < tail){
+        int at = _queue[head++];
+        if(at == target){
+            int len = 0;
+            for(int i=at; i!=start; i=_parent[i]) len++;
+            if(len > max) return -1;
+            for(int i=at, k=len; i!=start; i=_parent[i]) moves[--k] = Placement_move(_move[i]);
+            return len;
+        }
+
+        int x = at % NUM_COLS, y = at / NUM_COLS % NUM_ROWS, o = at / (NUM_COLS * NUM_ROWS);
+        for(int m=MOVE_LEFT; m<=MOVE_DOWN; m++){
+            int no = o, nx = x, ny = y;
+            if(m == MOVE_LEFT) nx--;
+            else if(m == MOVE_RIGHT) nx++;
+            else if(m == MOVE_DOWN) ny--;
+            if(m == MOVE_ROTATE ? !_table.rotate(_rows, s, no, nx, ny) : _table.collides(_rows, s, no, nx, ny)) continue;
+            int next = stateIndex(no, nx, ny);
+            if(_seen[next >> 6] & (1ull << (next & 63))) continue;
+            _seen[next >> 6] |= 1ull << (next & 63);
+            _parent[next] = at;
+            _move[next] = m;
+            _queue[tail++] = next;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,83 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- Placement.h ---
+//
+//   Every distinct position a piece can lock in, for bots and search.
+//   Reachable means reachable with the player's own moves - left, right,
+//   rotate and one row down, in any order and as many as it takes - so
+//   slides under overhangs and tucks after a turn are all found, with the
+//   Game's rotation rules exactly.
+//
+//   The search is a breadth-first flood over (orientation, x, y). Every
+//   piece has a cell on its centre, so the centre of a legal position is
+//   on the board, and the visited table is one bitset of rows per
+//   (orientation, column): a column's whole fall is one Kogge-Stone fill
+//   and a sideways move or a turn carries all of its rows over at once.
+//   A PlacementFinder keeps its tables inline and allocates nothing.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __PLACEMENT_H__
+#define __PLACEMENT_H__
+
+#include "Pieces.h"
+
+static_assert(NUM_ROWS < 32, "a column of rows is a 32 bit bitset");
+static_assert(MAX_ORIENTATIONS * NUM_COLS <= 64, "the column work list is a 64 bit bitset");
+
+struct Placement {
+    signed char x, y, orient;
+};
+
+enum Placement_move { MOVE_LEFT, MOVE_RIGHT, MOVE_ROTATE, MOVE_DOWN };
+
+const int PLACEMENT_STATES = MAX_ORIENTATIONS * NUM_ROWS * NUM_COLS;
+// bound on the results of one find(), and on the length of a path
+const int MAX_PLACEMENTS = PLACEMENT_STATES;
+
+class PlacementFinder {
+public:
+    PlacementFinder();
+
+    // Lock positions of shape starting from (orient, x, y), written to
+    // out, which must have room for MAX_PLACEMENTS. Returns how many there
+    // are, 0 when the start position itself is blocked.
+    int find(const unsigned short* rows, int shape, int orient, int x, int y, Placement* out);
+    // from the spawn position
+    int find(const unsigned short* rows, int shape, Placement* out) {
+        return find(rows, shape, 0, SPAWN_X, SPAWN_Y, out);
+    }
+    // for a Game's falling piece, from where it is now
+    int find(const Game& game, Placement* out);
+
+    // A shortest move sequence from the start of the last find() to p.
+    // Returns its length, or -1 when p can't be reached or the sequence
+    // needs more than max moves.
+    int path(const Placement& p, Placement_move* moves, int max);
+
+private:
+    const PieceTable& _table;
+
+    // the last find()
+    BoardRows _rows;
+    int _shape, _startOrient, _startX, _startY;
+
+    // rows where the piece fits, and rows reached, per orientation and x
+    unsigned int _free[MAX_ORIENTATIONS][NUM_COLS];
+    unsigned int _reach[MAX_ORIENTATIONS][NUM_COLS];
+
+    // per shape, orientation and x: the column a turn lands in, -1 when
+    // the turn is refused; the rows it keeps, and the rows below the
+    // lowest of those, which it lifts onto it
+    signed char _turnTo[NUM_SHAPES][MAX_ORIENTATIONS][NUM_COLS];
+    unsigned int _turnRows[NUM_SHAPES][MAX_ORIENTATIONS];
+    unsigned int _turnFloor[NUM_SHAPES][MAX_ORIENTATIONS];
+
+    // path(): one state per cell, (orient * NUM_ROWS + y) * NUM_COLS + x
+    unsigned long long _seen[(PLACEMENT_STATES + 63) / 64];
+    unsigned short _queue[PLACEMENT_STATES];
+    unsigned short _parent[PLACEMENT_STATES];
+    unsigned char _move[PLACEMENT_STATES];
+};
+
+#endif // __PLACEMENT_H__
@@ -0,0 +1,259 @@
+#include "Replay.h"
+#include "Varint.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+const unsigned char MAGIC[4] = { 'T', 'T', 'R', 'P' };
+const int CODE_BITS = 4;
+const unsigned int CODE_MASK = (1 << CODE_BITS) - 1;
+// codes up to INPUT_HARD_DROP are the Input itself
+const unsigned int CODE_KEYFRAME = 14;
+const unsigned int CODE_END = 15;
+
+bool isInputCode(unsigned int code) {
+    return code <= INPUT_HARD_DROP && code != INPUT_RESTART;
+}
+
+}
+
+//----------------------------------------------------------------------------
+
+void ReplayRecorder::begin(const Game& game) {
+    _bytes.assign(MAGIC, MAGIC + 4);
+    _keyTicks.clear();
+    _keyOffsets.clear();
+    _bytes.push_back(REPLAY_VERSION);
+    _bytes.push_back(NUM_COLS);
+    _bytes.push_back(NUM_ROWS);
+    putU32(_bytes, game.seed());
+    putVarint(_bytes, REPLAY_KEYFRAME_INTERVAL);
+    putVarint(_bytes, game.ticks());
+    _lastTick = game.ticks();
+    _recording = true;
+    // the seed alone can't get a player here
+    if(game.ticks() > 0) keyframe(game);
+}
+
+void ReplayRecorder::record(long long tick, unsigned int code) {
+    putVarint(_bytes, (unsigned long long)(tick - _lastTick) << CODE_BITS | code);
+    _lastTick = tick;
+}
+
+void ReplayRecorder::input(const Game& game, Input in) {
+    if(!_recording || in == INPUT_RESTART) return;
+    record(game.ticks(), in);
+}
+
+void ReplayRecorder::tick(const Game& game) {
+    if(!_recording || game.ticks() % REPLAY_KEYFRAME_INTERVAL != 0) return;
+    keyframe(game);
+}
+
+void ReplayRecorder::keyframe(const Game& game) {
+    _keyTicks.push_back(game.ticks());
+    _keyOffsets.push_back(_bytes.size());
+    record(game.ticks(), CODE_KEYFRAME);
+
+    vector<unsigned char> state;
+    game.writeState(state);
+    putVarint(_bytes, state.size());
+    _bytes.insert(_bytes.end(), state.begin(), state.end());
+}
+
+void ReplayRecorder::finish(const Game& game) {
+    if(!_recording) return;
+    size_t endOffset = _bytes.size();
+    record(game.ticks(), CODE_END);
+    _bytes.push_back(game.isOver());
+    putVarint(_bytes, game.ticks());
+    putVarint(_bytes, game.piecesPlaced());
+    putVarint(_bytes, game.linesCleared());
+    vector<unsigned char> state;
+    game.writeState(state);
+    putVarint(_bytes, state.size());
+    _bytes.insert(_bytes.end(), state.begin(), state.end());
+
+    putVarint(_bytes, _keyTicks.size());
+    long long tick = 0;
+    size_t offset = 0;
+    for(size_t i=0; i<_keyTicks.size(); i++){
+        putVarint(_bytes, _keyTicks[i] - tick);
+        putVarint(_bytes, _keyOffsets[i] - offset);
+        tick = _keyTicks[i];
+        offset = _keyOffsets[i];
+    }
+    putU32(_bytes, endOffset);
+    _recording = false;
+}
+
+bool ReplayRecorder::save(const char* path) const {
+    FILE* fp = fopen(path, "wb");
+    if(fp == NULL) return false;
+    fwrite(&_bytes[0], 1, _bytes.size(), fp);
+    return fclose(fp) == 0;
+}
+
+//----------------------------------------------------------------------------
+
+bool Replay::open(const unsigned char* data, size_t size) {
+    if(size < 12 || memcmp(data, MAGIC, 4) != 0 || data[4] != REPLAY_VERSION) return false;
+    if(data[5] != NUM_COLS || data[6] != NUM_ROWS) return false;
+    seed = getU32(data + 7);
+    const unsigned char* p = data + 11;
+    const unsigned char* end = data + size;
+    unsigned long long interval, start;
+    if(!getVarint(p, end, interval) || !getVarint(p, end, start)) return false;
+    (void)interval;     // implied by the keyframe index
+    _records = p;
+    const unsigned char* dataEnd = end - 4;
+
+    size_t endOffset = getU32(end - 4);
+    if(endOffset < size_t(p - data) || endOffset >= size - 4) return false;
+    _end = data + endOffset;
+
+    p = _end;
+    unsigned long long v, tick, pieces, lines, stateSize, count;
+    if(!getVarint(p, dataEnd, v) || (v & CODE_MASK) != CODE_END || p >= dataEnd) return false;
+    gameOver = *p++;
+    if(!getVarint(p, dataEnd, tick) || !getVarint(p, dataEnd, pieces)
+       || !getVarint(p, dataEnd, lines) || !getVarint(p, dataEnd, stateSize)) return false;
+    if(stateSize > size_t(dataEnd - p)) return false;
+    if(start > tick) return false;
+    startTick = start;
+    finalTick = tick;
+    piecesPlaced = pieces;
+    linesCleared = lines;
+    finalState = p;
+    finalStateSize = stateSize;
+    p += stateSize;
+
+    _keyframes.clear();
+    if(!getVarint(p, dataEnd, count)) return false;
+    long long keyTick = 0;
+    size_t offset = 0;
+    for(unsigned long long i=0; i<count; i++){
+        unsigned long long dt, doff;
+        if(!getVarint(p, dataEnd, dt) || !getVarint(p, dataEnd, doff)) return false;
+        keyTick += dt;
+        offset += doff;
+        if(offset < size_t(_records - data) || offset >= endOffset) return false;
+        _keyframes.push_back({ keyTick, data + offset });
+    }
+
+    // walk the records once so playback never reads past a bad length,
+    // and check the index against the keyframes actually found
+    Game check;
+    size_t key = 0;
+    tick = startTick;
+    for(p = _records; p < _end; ){
+        const unsigned char* record = p;
+        if(!getVarint(p, _end, v)) return false;
+        tick += v >> CODE_BITS;
+        if(tick > (unsigned long long)finalTick) return false;
+        if(isInputCode(v & CODE_MASK)) continue;
+        if((v & CODE_MASK) != CODE_KEYFRAME) return false;
+
+        if(key >= _keyframes.size() || _keyframes[key].record != record
+           || _keyframes[key].tick != (long long)tick) return false;
+        key++;
+        if(!getVarint(p, _end, stateSize) || stateSize > size_t(_end - p)) return false;
+        const unsigned char* state = p;
+        if(!check.readState(state, p + stateSize)) return false;
+        p += stateSize;
+    }
+    if(key != _keyframes.size()) return false;
+    // a recording that doesn't start from the seed opens with a keyframe
+    return startTick == 0 || (!_keyframes.empty() && _keyframes[0].record == _records);
+}
+
+//----------------------------------------------------------------------------
+
+ReplayPlayer::ReplayPlayer(const Replay& replay) : _replay(replay), _game(replay.seed) {
+    seek(0);
+}
+
+bool ReplayPlayer::nextRecord() {
+    _haveNext = false;
+    if(_p >= _replay._end) return false;
+    unsigned long long v;
+    if(!getVarint(_p, _replay._end, v)) return false;
+    _nextTick += v >> CODE_BITS;
+    _nextCode = v & CODE_MASK;
+    _haveNext = true;
+    return true;
+}
+
+void ReplayPlayer::seek(long long tick) {
+    tick = max(tick, _replay.startTick);
+    const auto& keys = _replay._keyframes;
+    auto it = upper_bound(keys.begin(), keys.end(), tick,
+                          [](long long t, const Replay::Keyframe& k){ return t < k.tick; });
+
+    if(it == keys.begin()){
+        _game.reset(_replay.seed);
+        _p = _replay._records;
+        _nextTick = 0;
+    }
+    else{
+        --it;
+        // restore the keyframe's state and continue right after it
+        _p = it->record;
+        unsigned long long v, n;
+        const unsigned char* state = nullptr;
+        if(getVarint(_p, _replay._end, v) && getVarint(_p, _replay._end, n)
+           && n <= size_t(_replay._end - _p)){
+            state = _p;
+            _p += n;
+        }
+        if(state != nullptr && _game.readState(state, _p)) _nextTick = it->tick;
+        else{
+            // open() has checked every keyframe; replay from the start
+            _game.reset(_replay.seed);
+            _p = _replay._records;
+            _nextTick = 0;
+        }
+    }
+    nextRecord();
+    while(_game.ticks() < tick && step()) {}
+}
+
+bool ReplayPlayer::step() {
+    applyDue();
+    if(atEnd() || _game.isOver()) return false;
+    _game.tick();
+    return true;
+}
+
+void ReplayPlayer::applyDue() {
+    while(_haveNext && _nextTick <= _game.ticks()){
+        if(_nextCode == CODE_KEYFRAME){
+            unsigned long long n;
+            if(!getVarint(_p, _replay._end, n) || n > size_t(_replay._end - _p)){
+                _haveNext = false;
+                return;
+            }
+            _p += n;
+        }
+        else if(isInputCode(_nextCode)) _game.input(Input(_nextCode));
+        nextRecord();
+    }
+}
+
+bool ReplayPlayer::verify() {
+    // step() stops at finalTick; the cap keeps a bad file from spinning
+    for(long long t = _game.ticks(); t <= _replay.finalTick && step(); t++) {}
+    vector<unsigned char> state;
+    _game.writeState(state);
+    return _game.ticks() == _replay.finalTick
+        && _game.isOver() == _replay.gameOver
+        && _game.piecesPlaced() == _replay.piecesPlaced
+        && _game.linesCleared() == _replay.linesCleared
+        && state.size() == _replay.finalStateSize
+        && memcmp(&state[0], _replay.finalState, state.size()) == 0;
+}
@@ -0,0 +1,130 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- Replay.h ---
+//
+//   Compact binary record of one game: the seed plus every input stamped
+//   with the tick it was applied before. Since Game is deterministic that
+//   is enough to reproduce it; periodic keyframes of the full state make
+//   seeking cost at most REPLAY_KEYFRAME_INTERVAL ticks of simulation.
+//
+//   Layout (integers are varints unless noted):
+//     header    "TTRP", version, cols, rows, seed (u32 LE), keyframe
+//               interval, start tick
+//     records   (tick delta << 4 | code) followed by
+//                 code 0-6   nothing, the code is the Input (restarts
+//                            are never recorded)
+//                 code 14    keyframe: state length, Game::writeState bytes
+//                 code 15    end: game over flag, final tick, pieces,
+//                            lines, state length, final state bytes
+//     index     count, then (tick delta, byte offset delta) per keyframe
+//     trailer   offset of the end record (u32 LE)
+//
+//   A recording begun partway into a game, after a rewind, opens with a
+//   keyframe at its start tick and plays back from there.
+//
+//   Typical games are a few hundred bytes to a few KB.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+#include "Game.h"
+
+#include <cstddef>
+#include <vector>
+
+const unsigned char REPLAY_VERSION = 3;
+const long long REPLAY_KEYFRAME_INTERVAL = 200;   // ticks, 10 s of play
+
+class ReplayRecorder {
+public:
+    // Starts a new recording of game, from its current state.
+    void begin(const Game& game);
+    // Call with the game before the input is applied to it.
+    void input(const Game& game, Input in);
+    // Call after every Game::tick.
+    void tick(const Game& game);
+    // Writes the end record, index and trailer.
+    void finish(const Game& game);
+
+    bool recording() const { return _recording; }
+    const std::vector<unsigned char>& bytes() const { return _bytes; }
+    bool save(const char* path) const;
+
+private:
+    void record(long long tick, unsigned int code);
+    void keyframe(const Game& game);
+
+    std::vector<unsigned char> _bytes;
+    std::vector<long long> _keyTicks;
+    std::vector<size_t> _keyOffsets;
+    long long _lastTick = 0;
+    bool _recording = false;
+};
+
+// Read-only view of a replay in memory. Does not copy or own the bytes, so
+// it can sit directly on a memory mapped file.
+class Replay {
+public:
+    // Parses header, end record and index and checks every record against
+    // them; false if the data is malformed.
+    bool open(const unsigned char* data, size_t size);
+
+    unsigned int seed = 0;
+    long long startTick = 0;    // 0 unless recorded after a rewind
+    long long finalTick = 0;
+    long long piecesPlaced = 0;
+    long long linesCleared = 0;
+    bool gameOver = false;
+
+    // Final state as written by Game::writeState.
+    const unsigned char* finalState = nullptr;
+    size_t finalStateSize = 0;
+
+private:
+    friend class ReplayPlayer;
+
+    struct Keyframe {
+        long long tick;
+        const unsigned char* record;
+    };
+
+    const unsigned char* _records = nullptr;
+    const unsigned char* _end = nullptr;     // start of the end record
+    std::vector<Keyframe> _keyframes;
+};
+
+class ReplayPlayer {
+public:
+    explicit ReplayPlayer(const Replay& replay);
+
+    const Game& game() const { return _game; }
+    long long tick() const { return _game.ticks(); }
+    bool atEnd() const { return _game.ticks() >= _replay.finalTick; }
+
+    // Applies the inputs due before the next tick, then ticks. False once
+    // the end of the recording has been reached (the last inputs are still
+    // applied), or the game is over; a game that ends early never reaches
+    // the recorded final tick.
+    bool step();
+    // Jumps to the given tick from the nearest keyframe at or before it;
+    // ticks before the start of the recording go to its start.
+    void seek(long long tick);
+    // Plays to the end and compares against the recorded result, the
+    // tick it ends on included.
+    bool verify();
+
+private:
+    bool nextRecord();
+    void applyDue();
+
+    const Replay& _replay;
+    Game _game;
+    const unsigned char* _p;
+    long long _nextTick;
+    unsigned int _nextCode;
+    bool _haveNext;
+};
+
+#endif // __REPLAY_H__
@@ -0,0 +1,55 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- Rewind.h ---
+//
+//   Fixed size history of recent states for undo and time travel. All
+//   storage lives inside the object, so push() is a plain copy into a
+//   preallocated slot: no allocation, cheap enough to run every tick.
+//   Stepping back and then pushing again drops the states that were
+//   ahead of the cursor, like an editor's undo stack.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __REWIND_H__
+#define __REWIND_H__
+
+template<typename T, int N>
+class RewindBuffer {
+public:
+    void clear() {
+        _oldest = 0;
+        _newest = -1;
+        _cursor = -1;
+    }
+
+    void push(const T& state) {
+        _newest = _cursor + 1;
+        _cursor = _newest;
+        if(_newest - _oldest >= N) _oldest = _newest - N + 1;
+        _states[_newest % N] = state;
+    }
+
+    // Moves the cursor one state back/forward and copies that state out.
+    // False (and out untouched) at either end of the history.
+    bool back(T& out) {
+        if(_cursor <= _oldest) return false;
+        out = _states[--_cursor % N];
+        return true;
+    }
+
+    bool forward(T& out) {
+        if(_cursor >= _newest) return false;
+        out = _states[++_cursor % N];
+        return true;
+    }
+
+    // states behind and ahead of the cursor
+    long long behind() const { return _cursor - _oldest; }
+    long long ahead() const { return _newest - _cursor; }
+
+private:
+    T _states[N];
+    long long _oldest = 0, _newest = -1, _cursor = -1;
+};
+
+#endif // __REWIND_H__
@@ -0,0 +1,156 @@
+#include "ServerProtocol.h"
+#include "Varint.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+void renderView(const Game& game, BoardView& view) {
+    memcpy(view, game.cells(), VIEW_CELLS);
+    const Shape& piece = game.current();
+    for(const coord& v: piece.getPos()){
+        if(v.x >= 0 && v.x < NUM_COLS && v.y >= 0 && v.y < NUM_ROWS){
+            view[v.y * NUM_COLS + v.x] = VIEW_PIECE + piece.getColor();
+        }
+    }
+}
+
+bool encodeDelta(const BoardView& from, bool fromOver, const BoardView& to, bool toOver,
+                 long long tick, vector<unsigned char>& out) {
+    int count = 0;
+    for(int i=0; i<VIEW_CELLS; i++) count += from[i] != to[i];
+    if(count == 0 && fromOver == toOver) return false;
+
+    size_t start = out.size();
+    out.push_back(0);
+    out.push_back(0);
+    putVarint(out, tick);
+    out.push_back(toOver ? 1 : 0);
+    putVarint(out, count);
+    for(int i=0; i<VIEW_CELLS; i++){
+        if(from[i] == to[i]) continue;
+        out.push_back(i);
+        out.push_back(to[i]);
+    }
+    size_t length = out.size() - start - 2;
+    out[start] = length & 0xFF;
+    out[start + 1] = length >> 8;
+    return true;
+}
+
+int applyDelta(const unsigned char* p, const unsigned char* end, BoardView& view,
+               long long& tick, bool& over) {
+    if(end - p < 2) return 0;
+    int length = p[0] | (p[1] << 8);
+    if(length > MAX_DELTA_BYTES) return -1;
+    if(end - p < 2 + length) return 0;
+
+    const unsigned char* q = p + 2;
+    const unsigned char* msgEnd = q + length;
+    unsigned long long t, count;
+    if(!getVarint(q, msgEnd, t) || q == msgEnd) return -1;
+    unsigned char flags = *q++;
+    if(!getVarint(q, msgEnd, count) || count > VIEW_CELLS || (unsigned long long)(msgEnd - q) != 2 * count) return -1;
+    for(unsigned long long i=0; i<count; i++, q+=2){
+        if(q[0] >= VIEW_CELLS) return -1;
+        view[q[0]] = q[1];
+    }
+    tick = t;
+    over = flags & 1;
+    return 2 + length;
+}
+
+//----------------------------------------------------------------------------
+
+bool parseAddress(const string& text, SocketAddress& addr) {
+    if(text.compare(0, 5, "unix:") == 0){
+        addr.unixSocket = true;
+        addr.path = text.substr(5);
+        return !addr.path.empty() && addr.path.size() < sizeof(sockaddr_un().sun_path);
+    }
+    if(text.compare(0, 4, "tcp:") == 0){
+        size_t colon = text.rfind(':');
+        addr.unixSocket = false;
+        if(colon > 4) addr.host = text.substr(4, colon - 4);
+        addr.port = atoi(text.c_str() + colon + 1);
+        return addr.port > 0 && addr.port < 65536;
+    }
+    return false;
+}
+
+// fills whichever sockaddr the address needs, returns its size or 0
+static socklen_t makeSockaddr(const SocketAddress& addr, sockaddr_storage& storage) {
+    memset(&storage, 0, sizeof(storage));
+    if(addr.unixSocket){
+        sockaddr_un* un = (sockaddr_un*)&storage;
+        un->sun_family = AF_UNIX;
+        strncpy(un->sun_path, addr.path.c_str(), sizeof(un->sun_path) - 1);
+        return sizeof(sockaddr_un);
+    }
+    sockaddr_in* in = (sockaddr_in*)&storage;
+    in->sin_family = AF_INET;
+    in->sin_port = htons(addr.port);
+    if(inet_pton(AF_INET, addr.host.c_str(), &in->sin_addr) != 1) return 0;
+    return sizeof(sockaddr_in);
+}
+
+int listenOn(const SocketAddress& addr) {
+    sockaddr_storage storage;
+    socklen_t size = makeSockaddr(addr, storage);
+    if(size == 0){
+        cerr<<"Bad address "<<addr.host<<endl;
+        return -1;
+    }
+    int fd = socket(addr.unixSocket ? AF_UNIX : AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd < 0) return -1;
+    if(addr.unixSocket) unlink(addr.path.c_str());
+    else {
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    }
+    if(bind(fd, (sockaddr*)&storage, size) < 0 || listen(fd, SOMAXCONN) < 0){
+        cerr<<"Failed to listen: "<<strerror(errno)<<endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int connectTo(const SocketAddress& addr) {
+    sockaddr_storage storage;
+    socklen_t size = makeSockaddr(addr, storage);
+    if(size == 0) return -1;
+    int fd = socket(addr.unixSocket ? AF_UNIX : AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd < 0) return -1;
+    if(connect(fd, (sockaddr*)&storage, size) < 0 ||
+       fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0){
+        close(fd);
+        return -1;
+    }
+    if(!addr.unixSocket){
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    return fd;
+}
+
+long long raiseFileLimit() {
+    rlimit limit;
+    if(getrlimit(RLIMIT_NOFILE, &limit) < 0) return 0;
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    getrlimit(RLIMIT_NOFILE, &limit);
+    return limit.rlim_cur;
+}
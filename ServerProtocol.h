@@ -0,0 +1,64 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- ServerProtocol.h ---
+//
+//   Wire format between tetris-server and its thin clients over a Unix
+//   or TCP stream socket. One connection is one game.
+//
+//   client -> server: one byte per key press, an Input value.
+//   server -> client: after each tick that changed the picture, a delta
+//       u16 length of the rest, varint tick, u8 flags (1 = game over),
+//       varint count, then count pairs of u8 cell index (row * NUM_COLS
+//       + col) and u8 new value.
+//
+//   Cell values are EMPTY_CELL, palette index + 1 for settled cells and
+//   VIEW_PIECE + palette index + 1 for the falling piece. The first delta
+//   of a connection is against an empty board.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __SERVERPROTOCOL_H__
+#define __SERVERPROTOCOL_H__
+
+#include "Game.h"
+
+#include <string>
+#include <vector>
+
+const int VIEW_CELLS = NUM_ROWS * NUM_COLS;
+const unsigned char VIEW_PIECE = 0x10;
+// longest possible delta: length, tick, flags, count and every cell
+const int MAX_DELTA_BYTES = 2 + 10 + 1 + 2 + 2 * VIEW_CELLS;
+
+typedef unsigned char BoardView[VIEW_CELLS];
+
+void renderView(const Game& game, BoardView& view);
+
+// Appends the delta taking a client from `from` to `to` and returns true,
+// or appends nothing and returns false when there is no difference.
+bool encodeDelta(const BoardView& from, bool fromOver, const BoardView& to, bool toOver,
+                 long long tick, std::vector<unsigned char>& out);
+
+// Applies the delta at the start of [p, end) to view. Returns the bytes
+// it took, 0 when the message is still incomplete, -1 when malformed.
+int applyDelta(const unsigned char* p, const unsigned char* end, BoardView& view,
+               long long& tick, bool& over);
+
+// "unix:<path>" or "tcp:<host>:<port>"
+struct SocketAddress {
+    bool unixSocket = false;
+    std::string path;
+    std::string host = "127.0.0.1";
+    int port = 0;
+};
+
+bool parseAddress(const std::string& text, SocketAddress& addr);
+// non-blocking listening socket, -1 on failure (with a message on cerr)
+int listenOn(const SocketAddress& addr);
+// connected non-blocking socket, -1 on failure
+int connectTo(const SocketAddress& addr);
+// Thousands of sessions need thousands of descriptors; lifts the soft
+// limit to the hard one and returns the result.
+long long raiseFileLimit();
+
+#endif // __SERVERPROTOCOL_H__
@@ -0,0 +1,222 @@
+#include "SoftRaster.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+const float SUBPIXEL_STEPS = 256.0f;
+
+unsigned char toUnorm8(float c) {
+    return (unsigned char)lrintf(max(0.0f, min(1.0f, c)) * 255.0f);
+}
+
+struct Color {
+    unsigned char r, g, b;
+};
+
+Color paletteColor(unsigned char cell) {
+    const float* c = PALETTE[cell - 1];
+    return { toUnorm8(c[0]), toUnorm8(c[1]), toUnorm8(c[2]) };
+}
+
+// viewport transform followed by the subpixel snap the rasterizer applies
+float windowX(float ndc, int width) {
+    float w = (ndc * 0.5f + 0.5f) * width;
+    return roundf(w * SUBPIXEL_STEPS) / SUBPIXEL_STEPS;
+}
+
+float windowY(float ndc, int height) {
+    float w = (ndc * 0.5f + 0.5f) * height;
+    return roundf(w * SUBPIXEL_STEPS) / SUBPIXEL_STEPS;
+}
+
+// first pixel whose centre is >= edge, i.e. the half-open [lo, hi) rule
+int firstCovered(float edge) {
+    return (int)ceilf(edge - 0.5f);
+}
+
+struct Tile {
+    Image& image;
+    int y0, y1;     // GL window rows
+
+    void fill(float x0, float x1, float yLo, float yHi, Color c) {
+        int px0 = max(0, firstCovered(x0));
+        int px1 = min(image.width, firstCovered(x1));
+        int py0 = max(y0, firstCovered(yLo));
+        int py1 = min(y1, firstCovered(yHi));
+        for(int y=py0; y<py1; y++){
+            unsigned char* row = &image.rgb[size_t(image.height - 1 - y) * image.width * 3];
+            for(int x=px0; x<px1; x++){
+                row[x*3] = c.r;
+                row[x*3+1] = c.g;
+                row[x*3+2] = c.b;
+            }
+        }
+    }
+
+    // quad as built by appendPoints/recomputePoints
+    void cell(int col, int row, Color c) {
+        float x = col * diffX - cornerX;
+        float y = row * diffY - cornerY;
+        fill(windowX(x, image.width), windowX(x + diffX, image.width),
+             windowY(y, image.height), windowY(y + diffY, image.height), c);
+    }
+
+    // axis aligned GL_LINES segment, one pixel wide
+    void line(const float a[2], const float b[2], Color c) {
+        float ax = windowX(a[0], image.width), ay = windowY(a[1], image.height);
+        float bx = windowX(b[0], image.width), by = windowY(b[1], image.height);
+        if(ax == bx) fill(ax - 0.5f, ax + 0.5f, min(ay, by), max(ay, by), c);
+        else fill(min(ax, bx), max(ax, bx), ay - 0.5f, ay + 0.5f, c);
+    }
+};
+
+}
+
+void rasterizeRows(const BoardSnapshot& snap, Image& image, int y0, int y1) {
+    for(int y=y0; y<y1; y++){
+        unsigned char* row = &image.rgb[size_t(image.height - 1 - y) * image.width * 3];
+        fill(row, row + image.width * 3, 0);
+    }
+
+    Tile tile = { image, y0, y1 };
+
+    // same order as display(): ghost, current piece, ground, grid
+    if(snap.pieceCells){
+        Color c = paletteColor(snap.pieceColor);
+        float ghost[NUM_GHOST_POINTS][2];
+        int n = ghostLinePoints(snap, ghost);
+        for(int i=0; i<n; i+=2) tile.line(ghost[i], ghost[i+1], c);
+        for(int k=0; k<snap.pieceCells; k++) tile.cell(snap.pieceX[k], snap.pieceY[k], c);
+    }
+    for(int i=0; i<NUM_ROWS; i++){
+        for(int j=0; j<NUM_COLS; j++){
+            if(snap.cells[i][j] != EMPTY_CELL) tile.cell(j, i, paletteColor(snap.cells[i][j]));
+        }
+    }
+
+    float grid[NUM_GRID_LINE_POINTS][2];
+    gridLinePoints(grid);
+    Color lineColor = { toUnorm8(GRID_LINE_COLOR[0]), toUnorm8(GRID_LINE_COLOR[1]), toUnorm8(GRID_LINE_COLOR[2]) };
+    for(int i=0; i<NUM_GRID_LINE_POINTS; i+=2) tile.line(grid[i], grid[i+1], lineColor);
+}
+
+void rasterizeBoard(const BoardSnapshot& snap, Image& image, int threads) {
+    threads = max(1, min(threads, image.height));
+    if(threads == 1){
+        rasterizeRows(snap, image, 0, image.height);
+        return;
+    }
+
+    vector<thread> workers;
+    int rowsPerTile = (image.height + threads - 1) / threads;
+    for(int y=0; y<image.height; y+=rowsPerTile){
+        int y1 = min(image.height, y + rowsPerTile);
+        workers.emplace_back([&snap, &image, y, y1]{ rasterizeRows(snap, image, y, y1); });
+    }
+    for(auto& t: workers) t.join();
+}
+
+//----------------------------------------------------------------------------
+
+bool writePPM(const Image& image, const char* path) {
+    FILE* fp = fopen(path, "wb");
+    if(fp == NULL) return false;
+    fprintf(fp, "P6\n%d %d\n255\n", image.width, image.height);
+    fwrite(&image.rgb[0], 1, image.rgb.size(), fp);
+    return fclose(fp) == 0;
+}
+
+namespace {
+
+struct CrcTable {
+    unsigned int entries[256];
+
+    CrcTable() {
+        for(unsigned int i=0; i<256; i++){
+            unsigned int c = i;
+            for(int k=0; k<8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entries[i] = c;
+        }
+    }
+};
+
+unsigned int crc32(const unsigned char* data, size_t n) {
+    static const CrcTable table;
+    unsigned int crc = 0xFFFFFFFFu;
+    for(size_t i=0; i<n; i++) crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+void put32(vector<unsigned char>& out, unsigned int v) {
+    out.push_back(v >> 24);
+    out.push_back(v >> 16);
+    out.push_back(v >> 8);
+    out.push_back(v);
+}
+
+void writeChunk(FILE* fp, const char* type, const vector<unsigned char>& data) {
+    vector<unsigned char> chunk;
+    put32(chunk, data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    put32(chunk, crc32(&chunk[4], chunk.size() - 4));
+    fwrite(&chunk[0], 1, chunk.size(), fp);
+}
+
+}
+
+bool writePNG(const Image& image, const char* path) {
+    FILE* fp = fopen(path, "wb");
+    if(fp == NULL) return false;
+
+    static const unsigned char SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    fwrite(SIGNATURE, 1, 8, fp);
+
+    vector<unsigned char> header;
+    put32(header, image.width);
+    put32(header, image.height);
+    header.push_back(8);    // bit depth
+    header.push_back(2);    // truecolour
+    header.push_back(0);
+    header.push_back(0);
+    header.push_back(0);
+    writeChunk(fp, "IHDR", header);
+
+    // scanlines with filter byte 0, wrapped in stored deflate blocks
+    size_t rowBytes = size_t(image.width) * 3;
+    vector<unsigned char> raw;
+    raw.reserve((rowBytes + 1) * image.height);
+    for(int y=0; y<image.height; y++){
+        raw.push_back(0);
+        raw.insert(raw.end(), image.rgb.begin() + y * rowBytes, image.rgb.begin() + (y + 1) * rowBytes);
+    }
+
+    vector<unsigned char> z = { 0x78, 0x01 };
+    const size_t MAX_BLOCK = 65535;
+    for(size_t pos=0; pos<raw.size() || pos==0; pos+=MAX_BLOCK){
+        size_t n = min(MAX_BLOCK, raw.size() - pos);
+        z.push_back(pos + n >= raw.size() ? 1 : 0);
+        z.push_back(n & 0xFF);
+        z.push_back(n >> 8);
+        z.push_back(~n & 0xFF);
+        z.push_back((~n >> 8) & 0xFF);
+        z.insert(z.end(), raw.begin() + pos, raw.begin() + pos + n);
+        if(n == 0) break;
+    }
+    unsigned int a = 1, b = 0;
+    for(unsigned char c: raw){
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+    put32(z, (b << 16) | a);
+    writeChunk(fp, "IDAT", z);
+    writeChunk(fp, "IEND", vector<unsigned char>());
+
+    return fclose(fp) == 0;
+}
@@ -0,0 +1,41 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- SoftRaster.h ---
+//
+//   CPU renderer for board snapshots, no GL context required. It draws the
+//   same geometry as display() and follows the rules the GL rasterizers we
+//   ship on use (Mesa softpipe/llvmpipe): vertices snapped to 1/256 pixel,
+//   pixel centres at +0.5, half-open fill rule for the cell quads and
+//   one pixel wide lines treated as quads around the segment. At the
+//   default window size the output matches a glReadPixels of the game.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __SOFTRASTER_H__
+#define __SOFTRASTER_H__
+
+#include "Board.h"
+
+#include <vector>
+
+// 8 bit RGB, rows stored top-down like PPM/PNG expect
+struct Image {
+    int width = 0, height = 0;
+    std::vector<unsigned char> rgb;
+
+    Image() {}
+    Image(int w, int h) : width(w), height(h), rgb(size_t(w) * h * 3) {}
+};
+
+// Renders the window rows [y0, y1) in GL window coordinates (row 0 at the
+// bottom). Tiles never overlap so they can be filled from different threads.
+void rasterizeRows(const BoardSnapshot& snap, Image& image, int y0, int y1);
+
+// Renders the whole image, split into horizontal tiles across threads.
+void rasterizeBoard(const BoardSnapshot& snap, Image& image, int threads = 1);
+
+bool writePPM(const Image& image, const char* path);
+// Uncompressed (stored deflate) PNG, so no zlib is needed.
+bool writePNG(const Image& image, const char* path);
+
+#endif // __SOFTRASTER_H__
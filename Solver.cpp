@@ -0,0 +1,352 @@
+#include "Solver.h"
+
+#include <chrono>
+#include <cstring>
+#include <istream>
+#include <sstream>
+
+using namespace std;
+
+bool readPuzzle(istream& in, Puzzle& puzzle, string& error) {
+    puzzle = Puzzle();
+    error.clear();
+    bool started = false;
+    string line;
+    while(getline(in, line)){
+        if(line.empty() || line[0] == '#') continue;
+        started = true;
+        istringstream words(line);
+        string key;
+        words>>key;
+        if(key == "pieces"){
+            string letters;
+            words>>letters;
+            puzzle.pieces.clear();
+            for(char c: letters){
+                int s = shapeFromName(c);
+                if(s < 0){
+                    error = string("unknown piece ") + c;
+                    return false;
+                }
+                puzzle.pieces.push_back(s);
+            }
+            continue;
+        }
+        if(key == "lines"){
+            if(!(words>>puzzle.targetLines) || puzzle.targetLines < 0){
+                error = "bad line count";
+                return false;
+            }
+            continue;
+        }
+
+        // anything else is the first row of the board
+        stringstream board;
+        board<<line<<"\n";
+        for(int r=1; r<NUM_ROWS && getline(in, line); r++) board<<line<<"\n";
+        BoardSnapshot snap;
+        if(!readBoardText(board, snap)){
+            error = "bad board";
+            return false;
+        }
+        rowsFromCells(snap.cells, puzzle.rows);
+        if(puzzle.pieces.empty() || (int)puzzle.pieces.size() > MAX_PUZZLE_PIECES){
+            error = "need 1 to " + to_string(MAX_PUZZLE_PIECES) + " pieces";
+            return false;
+        }
+        // the game clears a row as it fills, so a full one can't be there
+        for(int r=0; r<NUM_ROWS; r++){
+            if(puzzle.rows[r] == FULL_ROW){
+                error = "board has a full row";
+                return false;
+            }
+        }
+        return true;
+    }
+    if(started) error = "no board";
+    return false;
+}
+
+static bool emptyBoard(const unsigned short* rows) {
+    for(int r=0; r<NUM_ROWS; r++){
+        if(rows[r]) return false;
+    }
+    return true;
+}
+
+bool checkSolution(const Puzzle& puzzle, const vector<Placement>& placements) {
+    if(placements.size() > puzzle.pieces.size()) return false;
+    const PieceTable& t = pieceTable();
+    PlacementFinder finder;
+    static thread_local Placement out[MAX_PLACEMENTS];
+    BoardRows rows;
+    memcpy(rows, puzzle.rows, sizeof(rows));
+    int lines = 0;
+    auto done = [&]{ return puzzle.targetLines > 0 ? lines >= puzzle.targetLines : emptyBoard(rows); };
+    for(size_t i=0; i<placements.size(); i++){
+        if(done()) return false;
+        const Placement& p = placements[i];
+        int shape = puzzle.pieces[i];
+        int n = finder.find(rows, shape, out);
+        bool reachable = false;
+        for(int k=0; k<n && !reachable; k++) reachable = out[k].x == p.x && out[k].y == p.y && out[k].orient == p.orient;
+        if(!reachable) return false;
+        lines += t.lock(rows, shape, p.orient, p.x, p.y);
+    }
+    return done();
+}
+
+//----------------------------------------------------------------------------
+
+// the generation goes in the top 16 bits, a slot of another generation
+// being free
+const int KEY_BITS = 48;
+const unsigned long long MAX_GENERATION = (1ull << (64 - KEY_BITS)) - 1;
+const int PROBES = 8;
+
+VisitedSet::VisitedSet(size_t megabytes) {
+    size_t n = PROBES;
+    while(n * 2 * sizeof(unsigned long long) <= (megabytes << 20)) n *= 2;
+    _entries = new atomic<unsigned long long>[n];
+    _mask = n - 1;
+    for(size_t i=0; i<n; i++) _entries[i].store(0, memory_order_relaxed);
+}
+
+VisitedSet::~VisitedSet() {
+    delete[] _entries;
+}
+
+void VisitedSet::clear() {
+    if(_generation == MAX_GENERATION){
+        for(size_t i=0; i<=_mask; i++) _entries[i].store(0, memory_order_relaxed);
+        _generation = 0;
+    }
+    _generation++;
+}
+
+bool VisitedSet::insert(unsigned long long key) {
+    unsigned long long mine = _generation << KEY_BITS | (key >> (64 - KEY_BITS));
+    for(int i=0; i<PROBES; i++){
+        atomic<unsigned long long>& e = _entries[(key + i) & _mask];
+        unsigned long long seen = e.load(memory_order_relaxed);
+        if(seen == mine) return false;
+        if(seen >> KEY_BITS == _generation) continue;
+        if(e.compare_exchange_strong(seen, mine, memory_order_relaxed)) return true;
+        // another thread took the slot first, maybe with this key
+        if(seen == mine) return false;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------
+
+// the board, the pieces placed and the lines cleared on the way, mixed
+static unsigned long long stateKey(const unsigned short* rows, int level, int lines) {
+    return hashRows(rows, (unsigned long long)level << 32 | (unsigned int)lines);
+}
+
+Solver::Solver(int threads, size_t visitedMegabytes)
+    : _pool(threads < 1 ? 1 : threads), _visited(visitedMegabytes) {
+    for(int i=0; i<_pool.size(); i++) _workers.push_back(new Worker());
+}
+
+Solver::~Solver() {
+    for(Worker* w: _workers) delete w;
+}
+
+// A lower bound on the cells still to be placed: every row that is to be
+// cleared needs its empty cells filled, and a row cleared is one of the
+// board's rows or a new one from the top. 0 once the puzzle is solved,
+// more than any sequence has when it can't be.
+int Solver::cellsNeeded(const unsigned short* rows, int lines) const {
+    if(_puzzle->targetLines == 0){
+        int need = 0, filled = 0;
+        for(int r=0; r<NUM_ROWS; r++){
+            int n = bitCount(rows[r]);
+            filled += n;
+            if(n) need += NUM_COLS - n;
+        }
+        // and the board only empties when the cells on it are whole rows
+        for(int used=(need + PIECE_CELLS - 1) / PIECE_CELLS * PIECE_CELLS; used<=PIECE_CELLS * _length; used+=PIECE_CELLS){
+            if((filled + used) % NUM_COLS == 0) return used;
+        }
+        return PIECE_CELLS * _length + 1;
+    }
+
+    // the cheapest rows to fill first
+    int gaps[NUM_COLS + 1] = {};
+    for(int r=0; r<NUM_ROWS; r++) gaps[NUM_COLS - bitCount(rows[r])]++;
+    int left = _puzzle->targetLines - lines, need = 0;
+    for(int g=1; g<=NUM_COLS && left > 0; g++){
+        int n = g == NUM_COLS ? left : min(left, gaps[g]);
+        need += n * g;
+        left -= n;
+    }
+    return need;
+}
+
+void Solver::found(const Worker& w, int level) {
+    lock_guard<mutex> guard(_solutionLock);
+    if(!_solved){
+        _solution.assign(w.path, w.path + level);
+        _solved = true;
+    }
+    _stop = true;
+}
+
+// Searches below a board that isn't solved and can still be, with pieces
+// left. True once the search should stop, the puzzle solved or the node
+// budget spent.
+bool Solver::search(Worker& w, const unsigned short* rows, int level, int lines) {
+    if(_stop.load(memory_order_relaxed)) return true;
+    w.stats.nodes++;
+    if(_maxNodes && ++w.sinceCount == 1024){
+        w.sinceCount = 0;
+        if((_nodes += 1024) >= _maxNodes){
+            _gaveUp = true;
+            _stop = true;
+            return true;
+        }
+    }
+    if(!_visited.insert(stateKey(rows, level, lines))){
+        w.stats.repeats++;
+        return false;
+    }
+
+    // every placement's board, the ones that can still finish tried in
+    // order of the cells they still need, with a penalty for holes
+    const PieceTable& t = pieceTable();
+    int shape = _puzzle->pieces[level];
+    Placement* out = w.out[level];
+    Worker::Child* children = w.children[level];
+    int n = w.finder.find(rows, shape, out);
+    int cells = PIECE_CELLS * (_length - level - 1), kept = 0;
+    for(int i=0; i<n; i++){
+        Worker::Child& c = children[kept];
+        memcpy(c.rows, rows, sizeof(c.rows));
+        c.lines = lines + t.lock(c.rows, shape, out[i].orient, out[i].x, out[i].y);
+        int need = cellsNeeded(c.rows, c.lines);
+        c.placement = out[i];
+        if(need == 0){
+            w.path[level] = out[i];
+            found(w, level + 1);
+            return true;
+        }
+        if(need > cells){
+            w.stats.cutoffs++;
+            continue;
+        }
+        // holes make a board harder to clear than its count says
+        int holes = 0;
+        for(int r=NUM_ROWS-2, covered=c.rows[NUM_ROWS-1]; r>=0; r--){
+            holes += bitCount(~c.rows[r] & covered & FULL_ROW);
+            covered |= c.rows[r];
+        }
+        c.order = need + 2 * holes;
+        // insertion sort, keeping the finder's order among equals
+        int k = kept++;
+        Worker::Child moving = c;
+        for(; k>0 && children[k-1].order > moving.order; k--) children[k] = children[k-1];
+        children[k] = moving;
+    }
+
+    for(int i=0; i<kept; i++){
+        // a thread is waiting: the placements not started on go on this
+        // thread's queue, next one last, so it can take them
+        if(i + 1 < kept && _hungry.load(memory_order_relaxed) > 0){
+            lock_guard<mutex> guard(w.lock);
+            for(int j=kept-1; j>i; j--){
+                w.tasks.emplace_back();
+                Task& task = w.tasks.back();
+                memcpy(task.rows, children[j].rows, sizeof(task.rows));
+                task.lines = children[j].lines;
+                task.level = level + 1;
+                memcpy(task.path, w.path, level * sizeof(Placement));
+                task.path[level] = children[j].placement;
+                _pending++;
+            }
+            kept = i + 1;
+        }
+        w.path[level] = children[i].placement;
+        if(search(w, children[i].rows, level + 1, children[i].lines)) return true;
+    }
+    return false;
+}
+
+// The newest task on the thread's own queue, or else the oldest on
+// another's. False when there are none left anywhere.
+bool Solver::takeTask(int thread, Task& task) {
+    Worker& me = *_workers[thread];
+    {
+        lock_guard<mutex> guard(me.lock);
+        if(!me.tasks.empty()){
+            task = me.tasks.back();
+            me.tasks.pop_back();
+            return true;
+        }
+    }
+    _hungry++;
+    int n = _workers.size();
+    while(!_stop.load(memory_order_relaxed) && _pending.load() > 0){
+        for(int k=1; k<n; k++){
+            Worker& victim = *_workers[(thread + k) % n];
+            lock_guard<mutex> guard(victim.lock);
+            if(victim.tasks.empty()) continue;
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            me.stats.steals++;
+            _hungry--;
+            return true;
+        }
+        this_thread::yield();
+    }
+    _hungry--;
+    return false;
+}
+
+Solver::Result Solver::solve(const Puzzle& puzzle, long long maxNodes) {
+    auto start = chrono::steady_clock::now();
+    _puzzle = &puzzle;
+    _length = min((int)puzzle.pieces.size(), MAX_PUZZLE_PIECES);
+    _maxNodes = maxNodes;
+    _nodes = 0;
+    _stop = false;
+    _solved = false;
+    _gaveUp = false;
+    _solution.clear();
+    _visited.clear();
+    for(Worker* w: _workers){
+        w->stats = SolverStats();
+        w->sinceCount = 0;
+        w->tasks.clear();
+    }
+
+    Result result;
+    int need = cellsNeeded(puzzle.rows, 0);
+    if(need == 0) _solved = true;
+    else if(need <= PIECE_CELLS * _length){
+        _workers[0]->tasks.emplace_back();
+        Task& root = _workers[0]->tasks.back();
+        memcpy(root.rows, puzzle.rows, sizeof(root.rows));
+        root.level = 0;
+        root.lines = 0;
+        _pending = 1;
+    }
+    else result.stats.cutoffs++;
+
+    _pool.run([this](int thread){
+        Worker& w = *_workers[thread];
+        Task task;
+        while(takeTask(thread, task)){
+            memcpy(w.path, task.path, task.level * sizeof(Placement));
+            if(search(w, task.rows, task.level, task.lines)) _stop = true;
+            _pending--;
+        }
+    });
+
+    result.outcome = _solved ? SOLVED : _gaveUp ? GAVE_UP : NO_SOLUTION;
+    result.placements = _solution;
+    for(Worker* w: _workers) result.stats.add(w->stats);
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return result;
+}
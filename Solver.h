@@ -0,0 +1,165 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- Solver.h ---
+//
+//   Puzzles: a board and a fixed sequence of pieces, to be placed in
+//   order until the board is empty or a given number of lines has been
+//   cleared. The Solver answers with a placement for each piece used, or
+//   shows there is none by trying them all.
+//
+//   The search is a depth-first walk over the placements on all cores.
+//   Each thread works from its own queue of subtrees, newest first. A
+//   thread with nothing to do takes the oldest subtree off another's
+//   queue, which is the largest one, and while any thread is waiting, a
+//   busy thread hands over the siblings it hasn't started on yet.
+//   Boards already searched at the same piece and line count are kept in
+//   a set shared by all threads without locks, so a position reached in
+//   two orders is only searched once. Branches that can't add enough
+//   cells to finish are cut off without being searched.
+//
+//   The set holds 48 bit keys. A collision can cut off a live branch,
+//   which at the set's sizes is around one puzzle in ten million; a
+//   solution found is always real, and tools check it anyway.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __SOLVER_H__
+#define __SOLVER_H__
+
+#include "JobPool.h"
+#include "Placement.h"
+
+#include <atomic>
+#include <deque>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+
+const int MAX_PUZZLE_PIECES = 64;
+
+struct Puzzle {
+    BoardRows rows = {};
+    std::vector<int> pieces;
+    // lines to clear; 0 to clear the board instead
+    int targetLines = 0;
+};
+
+// Text form: optional "pieces <letters from SHAPE_NAMES>" and "lines <n>"
+// lines, then the board as readBoardText takes it. '#' lines and blank
+// lines between puzzles are skipped. False at the end of the stream;
+// also on a malformed puzzle, with error set.
+bool readPuzzle(std::istream& in, Puzzle& puzzle, std::string& error);
+
+// Whether placing the pieces in order from the puzzle's board meets its
+// goal, and no piece is placed after it is met.
+bool checkSolution(const Puzzle& puzzle, const std::vector<Placement>& placements);
+
+struct SolverStats {
+    long long nodes = 0;        // boards searched
+    long long repeats = 0;      // boards found in the visited set
+    long long cutoffs = 0;      // boards that can't finish in time
+    long long steals = 0;       // subtrees taken from another thread
+
+    void add(const SolverStats& other) {
+        nodes += other.nodes;
+        repeats += other.repeats;
+        cutoffs += other.cutoffs;
+        steals += other.steals;
+    }
+};
+
+class VisitedSet {
+public:
+    // rounded down to a power of two entries
+    explicit VisitedSet(size_t megabytes);
+    ~VisitedSet();
+    VisitedSet(const VisitedSet&) = delete;
+    VisitedSet& operator=(const VisitedSet&) = delete;
+
+    // Forgets everything, in O(1) most of the time: entries of earlier
+    // generations count as empty.
+    void clear();
+    // Adds key, true if it wasn't there already. A full neighbourhood
+    // keeps nothing and answers true, so the board is searched again.
+    bool insert(unsigned long long key);
+    size_t entries() const { return _mask + 1; }
+
+private:
+    std::atomic<unsigned long long>* _entries;
+    size_t _mask;
+    unsigned long long _generation = 0;
+};
+
+class Solver {
+public:
+    explicit Solver(int threads = 1, size_t visitedMegabytes = 64);
+    ~Solver();
+    Solver(const Solver&) = delete;
+    Solver& operator=(const Solver&) = delete;
+
+    enum Outcome { SOLVED, NO_SOLUTION, GAVE_UP };
+
+    struct Result {
+        Outcome outcome;
+        std::vector<Placement> placements;  // one per piece used, when solved
+        SolverStats stats;
+        double seconds;
+    };
+
+    // Searches at most maxNodes boards, 0 for no limit, before giving up.
+    // Any thread may find the solution, so with more than one the one
+    // returned can change from run to run.
+    Result solve(const Puzzle& puzzle, long long maxNodes = 0);
+
+    int threads() const { return _pool.size(); }
+
+private:
+    struct Task {
+        BoardRows rows;
+        int level;          // pieces placed
+        int lines;          // lines cleared on the way
+        Placement path[MAX_PUZZLE_PIECES];
+    };
+
+    struct Worker {
+        struct Child {
+            BoardRows rows;
+            int lines, order;
+            Placement placement;
+        };
+
+        PlacementFinder finder;
+        Placement out[MAX_PUZZLE_PIECES][MAX_PLACEMENTS];
+        Child children[MAX_PUZZLE_PIECES][MAX_PLACEMENTS];
+        Placement path[MAX_PUZZLE_PIECES];  // to the board being searched
+        SolverStats stats;
+        int sinceCount = 0;
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    bool search(Worker& w, const unsigned short* rows, int level, int lines);
+    int cellsNeeded(const unsigned short* rows, int lines) const;
+    bool takeTask(int thread, Task& task);
+    void found(const Worker& w, int level);
+
+    JobPool _pool;
+    std::vector<Worker*> _workers;
+    VisitedSet _visited;
+
+    // the puzzle in progress
+    const Puzzle* _puzzle = nullptr;
+    int _length = 0;
+    long long _maxNodes = 0;
+    std::atomic<long long> _nodes{0};
+    std::atomic<int> _pending{0};       // tasks queued or being searched
+    std::atomic<int> _hungry{0};        // threads looking for a task
+    std::atomic<bool> _stop{false};
+    std::atomic<bool> _solved{false};
+    std::atomic<bool> _gaveUp{false};
+    std::mutex _solutionLock;
+    std::vector<Placement> _solution;
+};
+
+#endif // __SOLVER_H__
@@ -0,0 +1,205 @@
+#include "SpectatorFeed.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace std;
+
+long long feedClockNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void setPiece(FeedEvent& event, const Shape& piece) {
+    auto pos = piece.getPos();
+    for(int k=0; k<PIECE_CELLS; k++){
+        event.pieceX[k] = pos[k].x;
+        event.pieceY[k] = pos[k].y;
+    }
+    event.color = piece.getColor();
+}
+
+//----------------------------------------------------------------------------
+
+bool FeedWriter::open(const char* name) {
+    close();
+    // start from a fresh object, readers of an old one keep their mapping
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if(fd < 0){
+        cerr<<"Failed to create shared memory "<<name<<endl;
+        return false;
+    }
+    if(ftruncate(fd, sizeof(FeedRegion)) < 0){
+        ::close(fd);
+        shm_unlink(name);
+        return false;
+    }
+    void* p = mmap(nullptr, sizeof(FeedRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(p == MAP_FAILED){
+        shm_unlink(name);
+        return false;
+    }
+
+    // a new object is all zeroes, so every slot and counter starts at 0
+    _region = (FeedRegion*)p;
+    strncpy(_name, name, sizeof(_name) - 1);
+    _seq = 0;
+    _sinceBoard = 0;
+    FeedHeader& h = _region->header;
+    h.version = FEED_VERSION;
+    h.slots = FEED_SLOTS;
+    h.eventSize = sizeof(FeedEvent);
+    atomic_thread_fence(memory_order_release);
+    h.magic = FEED_MAGIC;
+    return true;
+}
+
+void FeedWriter::close() {
+    if(_region == nullptr) return;
+    munmap(_region, sizeof(FeedRegion));
+    shm_unlink(_name);
+    _region = nullptr;
+}
+
+void FeedWriter::publish(FeedEvent& event) {
+    event.seq = ++_seq;
+    event.timeNs = feedClockNs();
+
+    FeedSlot& slot = _region->slots[_seq & (FEED_SLOTS - 1)];
+    slot.seq.store(0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy((void*)&slot.event, &event, sizeof(event));
+    slot.seq.store(_seq, memory_order_release);
+
+    if(event.type == FEED_BOARD){
+        _region->header.lastBoard.store(_seq, memory_order_release);
+        _sinceBoard = 0;
+    }
+    else _sinceBoard++;
+    _region->header.head.store(_seq, memory_order_release);
+}
+
+void FeedWriter::publishBoard(const Game& game) {
+    if(_region == nullptr) return;
+    FeedEvent e;
+    e.type = FEED_BOARD;
+    e.tick = game.ticks();
+    e.over = game.isOver();
+    memcpy(e.cells, game.cells(), sizeof(Cells));
+    setPiece(e, game.current());
+    publish(e);
+}
+
+void FeedWriter::publishTick(const Game& before, const Game& after) {
+    if(_region == nullptr) return;
+
+    if(after.piecesPlaced() != before.piecesPlaced()){
+        // the piece locked where it was before the tick
+        FeedEvent e;
+        e.tick = after.ticks();
+        e.type = FEED_LOCK;
+        setPiece(e, before.current());
+        publish(e);
+
+        Cells cells;
+        memcpy(cells, before.cells(), sizeof(Cells));
+        for(int k=0; k<PIECE_CELLS; k++) cells[e.pieceY[k]][e.pieceX[k]] = e.color;
+        unsigned int full = 0;
+        for(int i=0; i<NUM_ROWS; i++){
+            if(memchr(cells[i], EMPTY_CELL, NUM_COLS) == nullptr) full |= 1u << i;
+        }
+        if(full){
+            FeedEvent c;
+            c.tick = e.tick;
+            c.type = FEED_CLEAR;
+            c.rows = full;
+            publish(c);
+        }
+
+        FeedEvent s;
+        s.tick = e.tick;
+        s.type = FEED_SPAWN;
+        setPiece(s, after.current());
+        publish(s);
+    }
+
+    if(after.isOver() && !before.isOver()){
+        FeedEvent e;
+        e.tick = after.ticks();
+        e.type = FEED_GAME_OVER;
+        e.over = 1;
+        publish(e);
+    }
+
+    if(_sinceBoard >= FEED_BOARD_INTERVAL) publishBoard(after);
+}
+
+//----------------------------------------------------------------------------
+
+bool FeedReader::open(const char* name) {
+    close();
+    int fd = shm_open(name, O_RDONLY, 0);
+    if(fd < 0) return false;
+    void* p = mmap(nullptr, sizeof(FeedRegion), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(p == MAP_FAILED) return false;
+
+    _region = (const FeedRegion*)p;
+    const FeedHeader& h = _region->header;
+    if(h.magic != FEED_MAGIC || h.version != FEED_VERSION || h.slots != FEED_SLOTS ||
+       h.eventSize != sizeof(FeedEvent)){
+        cerr<<name<<" is not a compatible spectator feed"<<endl;
+        close();
+        return false;
+    }
+    atomic_thread_fence(memory_order_acquire);
+
+    // join at the newest full board
+    _next = h.lastBoard.load(memory_order_acquire);
+    if(_next == 0) _next = 1;
+    _lost = 0;
+    return true;
+}
+
+void FeedReader::close() {
+    if(_region == nullptr) return;
+    munmap((void*)_region, sizeof(FeedRegion));
+    _region = nullptr;
+}
+
+unsigned long long FeedReader::behind() const {
+    if(_region == nullptr) return 0;
+    unsigned long long head = _region->header.head.load(memory_order_acquire);
+    return head >= _next ? head - _next + 1 : 0;
+}
+
+Feed_read_status FeedReader::next(FeedEvent& out) {
+    if(_region == nullptr) return FEED_READ_EMPTY;
+    unsigned long long head = _region->header.head.load(memory_order_acquire);
+    if(_next > head) return FEED_READ_EMPTY;
+
+    const FeedSlot& slot = _region->slots[_next & (FEED_SLOTS - 1)];
+    if(head - _next < FEED_SLOTS && slot.seq.load(memory_order_acquire) == _next){
+        memcpy(&out, (const void*)&slot.event, sizeof(out));
+        atomic_thread_fence(memory_order_acquire);
+        if(slot.seq.load(memory_order_relaxed) == _next){
+            _next++;
+            return FEED_READ_OK;
+        }
+    }
+
+    // lapped: skip to the newest full board
+    unsigned long long board = _region->header.lastBoard.load(memory_order_acquire);
+    _lost += board > _next ? board - _next : 1;
+    _next = max(board, _next + 1);
+    return FEED_READ_LOST;
+}
@@ -0,0 +1,128 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- SpectatorFeed.h ---
+//
+//   Board events of a running game, broadcast through a POSIX shared
+//   memory ring to any number of local readers. The game thread only
+//   ever writes into the mapping: it never waits for, or even knows
+//   about, readers. A reader that falls a whole ring behind loses events
+//   and picks up again at the next full board, which the writer repeats
+//   every FEED_BOARD_INTERVAL events.
+//
+//   Each slot carries the number of the event in it. The writer zeroes
+//   that number, writes the event and then stores the new number; a
+//   reader checks the number before and after reading the slot in place,
+//   so a torn read is detected instead of locked out.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __SPECTATORFEED_H__
+#define __SPECTATORFEED_H__
+
+#include "Game.h"
+
+#include <atomic>
+
+const char* const FEED_DEFAULT_NAME = "/tetris-feed";
+const unsigned int FEED_MAGIC = 0x44465454;     // "TTFD"
+const unsigned int FEED_VERSION = 1;
+const int FEED_SLOTS = 1024;                     // power of two
+const int FEED_BOARD_INTERVAL = 64;
+
+enum Feed_event_type {
+    FEED_BOARD,         // cells, piece and over flag: the whole picture
+    FEED_SPAWN,         // a new falling piece
+    FEED_LOCK,          // the falling piece settled, cells added to the board
+    FEED_CLEAR,         // rows (bit per row, bottom first) removed
+    FEED_GAME_OVER
+};
+
+struct FeedEvent {
+    unsigned long long seq = 0;
+    long long tick = 0;
+    long long timeNs = 0;       // CLOCK_MONOTONIC when published
+    unsigned char type = FEED_BOARD;
+    unsigned char color = 0;
+    unsigned char over = 0;
+    signed char pieceX[PIECE_CELLS] = {};
+    signed char pieceY[PIECE_CELLS] = {};
+    unsigned int rows = 0;
+    Cells cells = {};           // FEED_BOARD only
+};
+
+struct FeedSlot {
+    std::atomic<unsigned long long> seq;
+    FeedEvent event;
+};
+
+struct FeedHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int slots;
+    unsigned int eventSize;
+    std::atomic<unsigned long long> head;       // last event published
+    std::atomic<unsigned long long> lastBoard;  // last FEED_BOARD event
+};
+
+struct FeedRegion {
+    FeedHeader header;
+    FeedSlot slots[FEED_SLOTS];
+};
+
+long long feedClockNs();
+
+class FeedWriter {
+public:
+    FeedWriter() {}
+    ~FeedWriter() { close(); }
+    FeedWriter(const FeedWriter&) = delete;
+    FeedWriter& operator=(const FeedWriter&) = delete;
+
+    // Creates (or takes over) the shared memory object.
+    bool open(const char* name);
+    // Unmaps and removes the object; readers still attached keep theirs.
+    void close();
+
+    // Events for one tick(): before is a copy of the game taken just
+    // ahead of the call, after the game once it returned.
+    void publishTick(const Game& before, const Game& after);
+    // The whole board, after anything that isn't a single tick (a new
+    // game, a rewind).
+    void publishBoard(const Game& game);
+
+private:
+    void publish(FeedEvent& event);
+
+    FeedRegion* _region = nullptr;
+    char _name[64] = {};
+    unsigned long long _seq = 0;
+    int _sinceBoard = 0;
+};
+
+enum Feed_read_status { FEED_READ_OK, FEED_READ_EMPTY, FEED_READ_LOST };
+
+class FeedReader {
+public:
+    FeedReader() {}
+    ~FeedReader() { close(); }
+    FeedReader(const FeedReader&) = delete;
+    FeedReader& operator=(const FeedReader&) = delete;
+
+    bool open(const char* name);
+    void close();
+
+    // Next event in order. FEED_READ_LOST means the writer lapped us; the
+    // reader has moved on to the newest full board, which comes next.
+    Feed_read_status next(FeedEvent& out);
+
+    // events published but not read yet
+    unsigned long long behind() const;
+    unsigned long long lost() const { return _lost; }
+
+private:
+    const FeedRegion* _region = nullptr;
+    unsigned long long _next = 0;
+    unsigned long long _lost = 0;
+};
+
+#endif // __SPECTATORFEED_H__
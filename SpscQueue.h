@@ -0,0 +1,46 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- SpscQueue.h ---
+//
+//   Bounded lock-free queue for exactly one producer and one consumer
+//   thread. Capacity must be a power of two.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __SPSCQUEUE_H__
+#define __SPSCQUEUE_H__
+
+#include <atomic>
+#include <cstddef>
+
+template<typename T, size_t CAPACITY>
+class SpscQueue {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+public:
+    // producer side, false when the queue is full
+    bool push(const T& value) {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if(tail - _head.load(std::memory_order_acquire) == CAPACITY) return false;
+        _items[tail & (CAPACITY - 1)] = value;
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side, false when the queue is empty
+    bool pop(T& value) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if(head == _tail.load(std::memory_order_acquire)) return false;
+        value = _items[head & (CAPACITY - 1)];
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T _items[CAPACITY];
+    // kept on separate cache lines so the two threads do not false share
+    alignas(64) std::atomic<size_t> _head{0};
+    alignas(64) std::atomic<size_t> _tail{0};
+};
+
+#endif // __SPSCQUEUE_H__
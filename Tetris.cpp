@@ -2,34 +2,35 @@
 // Generated using randomly selected vertices and bisection
 
 #include "include/Angel.h"
-
+#include "BatchEnv.h"
+#include "Board.h"
+#include "Bot.h"
+#include "ExternalControl.h"
+#include "Game.h"
+#include "Replay.h"
+#include "Rewind.h"
+#include "SpectatorFeed.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+#include "Versus.h"
+#include "GLStats.h"
+#include "FrameCapture.h"
+
+#include <chrono>
 #include <cstdlib>
 #include <ctime>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
 #include <vector>
 
 using namespace std;
 
-const int NUM_ROWS = 20;
-const int NUM_COLS = 10;
-const int WINDOWS_SIZE_SCALE=35;
-const int WINDOW_SIZE_X = WINDOWS_SIZE_SCALE * (NUM_COLS+2);
-const int WINDOW_SIZE_Y = WINDOWS_SIZE_SCALE * (NUM_ROWS+2);
-const int NUM_GRID_LINE_POINTS = 4 + 2*NUM_ROWS + 2*NUM_COLS;
-const float diffX = 2.0/(NUM_COLS+1), diffY=2.0/(NUM_ROWS+1); // this should give half a cell border
-const float cornerX = diffX*5, cornerY = diffY*10;
-
-const float UPDATE_INTERVAL = 50.0;
-const int REGULAR_GRAVITY_FACTOR = 5;
-
-const int NUM_COLORS = 6;
-vec3 SHAPE_COLORS[NUM_COLORS] = {
-    vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 0.0, 1.0),
-    vec3(1.0, 1.0, 0.0),
-    vec3(0.0, 1.0, 1.0),
-    vec3(1.0, 0.0, 1.0)
-};
+// how often the GLUT thread looks for a new snapshot from the simulation
+const int REFRESH_INTERVAL = 4;
+
+vec3 SHAPE_COLORS[NUM_COLORS];
 
 // shader program
 GLuint program;
@@ -41,291 +42,179 @@ GLuint grid_vao;
 
 vector<vec2> ground_points;
 vector<vec3> ground_colors;
-vector<vector<vec3*>> cell_colors;
-
-bool downPressed = false;
-bool gameOver = false;
-int updateCounter = 0;
+unsigned int groundVersion = 0;
 
 //----------------------------------------------------------------------------
+// The game runs on its own thread. Input callbacks hand it key presses
+// through a lock-free queue and it publishes a complete BoardSnapshot after
+// every change through a lock-free triple buffer, so a slow frame never
+// delays gravity or input and the renderer never sees a half updated board.
+
+SpscQueue<Input, 64> inputs;
+TripleBuffer<BoardSnapshot> snapshots;
+atomic<bool> simRunning(false);
+thread* simThread = nullptr;
+bool shownGameOver = false;
+
+// --record <prefix> saves every game as <prefix><n>.ttr,
+// --replay <file> [--speed <x>] plays one back instead of a live game
+const long long REPLAY_SEEK_TICKS = 100;
+string recordPrefix;
+int recordedGames = 0;
+vector<unsigned char> replayData;
+Replay replay;
+double replaySpeed = 1.0;
+
+// The last REWIND_STATES gravity steps of the live game, about 2.5 minutes
+// at normal speed. 'b' steps back and pauses, 'f' steps forward again, any
+// move resumes play from the state on screen.
+const int REWIND_STATES = 600;
+enum Rewind_step { REWIND_BACK, REWIND_FORWARD };
+SpscQueue<Rewind_step, 16> rewindSteps;
+RewindBuffer<Game, REWIND_STATES>* rewindBuffer = nullptr;
+
+// --versus <port> <peer port> [--delay <ms>] [--loss <percent>] plays
+// against another instance on this machine; the lower port picks the seed
+int versusPort = 0, versusPeer = 0;
+double versusDelay = 0, versusLoss = 0;
+RollbackSession* versusSession = nullptr;
+
+// --feed [name] publishes board events of the live game to shared memory
+// for tetris-spectate and other local readers
+FeedWriter* feed = nullptr;
+
+// --control [name] hands the piece to another process through shared
+// memory; the arrow keys are ignored while it is on
+ControlHost* control = nullptr;
+
+// 'a' hands the live game to the heuristic bot and back (attract mode);
+// it presses at most one key a tick, searching on its own thread pool
+atomic<bool> autoplay(false);
+Autopilot* autopilot = nullptr;
+bool autopilotDriving = false;
 
-enum Rotation_mode { NONE, SEMI, FULL};
-
-struct coord{
-    int x, y;
-    coord(){}
-    coord(int a, int b): x(a), y(b) {}
-    coord(const coord& another): x(another.x), y(another.y) {}
+//----------------------------------------------------------------------------
+// --wall <n> shows n bot games from the batch simulator at once, for a
+// lobby screen. Each tick the simulation publishes every board in one
+// array, which goes up as one integer texture, a row of texels per board;
+// one instanced draw of a quad per board then draws the whole wall, and
+// the fragment shader looks the cells up. '+' and '-' double and halve the
+// number of boards and print the frame time for the count they leave.
+
+const int MAX_WALL_BOARDS = 1024;
+const int WALL_WINDOW_X = 1280, WALL_WINDOW_Y = 720;
+const float WALL_EMPTY_COLOR[3] = { 0.12, 0.12, 0.12 };
+
+struct WallFrame {
+    int boards = 0;
+    // [board][row][2]: the settled cells, then the cells with the falling piece
+    vector<unsigned short> rows;
 };
 
-class Shape{
-public:
-    Shape(vector<coord> pos, Rotation_mode rmode) : _pos(pos), _rmode(rmode) {}
-    Shape(const Shape& s) : _pos(s._pos), _rmode(s._rmode) {}
-
-    void rotate() {
-        if(_rmode == NONE) return;
-        vector<coord> backup_pos = _pos; 
-        coord backup_center=_center;
-
-        if(_straight) {
-            for(coord& v: _pos) {
-                v = coord(-v.y , v.x);
-            }
-        }
-        else{
-            for(coord& v: _pos) {
-                v = coord(v.y , -v.x);
-            }
-        }
-            
-        if(_rmode == SEMI) _straight = !_straight;
-
-        // check rotation moved out of bounds
-        int minX=NUM_COLS-1, minY=NUM_ROWS-1, maxX=0, maxY=0;
-        for(auto v: getPos()){
-            minX = min(v.x, minX);
-            minY = min(v.y, minY);
-            maxX = max(v.x, maxX);
-            maxY = max(v.y, maxY);
-        }
-
-        if(minX<0) _center.x-=minX;
-        else if(maxX>=NUM_COLS) _center.x -= NUM_COLS - maxX - 1;
-        if(minY<0) _center.y-=minY;
-        else if(maxY>=NUM_ROWS) _center.y -= NUM_ROWS - maxY - 1;
+TripleBuffer<WallFrame> wallFrames;
+int wallBoards = 0, wallMaxBoards = MAX_WALL_BOARDS;
+GLuint wallProgram, wall_vao, wall_texture;
+GLint wallColumnsLoc, wallOriginLoc, wallTileSizeLoc, wallBoardSizeLoc;
+// what the texture and the layout uniforms were last set up for
+int wallTextureBoards = 0, wallLayoutBoards = 0, wallLayoutX = 0, wallLayoutY = 0;
 
-        if(hasCollision()){
-            _pos = backup_pos;
-            _center = backup_center;
-            if(_rmode == SEMI) _straight = !_straight;
-        }
-    }
+//----------------------------------------------------------------------------
+// per pass timing of display(). GPU time comes from GL_TIME_ELAPSED queries
+// that are read back QUERY_RING-1 frames later so the CPU never waits on them.
 
-    vector<coord> getPos(){
-        vector<coord> v(_pos.size());
-        for(unsigned int i=0;i<v.size();i++){
-            v[i] = coord(_pos[i].x + _center.x, _pos[i].y + _center.y);
-        }
-        return v;
-    }
+enum Render_pass { PASS_CURR, PASS_GROUND, PASS_GRID, PASS_WALL, NUM_PASSES };
+const char* PASS_NAMES[NUM_PASSES] = { "current piece", "ground", "grid", "wall" };
 
-    vec3* getColor(){
-        return _color;
-    }
+const int QUERY_RING = 4;
+const double TIMING_SMOOTHING = 0.1;
 
-    void setColor(vec3* val){
-        _color = val;
-    }
-
-    void moveHorizontal(bool right){
-        _center.x += right ? 1 : -1;
-        if(hasCollision()){
-            _center.x -= right ? 1 : -1;
-        }
-    }
+bool timerQueriesSupported = false;
+GLuint timer_queries[QUERY_RING][NUM_PASSES];
+// the passes issued in each slot, in Render_pass order; the wall and the
+// single board use different ones
+unsigned int queryPasses[QUERY_RING];
+unsigned int passesRun = 0;
+int queryFrame = 0;
+bool queryActive = false;
 
-    bool moveDown(){
-        _center.y--;
-        if(hasCollision()){
-            _center.y++;
-            return true;
-        }
-        return false;
-    }
+double cpuPassMs[NUM_PASSES];
+double gpuPassMs[NUM_PASSES];
+long long timedFrames = 0, gpuTimedFrames = 0, gpuSkippedFrames = 0;
+chrono::steady_clock::time_point passStart;
 
-    bool hasCollision(){
-        auto pos = getPos();
-        for(auto& v: pos){
-            if(v.x<0 || v.x>=NUM_COLS || v.y<0 || v.y>=NUM_ROWS || cell_colors[v.y][v.x]!=nullptr){
-                return true;
-            }
-        }
-        return false;
-    }
-private:
-    static coord _START_POS;
+// plain totals of the wall pass since the number of boards last changed
+double wallCpuMs = 0, wallGpuMs = 0;
+long long wallCpuFrames = 0, wallGpuFrames = 0;
 
-    vector<coord> _pos;
-    vec3* _color;
-    coord _center = _START_POS;
-    Rotation_mode _rmode;
-    bool _straight = true;
-};
-coord Shape::_START_POS = coord(NUM_COLS/2, NUM_ROWS-1);
-
-Shape* curr;
-
-const int NUM_SHAPES = 7;
-Shape shapes[NUM_SHAPES] = {
-    // O
-    Shape({ coord(0, 0), coord(0, -1), coord(1, 0), coord(1, -1) }, NONE),
-    // I
-    Shape({ coord(-2, 0), coord(-1, 0), coord(0, 0), coord(1, 0) }, SEMI),
-    // S
-    Shape({ coord(0, 0), coord(1, 0), coord(-1, -1), coord(0, -1) }, SEMI),
-    // Z
-    Shape({ coord(-1, 0), coord(0, 0), coord(0, -1), coord(1, -1) }, SEMI),
-    // L
-    Shape({ coord(-1, 0), coord(0, 0), coord(1, 0), coord(-1, -1) }, FULL),
-    // J
-    Shape({ coord(-1, 0), coord(0, 0), coord(1, 0), coord(1, -1) }, FULL),
-    // T
-    Shape({ coord(-1, 0), coord(0, 0), coord(1, 0), coord(0, -1) }, FULL)
-};
+// optional raw video capture (--capture <file or |command>)
+FrameCapture* capture = nullptr;
+bool captureDue = false;
 
 template<typename T>
 int vecSize(const vector<T>& v){
     return v.size() * sizeof(T);
 }
 
-void appendPoints(const vector<coord>& pos, vector<vec2>& points, vec3 color, vector<vec3>& colors){
-    for(coord v: pos){
-        vec2 temp(v.x * diffX - cornerX, v.y * diffY - cornerY);
-
-        if(points.size()){
-            points.push_back(points.back());
-            points.push_back(temp);
-            colors.push_back(color);
-            colors.push_back(color);
-        }
+void appendCell(int col, int row, vec3 color, vector<vec2>& points, vector<vec3>& colors){
+    vec2 temp(col * diffX - cornerX, row * diffY - cornerY);
 
+    if(points.size()){
+        points.push_back(points.back());
         points.push_back(temp);
-        temp.x += diffX;
-        points.push_back(temp);
-        temp += vec2(-diffX, diffY);
-        points.push_back(temp);
-        temp.x += diffX;
-        points.push_back(temp);
-
-        colors.push_back(color);
-        colors.push_back(color);
         colors.push_back(color);
         colors.push_back(color);
     }
+
+    points.push_back(temp);
+    temp.x += diffX;
+    points.push_back(temp);
+    temp += vec2(-diffX, diffY);
+    points.push_back(temp);
+    temp.x += diffX;
+    points.push_back(temp);
+
+    colors.push_back(color);
+    colors.push_back(color);
+    colors.push_back(color);
+    colors.push_back(color);
 }
 
-void recomputePoints(){
+void recomputePoints(const BoardSnapshot& frame){
     ground_points.clear();
     ground_colors.clear();
 
     for(int i=0; i<NUM_ROWS; i++){
         for(int j=0; j<NUM_COLS; j++){
-            vec3* v = cell_colors[i][j];
-            if(v==nullptr) continue;
-            vec2 temp(j * diffX - cornerX, i * diffY - cornerY);
-
-            if(ground_points.size()){
-                ground_points.push_back(ground_points.back());
-                ground_points.push_back(temp);
-                ground_colors.push_back(*v);
-                ground_colors.push_back(*v);
-            }
-
-            ground_points.push_back(temp);
-            temp.x += diffX;
-            ground_points.push_back(temp);
-            temp += vec2(-diffX, diffY);
-            ground_points.push_back(temp);
-            temp.x += diffX;
-            ground_points.push_back(temp);
-
-            ground_colors.push_back(*v);
-            ground_colors.push_back(*v);
-            ground_colors.push_back(*v);
-            ground_colors.push_back(*v);
-        }
-    }
-}
-
-
-//----------------------------------------------------------------------------
-
-void setNewCurr(){
-    if(curr != nullptr){
-        auto pos=curr->getPos();
-        auto* color=curr->getColor();
-        for(auto& v: pos){
-            if(v.x<0||v.y<0) {
-                cout<<"should not get here\n";
-                cout<<v.x<<" while limit: "<<NUM_COLS<<"\n"<<v.y<<" while limit: "<<NUM_ROWS<<endl<<endl;
-                continue;
-            }
-            cell_colors[v.y][v.x]=color;
-        }
-        auto it=cell_colors.begin();
-        bool somethingChanged=false;
-        while(it!=cell_colors.end()){
-            bool rowFull=true;
-            for(auto x: *it){
-                if(x==nullptr){
-                    rowFull=false;
-                    break;
-                }
-            }
-            if(rowFull){
-                somethingChanged=true;
-                it = cell_colors.erase(it);
-            }
-            else it++;
+            if(frame.cells[i][j]==EMPTY_CELL) continue;
+            appendCell(j, i, SHAPE_COLORS[frame.cells[i][j] - 1], ground_points, ground_colors);
         }
-        if(somethingChanged){
-            for(int i=cell_colors.size();i<NUM_ROWS;i++) cell_colors.emplace_back(NUM_COLS, nullptr);
-            recomputePoints();
-        }
-        else appendPoints(pos, ground_points, *color, ground_colors);
-        delete curr;
-    }
-    curr = new Shape(shapes[rand()%NUM_SHAPES]);
-    curr->setColor(&SHAPE_COLORS[rand()%NUM_COLORS]);
-    if(curr->hasCollision()){
-        gameOver=true;
-        cout<<"\n\nYOU LOST\n\n";
     }
+    groundVersion = frame.groundVersion;
 }
 
 //----------------------------------------------------------------------------
 
 void init_grid_lines() {
-    glGenVertexArrays( 1, &grid_vao );
-    glBindVertexArray( grid_vao );
-
-    vec2 grid[NUM_GRID_LINE_POINTS] = {
-        vec2(-cornerX, 0),
-        vec2(cornerX, 0),
-        vec2(0, -cornerY),
-        vec2(0, cornerY)
-    };
+    glsGenVertexArrays( 1, &grid_vao );
+    glsBindVertexArray( grid_vao );
 
-    float temp = 0.0;
-    for(int i=4; i<4 + 2*NUM_COLS; i+=4){
-        temp += diffX;
-        grid[i] = vec2(temp, -cornerY);
-        grid[i+1] = vec2(temp, cornerY);
-        grid[i+2] = vec2(-temp, -cornerY);
-        grid[i+3] = vec2(-temp, cornerY);
-    }
-    temp = 0.0;
-    for(int i=4 + 2*NUM_COLS; i<NUM_GRID_LINE_POINTS; i+=4){
-        temp += diffY;
-        grid[i] = vec2(-cornerX, temp);
-        grid[i+1] = vec2(cornerX, temp);
-        grid[i+2] = vec2(-cornerX, -temp);
-        grid[i+3] = vec2(cornerX, -temp);
-    }
+    float gridXY[NUM_GRID_LINE_POINTS][2];
+    gridLinePoints(gridXY);
+    vec2 grid[NUM_GRID_LINE_POINTS];
+    for(int i=0; i<NUM_GRID_LINE_POINTS; i++) grid[i] = vec2(gridXY[i][0], gridXY[i][1]);
 
-    const vec3 lineColor = vec3(0.5, 0.5, 0.5);
+    const vec3 lineColor = vec3(GRID_LINE_COLOR[0], GRID_LINE_COLOR[1], GRID_LINE_COLOR[2]);
     vec3 gridColors[NUM_GRID_LINE_POINTS];
     for(int i=0; i<NUM_GRID_LINE_POINTS; i++) gridColors[i] = lineColor;
 
     // Create and initialize a buffer object
     GLuint buffer;
-    glGenBuffers( 1, &buffer );
-    glBindBuffer( GL_ARRAY_BUFFER, buffer );
-    glBufferData( GL_ARRAY_BUFFER, sizeof(grid) + sizeof(gridColors), grid, GL_STATIC_DRAW );
+    glsGenBuffers( 1, &buffer );
+    glsBindBuffer( GL_ARRAY_BUFFER, buffer );
+    glsBufferData( GL_ARRAY_BUFFER, sizeof(grid) + sizeof(gridColors), grid, GL_STATIC_DRAW );
 
     // glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(points), points);
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(grid), sizeof(gridColors), gridColors);
+    glsBufferSubData(GL_ARRAY_BUFFER, sizeof(grid), sizeof(gridColors), gridColors);
 
     glEnableVertexAttribArray( vPosition );
     glVertexAttribPointer( vPosition, 2, GL_FLOAT, GL_FALSE, 0,
@@ -338,36 +227,41 @@ void init_grid_lines() {
 
 //----------------------------------------------------------------------------
 
-void init() {
-    ground_points.clear();
-    ground_colors.clear();
-    cell_colors = vector<vector<vec3*>>(NUM_ROWS, vector<vec3*>(NUM_COLS, nullptr));
-
-    curr = nullptr;
-    gameOver = false;
-    updateCounter = 0;
-    setNewCurr();
-    srand(time(nullptr));
+//----------------------------------------------------------------------------
 
+void init() {
     glClearColor( 0.0, 0.0, 0.0, 1.0 ); // black background
 }
 //----------------------------------------------------------------------------
 
-void display_curr() {
+void display_curr(const BoardSnapshot& frame) {
     GLuint vao;
-    glGenVertexArrays( 1, &vao );
-    glBindVertexArray( vao );
+    glsGenVertexArrays( 1, &vao );
+    glsBindVertexArray( vao );
 
     GLuint buffer;
-    glGenBuffers( 1, &buffer );
-    glBindBuffer( GL_ARRAY_BUFFER, buffer );
+    glsGenBuffers( 1, &buffer );
+    glsBindBuffer( GL_ARRAY_BUFFER, buffer );
 
+    // the ghost's outline goes first, as lines, under the piece's strip
     vector<vec2> points;
     vector<vec3> colors;
-    appendPoints(curr->getPos(), points, *curr->getColor(), colors);
+    float ghost[NUM_GHOST_POINTS][2];
+    int ghostPoints = frame.pieceCells ? ghostLinePoints(frame, ghost) : 0;
+    for(int i=0; i<ghostPoints; i++){
+        points.push_back(vec2(ghost[i][0], ghost[i][1]));
+        colors.push_back(SHAPE_COLORS[frame.pieceColor - 1]);
+    }
+    vector<vec2> strip;
+    vector<vec3> stripColors;
+    for(int k=0; k<frame.pieceCells; k++){
+        appendCell(frame.pieceX[k], frame.pieceY[k], SHAPE_COLORS[frame.pieceColor - 1], strip, stripColors);
+    }
+    points.insert(points.end(), strip.begin(), strip.end());
+    colors.insert(colors.end(), stripColors.begin(), stripColors.end());
 
-    glBufferData( GL_ARRAY_BUFFER, vecSize(points) + vecSize(colors), &points[0], GL_STATIC_DRAW );
-    glBufferSubData( GL_ARRAY_BUFFER, vecSize(points), vecSize(colors), &colors[0] );
+    glsBufferData( GL_ARRAY_BUFFER, vecSize(points) + vecSize(colors), &points[0], GL_STATIC_DRAW );
+    glsBufferSubData( GL_ARRAY_BUFFER, vecSize(points), vecSize(colors), &colors[0] );
 
     glEnableVertexAttribArray( vPosition );
     glVertexAttribPointer( vPosition, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0) );
@@ -375,20 +269,23 @@ void display_curr() {
     glEnableVertexAttribArray( vColor );
     glVertexAttribPointer( vColor, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(vecSize(points)) );
 
-    glDrawArrays( GL_TRIANGLE_STRIP, 0, points.size() );
+    if(ghostPoints) glsDrawArrays( GL_LINES, 0, ghostPoints );
+    glsDrawArrays( GL_TRIANGLE_STRIP, ghostPoints, strip.size() );
 }
 
-void display_ground() {
+void display_ground(const BoardSnapshot& frame) {
+    if(frame.groundVersion != groundVersion) recomputePoints(frame);
+
     GLuint vao;
-    glGenVertexArrays( 1, &vao );
-    glBindVertexArray( vao );
+    glsGenVertexArrays( 1, &vao );
+    glsBindVertexArray( vao );
 
     GLuint buffer;
-    glGenBuffers( 1, &buffer );
-    glBindBuffer( GL_ARRAY_BUFFER, buffer );
+    glsGenBuffers( 1, &buffer );
+    glsBindBuffer( GL_ARRAY_BUFFER, buffer );
 
-    glBufferData( GL_ARRAY_BUFFER, vecSize(ground_points) + vecSize(ground_colors), &ground_points[0], GL_STATIC_DRAW );
-    glBufferSubData( GL_ARRAY_BUFFER, vecSize(ground_points), vecSize(ground_colors), &ground_colors[0] );
+    glsBufferData( GL_ARRAY_BUFFER, vecSize(ground_points) + vecSize(ground_colors), &ground_points[0], GL_STATIC_DRAW );
+    glsBufferSubData( GL_ARRAY_BUFFER, vecSize(ground_points), vecSize(ground_colors), &ground_colors[0] );
 
     glEnableVertexAttribArray( vPosition );
     glVertexAttribPointer( vPosition, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0) );
@@ -396,51 +293,551 @@ void display_ground() {
     glEnableVertexAttribArray( vColor );
     glVertexAttribPointer( vColor, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(vecSize(ground_points)) );
 
-    glDrawArrays( GL_TRIANGLE_STRIP, 0, ground_points.size() );
+    glsDrawArrays( GL_TRIANGLE_STRIP, 0, ground_points.size() );
+}
+
+//----------------------------------------------------------------------------
+
+// Everything the wall draws with is made once; only the texture is
+// reallocated, when the number of boards changes.
+void init_wall() {
+    wallProgram = InitShader( "wall_vshader.glsl", "wall_fshader.glsl" );
+    glUseProgram( wallProgram );
+    wallColumnsLoc = glGetUniformLocation( wallProgram, "columns" );
+    wallOriginLoc = glGetUniformLocation( wallProgram, "origin" );
+    wallTileSizeLoc = glGetUniformLocation( wallProgram, "tileSize" );
+    wallBoardSizeLoc = glGetUniformLocation( wallProgram, "boardSize" );
+    glUniform2f( glGetUniformLocation( wallProgram, "cellCount" ), NUM_COLS, NUM_ROWS );
+    glUniform3fv( glGetUniformLocation( wallProgram, "palette" ), NUM_COLORS, &PALETTE[0][0] );
+    glUniform3fv( glGetUniformLocation( wallProgram, "emptyColor" ), 1, WALL_EMPTY_COLOR );
+    glUniform1i( glGetUniformLocation( wallProgram, "boards" ), 0 );
+
+    // a board per texel row
+    GLint maxTextureSize = 0;
+    glGetIntegerv( GL_MAX_TEXTURE_SIZE, &maxTextureSize );
+    wallMaxBoards = min(MAX_WALL_BOARDS, (int)maxTextureSize);
+
+    glsGenVertexArrays( 1, &wall_vao );
+    glsBindVertexArray( wall_vao );
+    const vec2 corners[4] = { vec2(0, 0), vec2(1, 0), vec2(0, 1), vec2(1, 1) };
+    GLuint buffer;
+    glsGenBuffers( 1, &buffer );
+    glsBindBuffer( GL_ARRAY_BUFFER, buffer );
+    glsBufferData( GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW );
+    GLuint vCorner = glGetAttribLocation( wallProgram, "vCorner" );
+    glEnableVertexAttribArray( vCorner );
+    glVertexAttribPointer( vCorner, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0) );
+
+    glsGenTextures( 1, &wall_texture );
+    glBindTexture( GL_TEXTURE_2D, wall_texture );
+    // integer textures can't be filtered
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+}
+
+// The tile grid that makes the boards biggest in the window, each board
+// with half a cell of margin all round.
+void layout_wall(int boards, int width, int height) {
+    int columns = 1;
+    float cell = 0;
+    for(int c=1; c<=boards; c++){
+        int rows = (boards + c - 1) / c;
+        float size = min((float)width / (c * (NUM_COLS + 1)), (float)height / (rows * (NUM_ROWS + 1)));
+        if(size > cell){
+            cell = size;
+            columns = c;
+        }
+    }
+    int rows = (boards + columns - 1) / columns;
+    float tileX = 2 * cell * (NUM_COLS + 1) / width, tileY = 2 * cell * (NUM_ROWS + 1) / height;
+    glUniform1i( wallColumnsLoc, columns );
+    glUniform2f( wallOriginLoc, -columns * tileX / 2, rows * tileY / 2 );
+    glUniform2f( wallTileSizeLoc, tileX, tileY );
+    glUniform2f( wallBoardSizeLoc, 2 * cell * NUM_COLS / width, 2 * cell * NUM_ROWS / height );
+}
+
+void display_wall(const WallFrame& frame) {
+    if(frame.boards == 0) return;
+    if(frame.boards != wallTextureBoards){
+        glsTexImage2D( GL_TEXTURE_2D, 0, GL_RG16UI, NUM_ROWS, frame.boards, 0, GL_RG_INTEGER, GL_UNSIGNED_SHORT, &frame.rows[0] );
+        wallTextureBoards = frame.boards;
+    }
+    else glsTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, NUM_ROWS, frame.boards, GL_RG_INTEGER, GL_UNSIGNED_SHORT, &frame.rows[0] );
+
+    int width = glutGet( GLUT_WINDOW_WIDTH ), height = glutGet( GLUT_WINDOW_HEIGHT );
+    if(frame.boards != wallLayoutBoards || width != wallLayoutX || height != wallLayoutY){
+        layout_wall(frame.boards, width, height);
+        wallLayoutBoards = frame.boards;
+        wallLayoutX = width;
+        wallLayoutY = height;
+    }
+    glsDrawArraysInstanced( GL_TRIANGLE_STRIP, 0, 4, frame.boards );
+}
+
+//----------------------------------------------------------------------------
+
+void init_timer_queries() {
+    timerQueriesSupported = glewIsSupported("GL_VERSION_3_3") || glewIsSupported("GL_ARB_timer_query");
+    if(!timerQueriesSupported) {
+        cout<<"GL timer queries unavailable, only CPU pass times will be reported\n";
+        return;
+    }
+    for(int i=0; i<QUERY_RING; i++){
+        glGenQueries( NUM_PASSES, timer_queries[i] );
+        queryPasses[i] = 0;
+    }
+}
+
+double smooth(double avg, double sample, long long count){
+    return count ? avg + (sample - avg) * TIMING_SMOOTHING : sample;
+}
+
+// Collects the results issued QUERY_RING-1 frames ago into this frame's slot.
+// If the GPU still has not finished them the frame simply goes untimed rather
+// than blocking on glGetQueryObject.
+void begin_frame_timing() {
+    if(!timerQueriesSupported) return;
+    int slot = queryFrame % QUERY_RING;
+    queryActive = true;
+    if(queryPasses[slot]){
+        // the last pass issued finishes last
+        int last = 31 - __builtin_clz(queryPasses[slot]);
+        GLint available = 0;
+        glGetQueryObjectiv( timer_queries[slot][last], GL_QUERY_RESULT_AVAILABLE, &available );
+        if(!available){
+            queryActive = false;
+            gpuSkippedFrames++;
+            return;
+        }
+        for(int p=0; p<NUM_PASSES; p++){
+            if(!(queryPasses[slot] & 1u << p)) continue;
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v( timer_queries[slot][p], GL_QUERY_RESULT, &ns );
+            gpuPassMs[p] = smooth(gpuPassMs[p], ns / 1.0e6, gpuTimedFrames);
+            if(p == PASS_WALL){
+                wallGpuMs += ns / 1.0e6;
+                wallGpuFrames++;
+            }
+        }
+        gpuTimedFrames++;
+        queryPasses[slot] = 0;
+    }
+}
+
+void end_frame_timing() {
+    queryActive = false;
+    queryFrame++;
+    timedFrames++;
+}
+
+void begin_pass(Render_pass p) {
+    if(queryActive){
+        glBeginQuery( GL_TIME_ELAPSED, timer_queries[queryFrame % QUERY_RING][p] );
+        queryPasses[queryFrame % QUERY_RING] |= 1u << p;
+    }
+    passStart = chrono::steady_clock::now();
+}
+
+void end_pass(Render_pass p) {
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - passStart).count();
+    cpuPassMs[p] = smooth(cpuPassMs[p], ms, timedFrames);
+    passesRun |= 1u << p;
+    if(p == PASS_WALL){
+        wallCpuMs += ms;
+        wallCpuFrames++;
+    }
+    if(queryActive) glEndQuery( GL_TIME_ELAPSED );
+}
+
+// frame time against the number of boards, averaged since it last changed
+void report_wall() {
+    if(wallCpuFrames == 0) return;
+    double cpu = wallCpuMs / wallCpuFrames;
+    cout<<"wall of "<<wallBoards<<" boards over "<<wallCpuFrames<<" frames: cpu "<<cpu<<" ms";
+    if(wallGpuFrames) cout<<", gpu "<<wallGpuMs / wallGpuFrames<<" ms";
+    cout<<" a frame, "<<max(cpu, wallGpuFrames ? wallGpuMs / wallGpuFrames : 0) * 1000 / wallBoards<<" us a board\n";
+}
+
+void print_stats() {
+    cout<<"\nrender passes over "<<timedFrames<<" frames (ms, smoothed)\n";
+    for(int p=0; p<NUM_PASSES; p++){
+        if(!(passesRun & 1u << p)) continue;
+        cout<<"  "<<PASS_NAMES[p]<<": cpu "<<cpuPassMs[p];
+        if(timerQueriesSupported) cout<<"  gpu "<<gpuPassMs[p];
+        cout<<"\n";
+    }
+    if(timerQueriesSupported)
+        cout<<"  gpu samples: "<<gpuTimedFrames<<", frames skipped waiting on results: "<<gpuSkippedFrames<<"\n";
+    if(wallBoards) report_wall();
+    cout<<endl;
+    glStatsPrint();
+}
+
+//----------------------------------------------------------------------------
+
+// the single board: the falling piece, the ground and the grid lines
+void display_board(const BoardSnapshot& frame) {
+    begin_pass(PASS_CURR);
+    display_curr(frame);
+    end_pass(PASS_CURR);
+
+    begin_pass(PASS_GROUND);
+    display_ground(frame);
+    end_pass(PASS_GROUND);
+
+    begin_pass(PASS_GRID);
+    glsBindVertexArray( grid_vao );
+    glsDrawArrays( GL_LINES, 0, NUM_GRID_LINE_POINTS);
+    end_pass(PASS_GRID);
 }
 
 void display() {
     glClear( GL_COLOR_BUFFER_BIT );     // clear the window
 
-    display_curr();
-    display_ground();
+    begin_frame_timing();
+
+    if(wallBoards){
+        begin_pass(PASS_WALL);
+        display_wall(wallFrames.front());
+        end_pass(PASS_WALL);
+    }
+    else display_board(snapshots.front());
+
+    end_frame_timing();
+    glStatsEndFrame();
 
-    glBindVertexArray( grid_vao );
-    glDrawArrays( GL_LINES, 0, NUM_GRID_LINE_POINTS);
+    if(capture && captureDue) capture->captureFrame();
+    captureDue = false;
 
     glFlush();
 }
 
-void gravity(){
-    if(curr == nullptr || curr->moveDown()){
-        setNewCurr();
+//----------------------------------------------------------------------------
+
+void publish(const Game& game) {
+    snapshots.back() = game.snapshot();
+    snapshots.publish();
+}
+
+// Waits for the next tick or at most a millisecond, so queued input is
+// picked up promptly. Returns true when a tick is due.
+bool wait_tick(chrono::steady_clock::time_point& nextTick, double interval) {
+    const auto step = chrono::duration_cast<chrono::steady_clock::duration>(
+        chrono::duration<double, milli>(interval));
+    const auto inputPoll = chrono::milliseconds(1);
+
+    auto now = chrono::steady_clock::now();
+    if(now >= nextTick){
+        nextTick += step;
+        // after a long stall, carry on from now instead of catching up
+        if(now > nextTick) nextTick = now + step;
+        return true;
     }
+    this_thread::sleep_until(min(nextTick, chrono::steady_clock::time_point(now + inputPoll)));
+    return false;
 }
 
-void update(int){
-    if(downPressed || ++updateCounter > REGULAR_GRAVITY_FACTOR) {
-        updateCounter = 0;
-        gravity();
-        glutPostRedisplay();
+void save_recording(ReplayRecorder& recorder, const Game& game) {
+    if(!recorder.recording()) return;
+    recorder.finish(game);
+    string path = recordPrefix + to_string(recordedGames++) + ".ttr";
+    if(recorder.save(path.c_str())) cout<<"saved replay "<<path<<" ("<<recorder.bytes().size()<<" bytes)\n";
+    else cout<<"failed to write replay "<<path<<"\n";
+}
+
+// The bot's key press for this tick, or on the tick after it's switched
+// off, its release of the down key.
+bool autoplay_input(const Game& game, Input& in) {
+    if(!autoplay.load(memory_order_relaxed)){
+        if(!autopilotDriving) return false;
+        autopilotDriving = false;
+        return autopilot->release(game, in);
+    }
+    if(autopilot == nullptr) autopilot = new Autopilot(thread::hardware_concurrency());
+    autopilotDriving = true;
+    return autopilot->step(game, in);
+}
+
+void simulate(unsigned int seed) {
+    Game game(seed);
+    ReplayRecorder recorder;
+    if(!recordPrefix.empty()) recorder.begin(game);
+    // made here rather than as a global: its Games can't be built before
+    // the piece shapes are
+    if(rewindBuffer == nullptr) rewindBuffer = new RewindBuffer<Game, REWIND_STATES>;
+    rewindBuffer->clear();
+    rewindBuffer->push(game);
+    bool paused = false;
+    if(feed) feed->publishBoard(game);
+    publish(game);
+
+    auto nextTick = chrono::steady_clock::now();
+    while(simRunning.load(memory_order_relaxed)){
+        bool changed = false;
+        Rewind_step step;
+        while(rewindSteps.pop(step)){
+            Game before = game;
+            if(step == REWIND_BACK ? rewindBuffer->back(game) : rewindBuffer->forward(game)){
+                // a replay can't follow a jump in time, so the recording
+                // ends here and starts again once play resumes
+                save_recording(recorder, before);
+                if(feed) feed->publishBoard(game);
+                paused = true;
+                changed = true;
+            }
+        }
+
+        Input in;
+        while(inputs.pop(in) || (control && control->poll(in))){
+            if(in == INPUT_RESTART) save_recording(recorder, game);
+            else{
+                if(paused && !recordPrefix.empty()) recorder.begin(game);
+                recorder.input(game, in);
+            }
+            game.input(in);
+            if(in == INPUT_RESTART){
+                if(!recordPrefix.empty()) recorder.begin(game);
+                rewindBuffer->clear();
+                rewindBuffer->push(game);
+                if(feed) feed->publishBoard(game);
+            }
+            paused = false;
+            changed = true;
+        }
 
-        if(gameOver) return; 
+        if(wait_tick(nextTick, UPDATE_INTERVAL) && !paused){
+            Game before = game;
+            if(game.tick()) rewindBuffer->push(game);
+            recorder.tick(game);
+            if(feed) feed->publishTick(before, game);
+            if(game.isOver() && !before.isOver()) save_recording(recorder, game);
+            if(autoplay_input(game, in)){
+                recorder.input(game, in);
+                game.input(in);
+            }
+            changed = true;
+        }
+
+        if(changed){
+            publish(game);
+            if(control) control->publish(game);
+        }
+        else if(control && control->ackPending()) control->publish(game);
     }
+    save_recording(recorder, game);
+}
+
+// Replay viewer: LEFT/RIGHT seek, UP/DOWN change speed, 'r' rewinds.
+void play_replay() {
+    ReplayPlayer player(replay);
+    publish(player.game());
+
+    auto nextTick = chrono::steady_clock::now();
+    while(simRunning.load(memory_order_relaxed)){
+        bool changed = false;
+        Input in;
+        while(inputs.pop(in)){
+            switch(in){
+                case INPUT_LEFT:
+                    player.seek(max(0LL, player.tick() - REPLAY_SEEK_TICKS));
+                    break;
+                case INPUT_RIGHT:
+                    player.seek(min(replay.finalTick, player.tick() + REPLAY_SEEK_TICKS));
+                    break;
+                case INPUT_ROTATE:
+                    replaySpeed *= 2;
+                    cout<<"replay speed "<<replaySpeed<<"x\n";
+                    break;
+                case INPUT_DOWN_PRESS:
+                    replaySpeed /= 2;
+                    cout<<"replay speed "<<replaySpeed<<"x\n";
+                    break;
+                case INPUT_RESTART:
+                    player.seek(0);
+                    break;
+                default:
+                    break;
+            }
+            changed = true;
+        }
 
-    glutTimerFunc(UPDATE_INTERVAL, update, 0);
+        if(wait_tick(nextTick, UPDATE_INTERVAL / replaySpeed) && player.step()) changed = true;
+
+        if(changed) publish(player.game());
+    }
 }
 
-void reset(){
-    init();
+// Versus: shows the local board, the match itself runs in versusSession.
+void play_versus(unsigned int seed) {
+    VersusLink link;
+    if(!link.open(versusPort, versusPeer, versusDelay, versusLoss, seed)){
+        cout<<"failed to bind udp port "<<versusPort<<"\n";
+        return;
+    }
+    if(versusSession == nullptr) versusSession = new RollbackSession;
+    RollbackSession& session = *versusSession;
+    session.start(versusPort < versusPeer ? 0 : 1, seed);
+    if(session.side() == 1) cout<<"waiting for the peer on port "<<versusPeer<<"\n";
+    publish(session.local());
+
+    bool announced = false;
+    auto nextTick = chrono::steady_clock::now();
+    while(simRunning.load(memory_order_relaxed)){
+        Input in;
+        while(inputs.pop(in)) session.localInput(in);
+
+        bool changed = session.poll(link);
+        if(wait_tick(nextTick, UPDATE_INTERVAL) && session.advance(link)) changed = true;
+
+        // only trust the result once it no longer rests on predictions
+        const VersusMatch& match = session.match();
+        if(match.isOver() && session.confirmed() && !announced){
+            if(match.winner() == session.side()) cout<<"\n\nYOU WON\n\n";
+            else if(match.winner() < 0) cout<<"\n\nDRAW\n\n";
+            announced = true;
+        }
+
+        if(changed) publish(session.local());
+    }
+
+    const VersusStats& stats = session.stats();
+    cout<<"versus: "<<stats.frames<<" frames, "<<stats.stalls<<" stalled, "<<stats.rollbacks
+        <<" rollbacks ("<<stats.resimulated<<" frames resimulated, "<<stats.maxRollbackUs<<" us max)\n";
+}
+
+// The wall: a BatchEnv played by the BatchPilot, every board published
+// after every step.
+void simulate_wall(int boards, unsigned int seed) {
+    BatchEnv env(boards, seed);
+    BatchPilot pilot;
+    vector<int> actions(boards);
+    auto publishWall = [&](){
+        WallFrame& f = wallFrames.back();
+        f.boards = boards;
+        f.rows.resize(2 * boards * NUM_ROWS);
+        for(int i=0; i<boards * NUM_ROWS; i++){
+            f.rows[2*i] = env.rows()[i];
+            f.rows[2*i + 1] = env.observations()[i];
+        }
+        wallFrames.publish();
+    };
+    publishWall();
+
+    auto nextTick = chrono::steady_clock::now();
+    while(simRunning.load(memory_order_relaxed)){
+        if(!wait_tick(nextTick, UPDATE_INTERVAL)) continue;
+        pilot.actions(env, &actions[0]);
+        env.step(&actions[0]);
+        publishWall();
+    }
+}
+
+void start_simulation() {
+    simRunning = true;
+    if(wallBoards) simThread = new thread(simulate_wall, wallBoards, (unsigned int)time(nullptr));
+    else if(versusPort) simThread = new thread(play_versus, (unsigned int)time(nullptr));
+    else if(replayData.empty()) simThread = new thread(simulate, (unsigned int)time(nullptr));
+    else simThread = new thread(play_replay);
+}
+
+void stop_simulation() {
+    if(simThread == nullptr) return;
+    simRunning = false;
+    simThread->join();
+    delete simThread;
+    simThread = nullptr;
+}
+
+void sendInput(Input in) {
+    if(!inputs.push(in)) cout<<"input queue full, dropping key press\n";
+}
+
+// GLUT side: redraw whenever the simulation has published something new
+void poll(int){
+    if(wallBoards){
+        if(wallFrames.update()) glutPostRedisplay();
+    }
+    else if(snapshots.update()){
+        const BoardSnapshot& frame = snapshots.front();
+        if(frame.gameOver && !shownGameOver) cout<<"\n\nYOU LOST\n\n";
+        shownGameOver = frame.gameOver;
+        glutPostRedisplay();
+    }
+    glutTimerFunc(REFRESH_INTERVAL, poll, 0);
+}
+
+// a capture takes exactly one frame per tick so the video has a fixed rate
+void capture_tick(int){
+    captureDue = true;
     glutPostRedisplay();
-    glutTimerFunc(UPDATE_INTERVAL, update, 0);
+    glutTimerFunc(UPDATE_INTERVAL, capture_tick, 0);
+}
+
+// Restarts the wall with this many games, after reporting the old count's
+// frame time.
+void resize_wall(int boards) {
+    boards = max(1, min(wallMaxBoards, boards));
+    if(boards == wallBoards) return;
+    report_wall();
+    stop_simulation();
+    wallBoards = boards;
+    wallCpuMs = wallGpuMs = 0;
+    wallCpuFrames = wallGpuFrames = 0;
+    start_simulation();
 }
 
 //----------------------------------------------------------------------------
+// rewind and autoplay belong to the local game; a replay or a versus
+// match has no thread reading them
+bool local_game() {
+    return replayData.empty() && !versusPort;
+}
+
 void keyboard(unsigned char key, int x, int y) {
+    // the wall only takes its own keys; there is no game to send input to
+    if(wallBoards){
+        switch ( key ) {
+            case '+':
+            case '=':
+                resize_wall(wallBoards * 2);
+                break;
+            case '-':
+                resize_wall(wallBoards / 2);
+                break;
+            case 's':
+                print_stats();
+                break;
+            case 'q':
+                exit( EXIT_SUCCESS );
+                break;
+        }
+        return;
+    }
     switch ( key ) {
         case 'r':
             cout<<"\n\nRESTART\n\n\n";
-            reset();
+            sendInput(INPUT_RESTART);
+            break;
+        case 's':
+            print_stats();
+            break;
+        case 'd':
+            writeBoardText(snapshots.front(), cout);
+            break;
+        case 'b':
+            if(local_game()) rewindSteps.push(REWIND_BACK);
+            break;
+        case 'f':
+            if(local_game()) rewindSteps.push(REWIND_FORWARD);
+            break;
+        case ' ':
+            if(control) break;
+            sendInput(INPUT_HARD_DROP);
+            break;
+        case 'a':
+            if(control || !local_game()) break;
+            autoplay = !autoplay;
+            cout<<"autoplay "<<(autoplay ? "on" : "off")<<endl;
             break;
         case 'q':
             exit( EXIT_SUCCESS );
@@ -450,45 +847,106 @@ void keyboard(unsigned char key, int x, int y) {
 
 void keyboardSpecial( int key, int x, int y )
 {
+    // the external controller owns the piece
+    if(control || wallBoards) return;
     switch(key){
         case GLUT_KEY_DOWN:
-            if(!downPressed){
-                downPressed=true;
-            }
+            sendInput(INPUT_DOWN_PRESS);
             break;
         case GLUT_KEY_UP:
-            curr->rotate();
-            glutPostRedisplay();
+            sendInput(INPUT_ROTATE);
             break;
         case GLUT_KEY_LEFT:
-            curr->moveHorizontal(false);
-            glutPostRedisplay();
+            sendInput(INPUT_LEFT);
             break;
         case GLUT_KEY_RIGHT:
-            curr->moveHorizontal(true);
-            glutPostRedisplay();
+            sendInput(INPUT_RIGHT);
             break;
     }
 }
 
 void keyboardSpecialUp( int key, int x, int y )
 {
+    if(control || wallBoards) return;
     switch(key){
         case GLUT_KEY_DOWN:
-            if(downPressed){
-                downPressed=false;
-            }
+            sendInput(INPUT_DOWN_RELEASE);
             break;
     }
 }
 
 //----------------------------------------------------------------------------
 
+// removes the shared memory objects, registered ahead of stop_simulation so
+// it runs after the game thread has stopped using them
+void close_shared_memory() {
+    if(feed) feed->close();
+    if(control) control->close();
+}
+
+void stop_capture() {
+    if(capture) capture->finish();
+}
+
 int main(int argc, char **argv) {
+    for(int i=0; i<NUM_COLORS; i++) SHAPE_COLORS[i] = vec3(PALETTE[i][0], PALETTE[i][1], PALETTE[i][2]);
 
     glutInit( &argc, argv );
+
+    const char* captureTarget = nullptr;
+    for(int i=1; i<argc; i++){
+        if(string(argv[i]) == "--capture" && i+1 < argc) captureTarget = argv[++i];
+        else if(string(argv[i]) == "--record" && i+1 < argc) recordPrefix = argv[++i];
+        else if(string(argv[i]) == "--speed" && i+1 < argc) replaySpeed = atof(argv[++i]);
+        else if(string(argv[i]) == "--versus" && i+2 < argc){
+            versusPort = atoi(argv[++i]);
+            versusPeer = atoi(argv[++i]);
+        }
+        else if(string(argv[i]) == "--feed"){
+            const char* name = FEED_DEFAULT_NAME;
+            if(i+1 < argc && argv[i+1][0] == '/') name = argv[++i];
+            feed = new FeedWriter();
+            if(!feed->open(name)) exit( EXIT_FAILURE );
+            cout<<"spectator feed at "<<name<<"\n";
+        }
+        else if(string(argv[i]) == "--control"){
+            const char* name = CONTROL_DEFAULT_NAME;
+            if(i+1 < argc && argv[i+1][0] == '/') name = argv[++i];
+            control = new ControlHost();
+            if(!control->open(name)) exit( EXIT_FAILURE );
+            cout<<"external control at "<<name<<", arrow keys disabled\n";
+        }
+        else if(string(argv[i]) == "--wall" && i+1 < argc){
+            wallBoards = atoi(argv[++i]);
+            if(wallBoards < 1 || wallBoards > MAX_WALL_BOARDS){
+                cerr<<"--wall takes 1 to "<<MAX_WALL_BOARDS<<" boards"<<endl;
+                exit( EXIT_FAILURE );
+            }
+        }
+        else if(string(argv[i]) == "--delay" && i+1 < argc) versusDelay = atof(argv[++i]);
+        else if(string(argv[i]) == "--loss" && i+1 < argc) versusLoss = atof(argv[++i]);
+        else if(string(argv[i]) == "--replay" && i+1 < argc){
+            ifstream in(argv[++i], ios::binary);
+            replayData.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+            if(replayData.empty() || !replay.open(&replayData[0], replayData.size())){
+                cerr<<argv[i]<<" is not a valid replay"<<endl;
+                exit( EXIT_FAILURE );
+            }
+        }
+    }
+    if(replaySpeed <= 0) replaySpeed = 1.0;
+    if(control && (!replayData.empty() || versusPort)){
+        cerr<<"--control drives a live single player game only"<<endl;
+        exit( EXIT_FAILURE );
+    }
+    if(wallBoards && (control || feed || versusPort || !replayData.empty() || !recordPrefix.empty())){
+        cerr<<"--wall shows bot games only, it can't be combined with another game mode"<<endl;
+        exit( EXIT_FAILURE );
+    }
+    int windowX = wallBoards ? WALL_WINDOW_X : WINDOW_SIZE_X;
+    int windowY = wallBoards ? WALL_WINDOW_Y : WINDOW_SIZE_Y;
     glutInitDisplayMode( GLUT_RGBA );
-    glutInitWindowSize( WINDOW_SIZE_X, WINDOW_SIZE_Y );
+    glutInitWindowSize( windowX, windowY );
 
     // If you are using freeglut, the next two lines will check if 
     // the code is truly 3.2. Otherwise, comment them out
@@ -501,15 +959,36 @@ int main(int argc, char **argv) {
     glewExperimental = GL_TRUE; 
     glewInit();
 
-    // Load shaders and use the resulting shader program
-    program = InitShader( "vshader.glsl", "fshader.glsl" );
-    glUseProgram( program );
-    // Load shader variables
-    vPosition = glGetAttribLocation( program, "vPosition" );
-    vColor = glGetAttribLocation( program, "vColor" );
-
     init();
-    init_grid_lines();
+    if(wallBoards){
+        init_wall();
+        if(wallBoards > wallMaxBoards){
+            cout<<"the GL limits the wall to "<<wallMaxBoards<<" boards\n";
+            wallBoards = wallMaxBoards;
+        }
+        cout<<"wall of "<<wallBoards<<" boards, '+' and '-' double and halve it\n";
+    }
+    else {
+        // Load shaders and use the resulting shader program
+        program = InitShader( "vshader.glsl", "fshader.glsl" );
+        glUseProgram( program );
+        // Load shader variables
+        vPosition = glGetAttribLocation( program, "vPosition" );
+        vColor = glGetAttribLocation( program, "vColor" );
+
+        init_grid_lines();
+    }
+    init_timer_queries();
+    glStatsInstallExitReport();
+
+    if(captureTarget){
+        capture = new FrameCapture(captureTarget, windowX, windowY);
+        if(!capture->ok()) exit( EXIT_FAILURE );
+        cout<<"capturing "<<windowX<<"x"<<windowY<<" rgb24 at "<<1000.0/UPDATE_INTERVAL<<" fps\n";
+        // finish while the context is still alive, on both 'q' and window close
+        atexit(stop_capture);
+        glutCloseFunc(stop_capture);
+    }
 
     glutDisplayFunc( display );
 
@@ -520,7 +999,11 @@ int main(int argc, char **argv) {
 
     glutIgnoreKeyRepeat(true);
 
-    glutTimerFunc(UPDATE_INTERVAL, update, 0);
+    atexit(close_shared_memory);
+    start_simulation();
+    atexit(stop_simulation);
+    glutTimerFunc(REFRESH_INTERVAL, poll, 0);
+    if(capture) glutTimerFunc(UPDATE_INTERVAL, capture_tick, 0);
 
     glutMainLoop();
     return 0;
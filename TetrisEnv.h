@@ -0,0 +1,56 @@
+/*
+ *  --- TetrisEnv.h ---
+ *
+ *  Plain C interface to BatchEnv for training code (Python ctypes/cffi,
+ *  C, anything with a C FFI). Build libtetrisenv.so with `make env`.
+ *
+ *  The arrays returned below point into the environment's own memory
+ *  and stay valid, with new contents after every step, until it is
+ *  destroyed, so a training loop can wrap them once and never copy.
+ *
+ *      observations  count * TETRIS_ENV_ROWS uint16, one bitboard per
+ *                    row (bit c = column c, row 0 at the bottom),
+ *                    settled cells and the falling piece
+ *      rewards       count floats, lines cleared by the last step
+ *      dones         count bytes, 1 where a game ended in the last step;
+ *                    it has already been restarted
+ */
+
+#ifndef __TETRISENV_H__
+#define __TETRISENV_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TETRIS_ENV_ROWS 20
+#define TETRIS_ENV_COLS 10
+
+/* actions, one per game per step */
+#define TETRIS_ACTION_LEFT 0
+#define TETRIS_ACTION_RIGHT 1
+#define TETRIS_ACTION_ROTATE 2
+#define TETRIS_ACTION_DOWN_PRESS 3
+#define TETRIS_ACTION_DOWN_RELEASE 4
+#define TETRIS_ACTION_NONE 5
+
+typedef struct TetrisEnv TetrisEnv;
+
+/* NULL when out of memory */
+TetrisEnv* tetris_env_create(int count, unsigned int seed);
+void tetris_env_destroy(TetrisEnv* env);
+int tetris_env_count(const TetrisEnv* env);
+
+/* seeds may be NULL to draw them from the seed given at creation */
+void tetris_env_reset(TetrisEnv* env, const unsigned int* seeds);
+void tetris_env_step(TetrisEnv* env, const int* actions);
+
+const unsigned short* tetris_env_observations(const TetrisEnv* env);
+const float* tetris_env_rewards(const TetrisEnv* env);
+const unsigned char* tetris_env_dones(const TetrisEnv* env);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TETRISENV_H__ */
@@ -0,0 +1,49 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- TripleBuffer.h ---
+//
+//   Lock-free single writer / single reader triple buffer. The writer
+//   always has a slot to fill and the reader always has a complete value
+//   to look at; publishing and picking up the latest value are a single
+//   atomic exchange each, so neither side can stall the other.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __TRIPLEBUFFER_H__
+#define __TRIPLEBUFFER_H__
+
+#include <atomic>
+
+template<typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : _middle(1) {}
+
+    // writer side: fill back() then publish() it
+    T& back() { return _slots[_back]; }
+
+    void publish() {
+        _back = _middle.exchange(_back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // reader side: update() swaps in the newest published value, if any,
+    // and returns whether front() changed
+    bool update() {
+        if(!(_middle.load(std::memory_order_relaxed) & FRESH)) return false;
+        _front = _middle.exchange(_front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    const T& front() const { return _slots[_front]; }
+
+private:
+    static const unsigned char INDEX = 3;
+    static const unsigned char FRESH = 4;
+
+    T _slots[3];
+    int _front = 0;                         // owned by the reader
+    int _back = 2;                          // owned by the writer
+    std::atomic<unsigned char> _middle;     // shared, index | FRESH
+};
+
+#endif // __TRIPLEBUFFER_H__
@@ -0,0 +1,42 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- Varint.h ---
+//
+//   LEB128 style variable length integers: 7 bits per byte, high bit set
+//   on every byte but the last. Values below 128 take a single byte.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __VARINT_H__
+#define __VARINT_H__
+
+#include <vector>
+
+inline void putVarint(std::vector<unsigned char>& out, unsigned long long v) {
+    while(v >= 0x80){
+        out.push_back((unsigned char)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((unsigned char)v);
+}
+
+// Reads one value and advances p. Returns false on truncated input.
+inline bool getVarint(const unsigned char*& p, const unsigned char* end, unsigned long long& v) {
+    v = 0;
+    for(int shift=0; p<end && shift<64; shift+=7){
+        unsigned char b = *p++;
+        v |= (unsigned long long)(b & 0x7F) << shift;
+        if(!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+inline void putU32(std::vector<unsigned char>& out, unsigned int v) {
+    for(int i=0; i<4; i++) out.push_back((unsigned char)(v >> (8*i)));
+}
+
+inline unsigned int getU32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+#endif // __VARINT_H__
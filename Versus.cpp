@@ -0,0 +1,279 @@
+#include "Versus.h"
+#include "Varint.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+const unsigned char VERSUS_MAGIC = 'V';
+
+//----------------------------------------------------------------------------
+
+void VersusMatch::reset(unsigned int seed) {
+    players[0].reset(seed);
+    players[1].reset(seed);
+    pendingGarbage[0] = pendingGarbage[1] = 0;
+    rng = seed ? seed : 1;
+    frame = 0;
+}
+
+void VersusMatch::step(const FrameInput in[2]) {
+    frame++;
+    if(isOver()) return;
+
+    int sent[2];
+    bool locked[2];
+    for(int i=0; i<2; i++){
+        Game& game = players[i];
+        long long lines = game.linesCleared();
+        long long pieces = game.piecesPlaced();
+        for(int k=INPUT_LEFT; k<=INPUT_HARD_DROP; k++){
+            if(k != INPUT_RESTART && (in[i] & (1 << k))) game.input(Input(k));
+        }
+        game.tick();
+        sent[i] = GARBAGE_FOR_LINES[min(game.linesCleared() - lines, 4LL)];
+        locked[i] = game.piecesPlaced() != pieces;
+    }
+
+    // lines sent first cancel garbage still waiting for the sender
+    for(int i=0; i<2; i++){
+        int cancel = min(sent[i], pendingGarbage[i]);
+        pendingGarbage[i] -= cancel;
+        pendingGarbage[1-i] += sent[i] - cancel;
+    }
+
+    // garbage rises when the receiver's next piece locks
+    for(int i=0; i<2; i++){
+        if(!locked[i] || pendingGarbage[i] == 0) continue;
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        players[i].addGarbage(pendingGarbage[i], rng % NUM_COLS);
+        pendingGarbage[i] = 0;
+    }
+}
+
+int VersusMatch::winner() const {
+    if(players[0].isOver() == players[1].isOver()) return -1;
+    return players[0].isOver() ? 1 : 0;
+}
+
+//----------------------------------------------------------------------------
+
+bool VersusLink::open(int localPort, int peerPort, double delayMs, double lossPercent, unsigned int seed) {
+    close();
+    _fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if(_fd < 0) return false;
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(localPort);
+    int on = 1;
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if(bind(_fd, (sockaddr*)&addr, sizeof(addr)) < 0 ||
+       fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK) < 0){
+        close();
+        return false;
+    }
+
+    _peerPort = peerPort;
+    _delay = chrono::duration_cast<chrono::steady_clock::duration>(
+        chrono::duration<double, milli>(delayMs));
+    _loss = lossPercent;
+    _rng = seed ? seed : 1;
+    _head = _count = 0;
+    return true;
+}
+
+void VersusLink::close() {
+    if(_fd >= 0) ::close(_fd);
+    _fd = -1;
+}
+
+void VersusLink::send(const unsigned char* data, int size, VersusStats& stats) {
+    if(_fd < 0 || size > VERSUS_MAX_PACKET) return;
+    stats.packetsSent++;
+
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+    if(_rng % 10000 < _loss * 100 || _count == QUEUE_SIZE){
+        stats.packetsDropped++;
+        return;
+    }
+
+    Delayed& d = _queue[(_head + _count++) % QUEUE_SIZE];
+    d.due = chrono::steady_clock::now() + _delay;
+    d.size = size;
+    memcpy(d.bytes, data, size);
+    flush();
+}
+
+void VersusLink::flush() {
+    sockaddr_in peer;
+    memset(&peer, 0, sizeof(peer));
+    peer.sin_family = AF_INET;
+    peer.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    peer.sin_port = htons(_peerPort);
+
+    auto now = chrono::steady_clock::now();
+    while(_count > 0 && _queue[_head].due <= now){
+        // a failed send is just one more lost packet
+        sendto(_fd, _queue[_head].bytes, _queue[_head].size, 0, (sockaddr*)&peer, sizeof(peer));
+        _head = (_head + 1) % QUEUE_SIZE;
+        _count--;
+    }
+}
+
+int VersusLink::receive(unsigned char* data, int capacity) {
+    if(_fd < 0) return 0;
+    ssize_t n = recv(_fd, data, capacity, 0);
+    return n > 0 ? n : 0;
+}
+
+//----------------------------------------------------------------------------
+
+void RollbackSession::start(int side, unsigned int seed) {
+    _side = side;
+    _seed = seed;
+    _started = side == 0;
+    _match.reset(seed);
+    _frame = 0;
+    _remoteFrames = 0;
+    _peerAck = 0;
+    _pendingCount = 0;
+    _stats = VersusStats();
+}
+
+void RollbackSession::localInput(Input in) {
+    if(in == INPUT_RESTART || _pendingCount == 16) return;
+    _pending[_pendingCount++] = in;
+}
+
+FrameInput RollbackSession::remoteInput(long long frame) const {
+    // predict that the peer pressed nothing new
+    return frame < _remoteFrames ? _inputs[1-_side][frame % VERSUS_HISTORY] : 0;
+}
+
+bool RollbackSession::advance(VersusLink& link) {
+    receive(link);
+    if(!_started) return false;
+
+    if(_frame - _remoteFrames >= VERSUS_MAX_ROLLBACK || _frame - _peerAck >= VERSUS_HISTORY - 1){
+        _stats.stalls++;
+        send(link);
+        return false;
+    }
+
+    // one of each input per frame, repeats carry over to the next
+    FrameInput mine = 0;
+    int kept = 0;
+    for(int i=0; i<_pendingCount; i++){
+        FrameInput bit = 1 << _pending[i];
+        if(mine & bit) _pending[kept++] = _pending[i];
+        else mine |= bit;
+    }
+    _pendingCount = kept;
+
+    int slot = _frame % VERSUS_HISTORY;
+    _inputs[_side][slot] = mine;
+    _states[slot] = _match;
+    FrameInput in[2];
+    in[_side] = mine;
+    in[1-_side] = remoteInput(_frame);
+    _predicted[slot] = in[1-_side];
+    _match.step(in);
+    _frame++;
+    _stats.frames++;
+
+    send(link);
+    return true;
+}
+
+bool RollbackSession::poll(VersusLink& link) {
+    link.flush();
+    return receive(link);
+}
+
+void RollbackSession::resimulate(long long from) {
+    auto t0 = chrono::steady_clock::now();
+
+    _match = _states[from % VERSUS_HISTORY];
+    for(long long f=from; f<_frame; f++){
+        int slot = f % VERSUS_HISTORY;
+        _states[slot] = _match;
+        FrameInput in[2];
+        in[_side] = _inputs[_side][slot];
+        in[1-_side] = remoteInput(f);
+        _predicted[slot] = in[1-_side];
+        _match.step(in);
+    }
+
+    double us = chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count();
+    _stats.rollbacks++;
+    _stats.resimulated += _frame - from;
+    _stats.maxRollback = max(_stats.maxRollback, _frame - from);
+    _stats.rollbackUs += us;
+    _stats.maxRollbackUs = max(_stats.maxRollbackUs, us);
+}
+
+// packet: magic, seed u32, then varints ack (peer inputs we hold), first
+// frame and count of our inputs that follow, one byte each
+bool RollbackSession::receive(VersusLink& link) {
+    unsigned char packet[VERSUS_MAX_PACKET];
+    long long rollbackFrom = -1;
+    int size;
+    while((size = link.receive(packet, sizeof(packet))) > 0){
+        const unsigned char* p = packet;
+        const unsigned char* end = packet + size;
+        if(size < 5 || *p++ != VERSUS_MAGIC) continue;
+        unsigned int seed = getU32(p);
+        p += 4;
+        unsigned long long ack, first, count;
+        if(!getVarint(p, end, ack) || !getVarint(p, end, first) || !getVarint(p, end, count)) continue;
+        if(count > (unsigned long long)(end - p)) continue;
+        _stats.packetsReceived++;
+
+        if(!_started){
+            _match.reset(seed);
+            _seed = seed;
+            _started = true;
+        }
+        _peerAck = max(_peerAck, min((long long)ack, _frame));
+
+        for(unsigned long long i=0; i<count; i++){
+            long long f = first + i;
+            if(f != _remoteFrames) continue;
+            int slot = f % VERSUS_HISTORY;
+            _inputs[1-_side][slot] = p[i];
+            if(f < _frame && p[i] != _predicted[slot] && rollbackFrom < 0) rollbackFrom = f;
+            _remoteFrames++;
+        }
+    }
+
+    if(rollbackFrom < 0) return false;
+    resimulate(rollbackFrom);
+    return true;
+}
+
+void RollbackSession::send(VersusLink& link) {
+    vector<unsigned char> packet;
+    packet.reserve(VERSUS_MAX_PACKET);
+    packet.push_back(VERSUS_MAGIC);
+    putU32(packet, _seed);
+    putVarint(packet, _remoteFrames);
+    putVarint(packet, _peerAck);
+    long long count = min(_frame - _peerAck, (long long)VERSUS_HISTORY);
+    putVarint(packet, count);
+    for(long long f=_peerAck; f<_peerAck+count; f++) packet.push_back(_inputs[_side][f % VERSUS_HISTORY]);
+    link.send(packet.data(), packet.size(), _stats);
+}
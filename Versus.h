@@ -0,0 +1,149 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- Versus.h ---
+//
+//   Two player versus over UDP with rollback. Both sides simulate the
+//   whole match: their own inputs apply at once, the opponent's are
+//   predicted (no new presses) until they arrive. When a late input
+//   differs from the prediction the session restores the match as it was
+//   on that frame and plays the frames since again. A match is two Game
+//   copies, so saving a frame is a plain copy into a preallocated ring.
+//
+//   VersusLink adds artificial delay and loss on the sending side so the
+//   whole thing can be exercised over 127.0.0.1.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __VERSUS_H__
+#define __VERSUS_H__
+
+#include "Game.h"
+
+#include <chrono>
+#include <vector>
+
+// how far a side may run ahead of the last input it has from its peer
+const int VERSUS_MAX_ROLLBACK = 32;
+// frames of inputs and saved states kept, power of two
+const int VERSUS_HISTORY = 128;
+const int VERSUS_MAX_PACKET = 256;
+
+// The inputs one player gave during a frame, bit (1 << Input) each.
+// They are applied in Input order, the same on both sides.
+typedef unsigned char FrameInput;
+
+// lines sent to the opponent for clearing 0, 1, 2, 3 or 4 lines at once
+const int GARBAGE_FOR_LINES[5] = { 0, 0, 1, 2, 4 };
+
+struct VersusMatch {
+    Game players[2];
+    int pendingGarbage[2] = { 0, 0 };
+    unsigned int rng = 1;
+    long long frame = 0;
+
+    // both players get the same piece sequence
+    void reset(unsigned int seed);
+    void step(const FrameInput in[2]);
+
+    bool isOver() const { return players[0].isOver() || players[1].isOver(); }
+    // 0 or 1, -1 while running or when both topped out on the same frame
+    int winner() const;
+};
+
+struct VersusStats {
+    long long frames = 0;
+    long long stalls = 0;
+    long long rollbacks = 0;
+    long long resimulated = 0;
+    long long maxRollback = 0;
+    double rollbackUs = 0;
+    double maxRollbackUs = 0;
+    long long packetsSent = 0;
+    long long packetsDropped = 0;
+    long long packetsReceived = 0;
+};
+
+class VersusLink {
+public:
+    VersusLink() {}
+    ~VersusLink() { close(); }
+    VersusLink(const VersusLink&) = delete;
+    VersusLink& operator=(const VersusLink&) = delete;
+
+    // Binds 127.0.0.1:localPort and sends to 127.0.0.1:peerPort. Every
+    // packet is held back delayMs and dropped with lossPercent chance.
+    bool open(int localPort, int peerPort, double delayMs, double lossPercent, unsigned int seed);
+    void close();
+
+    void send(const unsigned char* data, int size, VersusStats& stats);
+    // Puts packets whose delay has passed on the wire.
+    void flush();
+    // Non-blocking, returns the packet size or 0 when nothing is waiting.
+    int receive(unsigned char* data, int capacity);
+
+private:
+    struct Delayed {
+        std::chrono::steady_clock::time_point due;
+        int size;
+        unsigned char bytes[VERSUS_MAX_PACKET];
+    };
+    static const int QUEUE_SIZE = 64;
+
+    int _fd = -1;
+    int _peerPort = 0;
+    std::chrono::steady_clock::duration _delay;
+    double _loss = 0;
+    unsigned int _rng = 1;
+    Delayed _queue[QUEUE_SIZE];
+    int _head = 0, _count = 0;
+};
+
+class RollbackSession {
+public:
+    // side 0 chooses the seed, side 1 (seed ignored) learns it from the
+    // first packet and cannot advance before that.
+    void start(int side, unsigned int seed);
+
+    // Queues a local input for the next frame. A second press of the same
+    // input waits for the frame after. INPUT_RESTART is ignored.
+    void localInput(Input in);
+
+    // Takes in the peer's inputs, rolling back as needed, then simulates
+    // one frame. Returns false when stalled waiting for the peer.
+    bool advance(VersusLink& link);
+    // Takes in the peer's inputs between frames. Returns true when a
+    // rollback changed the current state.
+    bool poll(VersusLink& link);
+    // Resends the inputs the peer has not acknowledged yet. advance()
+    // does this every frame, also while stalled.
+    void send(VersusLink& link);
+
+    int side() const { return _side; }
+    const VersusMatch& match() const { return _match; }
+    const Game& local() const { return _match.players[_side]; }
+    long long frame() const { return _frame; }
+    // true when every frame simulated so far used real peer inputs
+    bool confirmed() const { return _frame <= _remoteFrames; }
+    const VersusStats& stats() const { return _stats; }
+
+private:
+    bool receive(VersusLink& link);
+    void resimulate(long long from);
+    FrameInput remoteInput(long long frame) const;
+
+    int _side = 0;
+    bool _started = false;
+    unsigned int _seed = 0;
+    VersusMatch _match;
+    long long _frame = 0;
+    long long _remoteFrames = 0;    // peer inputs received, in order
+    long long _peerAck = 0;         // our inputs the peer has
+    FrameInput _inputs[2][VERSUS_HISTORY];
+    FrameInput _predicted[VERSUS_HISTORY];
+    VersusMatch _states[VERSUS_HISTORY];    // match at the start of each frame
+    Input _pending[16];
+    int _pendingCount = 0;
+    VersusStats _stats;
+};
+
+#endif // __VERSUS_H__
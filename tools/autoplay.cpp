@@ -0,0 +1,104 @@
+// tetris-autoplay: the heuristic bot playing headless games.
+//
+//   tetris-autoplay [--games n] [--pieces n] [--threads n] [--seed s]
+//                   [--one-ply] [--record prefix] [--weights h,l,o,b]
+//                   [--book file]
+//
+// Plays n games with the Autopilot, one key press per tick like the
+// in-game autoplay, each until it ends or has placed --pieces pieces.
+// Reports pieces and lines per game and how long the searches took, the
+// figure that has to stay well inside a tick. --one-ply hides the preview
+// from the search, for comparison. --record saves each game as a replay,
+// which the game and tetris-replay can play back. --weights replaces the
+// default weights for height, lines, holes and bumpiness, e.g. with ones
+// from tetris-tune. --book plays the openings from a tetris-book file.
+
+#include "Bot.h"
+#include "OpeningBook.h"
+#include "Replay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+int main(int argc, char **argv) {
+    int games = 5;
+    long long maxPieces = 1000;
+    int threads = thread::hardware_concurrency();
+    unsigned int seed = 1;
+    bool onePly = false;
+    string recordPrefix;
+    const char* bookPath = nullptr;
+    BotWeights weights;
+    for(int i=1; i<argc; i++){
+        if(strcmp(argv[i], "--games") == 0 && i+1 < argc) games = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--pieces") == 0 && i+1 < argc) maxPieces = atoll(argv[++i]);
+        else if(strcmp(argv[i], "--threads") == 0 && i+1 < argc) threads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0 && i+1 < argc) seed = strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "--one-ply") == 0) onePly = true;
+        else if(strcmp(argv[i], "--record") == 0 && i+1 < argc) recordPrefix = argv[++i];
+        else if(strcmp(argv[i], "--book") == 0 && i+1 < argc) bookPath = argv[++i];
+        else if(strcmp(argv[i], "--weights") == 0 && i+1 < argc
+                && sscanf(argv[++i], "%f,%f,%f,%f", &weights.height, &weights.lines, &weights.holes, &weights.bumpiness) == 4) continue;
+        else {
+            cerr<<"Usage: "<<argv[0]<<" [--games n] [--pieces n] [--threads n] [--seed s] [--one-ply] [--record prefix]"
+                <<" [--weights h,l,o,b] [--book file]"<<endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if(games < 1 || maxPieces < 1) return EXIT_FAILURE;
+    threads = max(1, threads);
+
+    Autopilot pilot(threads, weights);
+    pilot.bot().setLookahead(!onePly);
+    OpeningBook book;
+    if(bookPath){
+        if(!book.open(bookPath)){
+            cerr<<"Failed to open "<<bookPath<<endl;
+            return EXIT_FAILURE;
+        }
+        pilot.bot().setBook(&book);
+    }
+    long long totalPieces = 0, totalLines = 0, totalTicks = 0;
+    auto start = chrono::steady_clock::now();
+    for(int g=0; g<games; g++){
+        Game game(seed + g);
+        ReplayRecorder recorder;
+        if(!recordPrefix.empty()) recorder.begin(game);
+        while(!game.isOver() && game.piecesPlaced() < maxPieces){
+            Input in;
+            if(pilot.step(game, in)){
+                recorder.input(game, in);
+                game.input(in);
+            }
+            game.tick();
+            recorder.tick(game);
+        }
+        if(!recordPrefix.empty()){
+            recorder.finish(game);
+            string path = recordPrefix + to_string(g) + ".ttr";
+            if(!recorder.save(path.c_str())) cerr<<"Failed to write "<<path<<endl;
+        }
+        cout<<"game "<<g<<": "<<game.piecesPlaced()<<" pieces, "<<game.linesCleared()<<" lines"
+            <<(game.isOver() ? ", topped out" : "")<<"\n";
+        totalPieces += game.piecesPlaced();
+        totalLines += game.linesCleared();
+        totalTicks += game.ticks();
+    }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout<<games<<" games, "<<threads<<" threads: "<<(double)totalPieces / games<<" pieces and "
+        <<(double)totalLines / games<<" lines per game, "<<totalTicks / max(secs, 1e-9)<<" ticks/s\n"
+        <<"search "<<pilot.searchMicros() / max(1LL, pilot.searches())<<" us average, "
+        <<pilot.maxSearchMicros()<<" us worst, against a "<<UPDATE_INTERVAL * 1000<<" us tick";
+    if(bookPath) cout<<", "<<pilot.bot().bookMoves()<<" moves from the book";
+    cout<<endl;
+    return EXIT_SUCCESS;
+}
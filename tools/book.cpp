@@ -0,0 +1,198 @@
+// tetris-book: builds and checks opening books (OpeningBook.h).
+//
+//   tetris-book --out file [--pieces n] [--depth d] [--threads n] [--tt-mb n]
+//   tetris-book --check file [--games n] [--seed s]
+//
+// Building starts from the empty board. Every piece, with every preview,
+// gets the Expectimax's choice at --depth chance layers. The boards those
+// leave, each once, make up the next level, until --pieces pieces into
+// the game. Positions are shared out over the threads, each with its own
+// search and transposition table.
+//
+// --check maps a book and plays random piece sequences from the empty
+// board on the book's own moves. It reports any position it didn't find
+// or placement the piece can't reach, then the time to open the book and
+// to look a position up.
+
+#include "Expectimax.h"
+#include "OpeningBook.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+struct Board {
+    BoardRows rows;
+
+    bool operator<(const Board& other) const { return memcmp(rows, other.rows, sizeof(rows)) < 0; }
+    bool operator==(const Board& other) const { return memcmp(rows, other.rows, sizeof(rows)) == 0; }
+};
+
+static int build(const char* path, int pieces, int depth, int threads, size_t ttMb) {
+    vector<unique_ptr<Expectimax>> searches;
+    for(int t=0; t<threads; t++) searches.emplace_back(new Expectimax(1, ttMb));
+    const PieceTable& t = pieceTable();
+
+    vector<BookMove> moves;
+    vector<Board> level(1, Board());
+    memset(level[0].rows, 0, sizeof(level[0].rows));
+    auto start = chrono::steady_clock::now();
+    for(int d=0; d<pieces; d++){
+        // one job per board, piece and preview
+        const int PER_BOARD = NUM_SHAPES * NUM_SHAPES;
+        size_t jobs = level.size() * PER_BOARD;
+        vector<BookMove> found(jobs);
+        vector<Board> children(jobs);
+        vector<bool> placed(jobs, false);
+        atomic<size_t> next(0);
+        auto work = [&](int thread){
+            Expectimax& search = *searches[thread];
+            for(size_t i=next++; i<jobs; i=next++){
+                const Board& b = level[i / PER_BOARD];
+                int shape = i % PER_BOARD / NUM_SHAPES, preview = i % NUM_SHAPES;
+                Expectimax::Result result;
+                if(!search.search(b.rows, shape, 0, SPAWN_X, SPAWN_Y, preview, depth, 0, result)) continue;
+                found[i].key = bookKey(b.rows, shape, preview);
+                found[i].placement = result.best;
+                children[i] = b;
+                t.lock(children[i].rows, shape, result.best.orient, result.best.x, result.best.y);
+                placed[i] = true;
+            }
+        };
+        vector<thread> workers;
+        for(int k=1; k<threads; k++) workers.emplace_back(work, k);
+        work(0);
+        for(auto& w: workers) w.join();
+
+        vector<Board> nextLevel;
+        for(size_t i=0; i<jobs; i++){
+            if(!placed[i]) continue;
+            moves.push_back(found[i]);
+            nextLevel.push_back(children[i]);
+        }
+        sort(nextLevel.begin(), nextLevel.end());
+        nextLevel.erase(unique(nextLevel.begin(), nextLevel.end()), nextLevel.end());
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout<<"piece "<<d + 1<<": "<<level.size()<<" boards, "<<jobs<<" positions, "<<secs<<" s so far"<<endl;
+        level.swap(nextLevel);
+    }
+
+    // a board can come up at two depths, after a line clear
+    sort(moves.begin(), moves.end(), [](const BookMove& a, const BookMove& b){ return a.key < b.key; });
+    moves.erase(unique(moves.begin(), moves.end(), [](const BookMove& a, const BookMove& b){ return a.key == b.key; }), moves.end());
+    if(!writeOpeningBook(path, moves, pieces, depth)){
+        cerr<<"Failed to write "<<path<<endl;
+        return EXIT_FAILURE;
+    }
+    cout<<moves.size()<<" positions written to "<<path<<endl;
+    return EXIT_SUCCESS;
+}
+
+static int check(const char* path, int games, unsigned int rng) {
+    auto random = [&rng](){
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+    };
+    auto start = chrono::steady_clock::now();
+    OpeningBook book;
+    if(!book.open(path)){
+        cerr<<"Failed to open "<<path<<endl;
+        return EXIT_FAILURE;
+    }
+    double openUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+    const BookHeader& h = book.header();
+    cout<<path<<": "<<h.entries<<" positions in "<<h.slots<<" slots, "<<h.pieces<<" pieces deep, searched "
+        <<h.depth<<" chance layers; opened in "<<openUs<<" us"<<endl;
+
+    const PieceTable& t = pieceTable();
+    PlacementFinder finder;
+    static Placement out[MAX_PLACEMENTS];
+    struct Position {
+        BoardRows rows;
+        int shape, next;
+    };
+    vector<Position> positions;
+    long long missing = 0, unreachable = 0;
+    for(int g=0; g<games; g++){
+        BoardRows rows = {};
+        int shape = random() % NUM_SHAPES;
+        for(unsigned int d=0; d<h.pieces; d++){
+            int next = random() % NUM_SHAPES;
+            Position p;
+            memcpy(p.rows, rows, sizeof(rows));
+            p.shape = shape;
+            p.next = next;
+            positions.push_back(p);
+
+            Placement move;
+            if(!book.lookup(rows, shape, next, move)){
+                missing++;
+                break;
+            }
+            int n = finder.find(rows, shape, out);
+            bool reachable = false;
+            for(int i=0; i<n && !reachable; i++) reachable = out[i].x == move.x && out[i].y == move.y && out[i].orient == move.orient;
+            if(!reachable){
+                unreachable++;
+                break;
+            }
+            t.lock(rows, shape, move.orient, move.x, move.y);
+            shape = next;
+        }
+    }
+
+    const long long LOOKUPS = 4000000;
+    long long hits = 0;
+    start = chrono::steady_clock::now();
+    for(long long i=0; i<LOOKUPS; i++){
+        const Position& p = positions[i % positions.size()];
+        Placement move;
+        hits += book.lookup(p.rows, p.shape, p.next, move);
+    }
+    double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / LOOKUPS;
+
+    cout<<positions.size()<<" positions from "<<games<<" games: "<<missing<<" missing, "<<unreachable<<" unreachable; "
+        <<ns<<" ns a lookup ("<<hits * 100.0 / LOOKUPS<<"% hits)"<<endl;
+    return missing || unreachable ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+    const char* outPath = nullptr;
+    const char* checkPath = nullptr;
+    int pieces = 3, depth = 1, games = 10000;
+    int threads = thread::hardware_concurrency();
+    size_t ttMb = 16;
+    unsigned int seed = 1;
+    for(int i=1; i<argc; i++){
+        if(strcmp(argv[i], "--out") == 0 && i+1 < argc) outPath = argv[++i];
+        else if(strcmp(argv[i], "--check") == 0 && i+1 < argc) checkPath = argv[++i];
+        else if(strcmp(argv[i], "--pieces") == 0 && i+1 < argc) pieces = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--depth") == 0 && i+1 < argc) depth = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--threads") == 0 && i+1 < argc) threads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--tt-mb") == 0 && i+1 < argc) ttMb = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--games") == 0 && i+1 < argc) games = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0 && i+1 < argc) seed = strtoul(argv[++i], nullptr, 10);
+        else {
+            outPath = checkPath = nullptr;
+            break;
+        }
+    }
+    if((outPath == nullptr) == (checkPath == nullptr)){
+        cerr<<"Usage: "<<argv[0]<<" --out file [--pieces n] [--depth d] [--threads n] [--tt-mb n]"<<endl;
+        cerr<<"       "<<argv[0]<<" --check file [--games n] [--seed s]"<<endl;
+        return EXIT_FAILURE;
+    }
+    if(checkPath) return games > 0 && seed != 0 ? check(checkPath, games, seed) : EXIT_FAILURE;
+    if(pieces < 1 || depth < 0 || depth > EXPECTIMAX_MAX_DEPTH) return EXIT_FAILURE;
+    return build(outPath, pieces, depth, max(1, threads), max<size_t>(1, ttMb));
+}
@@ -0,0 +1,129 @@
+// tetris-clears: the cost of locking a piece and clearing lines as the
+// stack grows.
+//
+//   tetris-clears [--locks n] [--seed s]
+//
+// For stacks of 0 up to NUM_ROWS - 4 rows, each row full but for a hole
+// and the top ones sharing a well, locks random reachable placements with
+// PieceTable::lock and checks each board against a plain compaction of
+// every row. Then times the same through a Game: garbage builds the
+// stack, a few random moves and a hard drop place the piece, and the next
+// tick locks it. Reports nanoseconds per lock and lines per lock.
+
+#include "Placement.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+// every row checked, every row moved
+static int referenceLock(unsigned short* rows, int shape, const Placement& p) {
+    const PieceTable& t = pieceTable();
+    for(int k=0; k<PIECE_CELLS; k++) rows[p.y + t.dy[shape][p.orient][k]] |= 1 << (p.x + t.dx[shape][p.orient][k]);
+    int dst = 0;
+    for(int src=0; src<NUM_ROWS; src++){
+        if(rows[src] != FULL_ROW) rows[dst++] = rows[src];
+    }
+    int cleared = NUM_ROWS - dst;
+    for(; dst<NUM_ROWS; dst++) rows[dst] = 0;
+    return cleared;
+}
+
+struct LockJob {
+    BoardRows rows;
+    int shape;
+    Placement p;
+};
+
+int main(int argc, char **argv) {
+    long long locks = 2000000;
+    unsigned int rng = 1;
+    for(int i=1; i<argc; i++){
+        if(strcmp(argv[i], "--locks") == 0 && i+1 < argc) locks = atoll(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0 && i+1 < argc) rng = strtoul(argv[++i], nullptr, 10);
+        else {
+            cerr<<"Usage: "<<argv[0]<<" [--locks n] [--seed s]"<<endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if(locks < 1 || rng == 0) return EXIT_FAILURE;
+    auto random = [&rng](){
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+    };
+
+    // few enough jobs to stay in cache, so the lock is what gets timed
+    const int JOBS = 4096;
+    const PieceTable& t = pieceTable();
+    PlacementFinder finder;
+    static Placement out[MAX_PLACEMENTS];
+    long long errors = 0;
+    for(int stack=0; stack<=NUM_ROWS-4; stack+=4){
+        vector<LockJob> jobs;
+        while(jobs.size() < JOBS){
+            LockJob job;
+            int well = random() % NUM_COLS;
+            for(int r=0; r<NUM_ROWS; r++){
+                int hole = r >= stack - 4 ? well : random() % NUM_COLS;
+                job.rows[r] = r < stack ? FULL_ROW & ~(1 << hole) : 0;
+            }
+            job.shape = random() % NUM_SHAPES;
+            int found = finder.find(job.rows, job.shape, out);
+            if(found == 0) continue;
+            job.p = out[random() % found];
+            jobs.push_back(job);
+        }
+
+        long long lines = 0;
+        for(const LockJob& job: jobs){
+            BoardRows fast, slow;
+            memcpy(fast, job.rows, sizeof(fast));
+            memcpy(slow, job.rows, sizeof(slow));
+            int n = t.lock(fast, job.shape, job.p.orient, job.p.x, job.p.y);
+            lines += n;
+            if(n != referenceLock(slow, job.shape, job.p) || memcmp(fast, slow, sizeof(fast)) != 0) errors++;
+        }
+
+        long long sum = 0;
+        auto t0 = chrono::steady_clock::now();
+        for(long long i=0; i<locks; i++){
+            const LockJob& job = jobs[i % JOBS];
+            BoardRows rows;
+            memcpy(rows, job.rows, sizeof(rows));
+            sum += t.lock(rows, job.shape, job.p.orient, job.p.x, job.p.y) + rows[0];
+        }
+        double tableNs = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / locks;
+
+        // the same stacks in Games, the piece wherever a few moves put it
+        vector<Game> games;
+        for(int i=0; i<JOBS; i++){
+            Game game(random());
+            game.addGarbage(stack, random() % NUM_COLS);
+            int moves = random() % 8;
+            for(int m=0; m<moves; m++) game.input(Input(random() % 3));
+            if(!game.isOver()) games.push_back(game);
+        }
+        long long gameLines = 0, gameLocks = 0;
+        t0 = chrono::steady_clock::now();
+        for(long long i=0; i<locks / 4; i++){
+            Game game = games[i % games.size()];
+            game.input(INPUT_HARD_DROP);
+            game.tick();
+            gameLocks += game.piecesPlaced();
+            gameLines += game.linesCleared();
+        }
+        double gameNs = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / (locks / 4);
+
+        cout<<"stack "<<stack<<": PieceTable::lock "<<tableNs<<" ns, "<<(double)lines / JOBS<<" lines a lock; Game "
+            <<gameNs<<" ns for a copy, drop and lock, "<<(double)gameLines / max(1LL, gameLocks)<<" lines a lock (checksum "
+            <<sum % 1000<<")"<<endl;
+    }
+    cout<<"checked against a full compaction: "<<errors<<" mismatches"<<endl;
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
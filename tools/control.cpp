@@ -0,0 +1,119 @@
+// tetris-control: round trip latency of the shared memory controller.
+//
+//   tetris-control [--name /control] [--count n] [--self [--spin]]
+//
+// Sends n commands, one at a time, to a game started with --control and
+// times each one until the game's published view acknowledges it. With
+// --self the game loop runs headless in this process instead, polling
+// once a millisecond like the real one, or nonstop with --spin to show
+// what the shared memory path itself costs.
+
+#include "ExternalControl.h"
+#include "Game.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// the GL front end's simulate() loop, minus everything but the controller
+void hostLoop(ControlHost* host, atomic<bool>* running, bool spin) {
+    Game game(1);
+    host->publish(game);
+    auto nextTick = chrono::steady_clock::now();
+    const auto interval = chrono::duration_cast<chrono::steady_clock::duration>(
+        chrono::duration<double, milli>(UPDATE_INTERVAL));
+    while(running->load(memory_order_relaxed)){
+        bool changed = false;
+        Input in;
+        while(host->poll(in)){
+            if(game.isOver() && in != INPUT_RESTART) game.input(INPUT_RESTART);
+            game.input(in);
+            changed = true;
+        }
+        if(chrono::steady_clock::now() >= nextTick){
+            nextTick += interval;
+            game.tick();
+            changed = true;
+        }
+        if(changed || host->ackPending()) host->publish(game);
+        if(spin) this_thread::yield();
+        else this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
+
+int main(int argc, char **argv) {
+    const char* name = CONTROL_DEFAULT_NAME;
+    int count = 1000;
+    bool self = false, spin = false;
+    for(int i=1; i<argc; i++){
+        if(strcmp(argv[i], "--name") == 0 && i+1 < argc) name = argv[++i];
+        else if(strcmp(argv[i], "--count") == 0 && i+1 < argc) count = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--self") == 0) self = true;
+        else if(strcmp(argv[i], "--spin") == 0) spin = true;
+        else {
+            cerr<<"Usage: "<<argv[0]<<" [--name /control] [--count n] [--self [--spin]]"<<endl;
+            return EXIT_FAILURE;
+        }
+    }
+    count = max(count, 1);
+
+    ControlHost host;
+    atomic<bool> running(true);
+    thread game;
+    if(self){
+        // never take over the region of a game that may be running
+        name = "/tetris-control-bench";
+        if(!host.open(name)) return EXIT_FAILURE;
+        game = thread(hostLoop, &host, &running, spin);
+    }
+
+    ControlClient client;
+    if(!client.open(name)){
+        cerr<<"No control region at "<<name<<" (start the game with --control)"<<endl;
+        running = false;
+        if(game.joinable()) game.join();
+        return EXIT_FAILURE;
+    }
+
+    vector<double> rtt;
+    rtt.reserve(count);
+    ControlView view;
+    auto start = chrono::steady_clock::now();
+    for(int i=0; i<count; i++){
+        auto t0 = chrono::steady_clock::now();
+        unsigned int id = client.send(i % 2 ? INPUT_RIGHT : INPUT_LEFT);
+        if(id == 0){
+            cerr<<"command queue full, is the game running?"<<endl;
+            break;
+        }
+        auto deadline = t0 + chrono::seconds(2);
+        do {
+            this_thread::yield();
+            client.read(view);
+        } while((int)(view.ack - id) < 0 && chrono::steady_clock::now() < deadline);
+        if((int)(view.ack - id) < 0){
+            cerr<<"no acknowledgement for command "<<id<<", is the game running?"<<endl;
+            break;
+        }
+        rtt.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count());
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    running = false;
+    if(game.joinable()) game.join();
+    if(rtt.empty()) return EXIT_FAILURE;
+
+    sort(rtt.begin(), rtt.end());
+    auto pct = [&rtt](double p){ return rtt[min(rtt.size() - 1, (size_t)(p * rtt.size()))]; };
+    cout<<rtt.size()<<" round trips in "<<seconds<<" s ("<<rtt.size() / seconds<<"/s)\n";
+    cout<<"  min "<<rtt.front()<<" us, p50 "<<pct(0.5)<<" us, p99 "<<pct(0.99)<<" us, max "<<rtt.back()<<" us\n";
+    cout<<"  game at tick "<<view.tick<<", "<<view.piecesPlaced<<" pieces, "<<view.linesCleared<<" lines"<<endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,178 @@
+// tetris-corpus: replays every .ttr file under a directory through the
+// headless engine in parallel and checks each reproduces its recorded
+// final board, pieces and lines.
+//
+//   tetris-corpus [-j threads] [-v] dir...
+//
+// Files are memory mapped and parsed in place, so a corpus of any size is
+// never read into or copied through our own buffers.
+
+#include "Game.h"
+#include "Replay.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+struct CorpusStats {
+    long long files = 0;
+    long long bytes = 0;
+    long long invalid = 0;
+    long long mismatches = 0;
+    long long gamesOver = 0;
+    long long ticks = 0;
+    long long pieces = 0;
+    long long lines = 0;
+    long long maxLines = 0;
+    long long maxTicks = 0;
+
+    void add(const CorpusStats& o){
+        files += o.files;
+        bytes += o.bytes;
+        invalid += o.invalid;
+        mismatches += o.mismatches;
+        gamesOver += o.gamesOver;
+        ticks += o.ticks;
+        pieces += o.pieces;
+        lines += o.lines;
+        maxLines = max(maxLines, o.maxLines);
+        maxTicks = max(maxTicks, o.maxTicks);
+    }
+};
+
+void findReplays(const string& dir, vector<string>& out) {
+    DIR* d = opendir(dir.c_str());
+    if(d == NULL){
+        cerr<<"Failed to open "<<dir<<endl;
+        return;
+    }
+    while(dirent* e = readdir(d)){
+        string name = e->d_name;
+        if(name == "." || name == "..") continue;
+        string path = dir + "/" + name;
+        struct stat st;
+        if(stat(path.c_str(), &st) != 0) continue;
+        if(S_ISDIR(st.st_mode)) findReplays(path, out);
+        else if(name.size() > 4 && name.compare(name.size() - 4, 4, ".ttr") == 0) out.push_back(path);
+    }
+    closedir(d);
+}
+
+// Maps one file read-only; the mapping goes away with the object.
+class MappedFile {
+public:
+    explicit MappedFile(const char* path) {
+        int fd = open(path, O_RDONLY);
+        if(fd < 0) return;
+        struct stat st;
+        if(fstat(fd, &st) == 0 && st.st_size > 0){
+            void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(p != MAP_FAILED){
+                madvise(p, st.st_size, MADV_SEQUENTIAL);
+                _data = (const unsigned char*)p;
+                _size = st.st_size;
+            }
+        }
+        close(fd);
+    }
+    ~MappedFile() {
+        if(_data) munmap((void*)_data, _size);
+    }
+
+    const unsigned char* data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    const unsigned char* _data = nullptr;
+    size_t _size = 0;
+};
+
+int main(int argc, char **argv) {
+    int threads = thread::hardware_concurrency();
+    bool verbose = false;
+    vector<string> files;
+    for(int i=1; i<argc; i++){
+        if(strcmp(argv[i], "-j") == 0 && i+1 < argc) threads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-v") == 0) verbose = true;
+        else findReplays(argv[i], files);
+    }
+    if(argc < 2){
+        cerr<<"usage: "<<argv[0]<<" [-j threads] [-v] dir..."<<endl;
+        return EXIT_FAILURE;
+    }
+    threads = max(1, threads);
+    sort(files.begin(), files.end());
+
+    atomic<size_t> next(0);
+    mutex reportLock;
+    CorpusStats total;
+
+    auto work = [&]{
+        CorpusStats stats;
+        for(size_t i=next++; i<files.size(); i=next++){
+            const char* path = files[i].c_str();
+            MappedFile file(path);
+            Replay replay;
+            stats.files++;
+            stats.bytes += file.size();
+            if(file.data() == nullptr || !replay.open(file.data(), file.size())){
+                stats.invalid++;
+                lock_guard<mutex> guard(reportLock);
+                cout<<path<<": not a valid replay\n";
+                continue;
+            }
+
+            ReplayPlayer player(replay);
+            if(!player.verify()){
+                stats.mismatches++;
+                lock_guard<mutex> guard(reportLock);
+                cout<<path<<": MISMATCH, recorded "<<replay.piecesPlaced<<" pieces / "<<replay.linesCleared
+                    <<" lines, replayed "<<player.game().piecesPlaced()<<" / "<<player.game().linesCleared()<<"\n";
+            }
+            else if(verbose){
+                lock_guard<mutex> guard(reportLock);
+                cout<<path<<": ok\n";
+            }
+            stats.gamesOver += replay.gameOver;
+            stats.ticks += player.tick();
+            stats.pieces += replay.piecesPlaced;
+            stats.lines += replay.linesCleared;
+            stats.maxLines = max(stats.maxLines, replay.linesCleared);
+            stats.maxTicks = max(stats.maxTicks, replay.finalTick);
+        }
+        lock_guard<mutex> guard(reportLock);
+        total.add(stats);
+    };
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for(int t=1; t<threads; t++) workers.emplace_back(work);
+    work();
+    for(auto& t: workers) t.join();
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    double games = max(1LL, total.files - total.invalid);
+    cout<<"\n"<<total.files<<" replays, "<<total.bytes / 1.0e6<<" MB, "<<threads<<" threads, "<<secs<<" s\n"
+        <<"  invalid: "<<total.invalid<<"  mismatches: "<<total.mismatches<<"  finished games: "<<total.gamesOver<<"\n"
+        <<"  per game: "<<total.ticks / games<<" ticks, "<<total.pieces / games<<" pieces, "<<total.lines / games<<" lines\n"
+        <<"  best: "<<total.maxLines<<" lines, longest: "<<total.maxTicks<<" ticks\n"
+        <<"  "<<total.files / max(secs, 1e-9)<<" replays/s, "<<total.ticks / max(secs, 1e-9)<<" ticks/s, "
+        <<total.bytes / 1.0e6 / max(secs, 1e-9)<<" MB/s"<<endl;
+
+    return total.invalid || total.mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
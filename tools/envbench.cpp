@@ -0,0 +1,124 @@
+// tetris-envbench: speed and correctness of the batched RL environment.
+//
+//   tetris-envbench [--games k] [--steps n] [--seed s]
+//
+// Steps k games n times with random actions through the C interface in
+// TetrisEnv.h, then does the same with k separate Game objects, and
+// reports game steps per second for both. A shorter run compares the two
+// step by step (observations, rewards, done flags) and fails on any
+// difference.
+
+#include "Game.h"
+#include "TetrisEnv.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+// one Game per batch slot, driven the way BatchEnv defines a step
+struct Reference {
+    vector<Game> games;
+    vector<unsigned short> obs;
+    vector<float> rewards;
+    vector<unsigned char> dones;
+
+    Reference(const vector<unsigned int>& seeds) : games(seeds.size()), obs(seeds.size() * NUM_ROWS),
+        rewards(seeds.size()), dones(seeds.size()) {
+        for(size_t k=0; k<seeds.size(); k++) games[k].reset(seeds[k]);
+    }
+
+    void step(const int* actions, bool observe){
+        for(size_t k=0; k<games.size(); k++){
+            Game& g = games[k];
+            long long lines = g.linesCleared();
+            if(actions[k] >= INPUT_LEFT && actions[k] <= INPUT_DOWN_RELEASE) g.input(Input(actions[k]));
+            g.tick();
+            rewards[k] = g.linesCleared() - lines;
+            dones[k] = g.isOver();
+            if(g.isOver()) g.input(INPUT_RESTART);
+            if(!observe) continue;
+
+            unsigned short* rows = &obs[k * NUM_ROWS];
+            for(int i=0; i<NUM_ROWS; i++){
+                rows[i] = 0;
+                for(int j=0; j<NUM_COLS; j++) rows[i] |= (g.cells()[i][j] != EMPTY_CELL) << j;
+            }
+            for(const coord& v: g.current().getPos()) rows[v.y] |= 1 << v.x;
+        }
+    }
+};
+
+int main(int argc, char **argv) {
+    int games = 1024;
+    int steps = 2000;
+    unsigned int seed = 1;
+    for(int i=1; i<argc; i++){
+        if(strcmp(argv[i], "--games") == 0 && i+1 < argc) games = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--steps") == 0 && i+1 < argc) steps = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0 && i+1 < argc) seed = strtoul(argv[++i], nullptr, 10);
+        else {
+            cerr<<"Usage: "<<argv[0]<<" [--games k] [--steps n] [--seed s]"<<endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if(games < 1 || steps < 1) return EXIT_FAILURE;
+
+    // the same random actions for both, precomputed so neither pays for them
+    const int ACTION_STEPS = 256;
+    vector<int> actions((size_t)games * ACTION_STEPS);
+    unsigned int rng = seed;
+    for(int& a: actions){
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        a = rng % 8;    // 0-4 key presses, 5-7 nothing
+    }
+    vector<unsigned int> seeds(games);
+    for(int k=0; k<games; k++) seeds[k] = seed * 7919 + k;
+
+    TetrisEnv* env = tetris_env_create(games, seed);
+    if(env == nullptr) return EXIT_FAILURE;
+
+    // check against Game first
+    Reference ref(seeds);
+    tetris_env_reset(env, seeds.data());
+    int checkSteps = min(steps, 1000);
+    long long mismatches = 0, episodes = 0;
+    for(int s=0; s<checkSteps; s++){
+        const int* a = &actions[(size_t)(s % ACTION_STEPS) * games];
+        tetris_env_step(env, a);
+        ref.step(a, true);
+        const unsigned short* obs = tetris_env_observations(env);
+        const float* rewards = tetris_env_rewards(env);
+        const unsigned char* dones = tetris_env_dones(env);
+        for(int k=0; k<games; k++){
+            episodes += dones[k];
+            if(memcmp(obs + k * NUM_ROWS, &ref.obs[k * NUM_ROWS], NUM_ROWS * sizeof(unsigned short)) ||
+               rewards[k] != ref.rewards[k] || dones[k] != ref.dones[k]) mismatches++;
+        }
+    }
+    cout<<"checked "<<checkSteps<<" steps of "<<games<<" games against Game: "<<mismatches<<" mismatches, "
+        <<episodes<<" episodes ended"<<endl;
+
+    tetris_env_reset(env, seeds.data());
+    auto t0 = chrono::steady_clock::now();
+    for(int s=0; s<steps; s++) tetris_env_step(env, &actions[(size_t)(s % ACTION_STEPS) * games]);
+    double batched = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    Reference loop(seeds);
+    t0 = chrono::steady_clock::now();
+    for(int s=0; s<steps; s++) loop.step(&actions[(size_t)(s % ACTION_STEPS) * games], true);
+    double perGame = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    double total = (double)games * steps;
+    cout<<"batched: "<<total / batched / 1e6<<" M game steps/s ("<<batched * 1e9 / total<<" ns each)\n";
+    cout<<"Game loop: "<<total / perGame / 1e6<<" M game steps/s ("<<perGame * 1e9 / total<<" ns each)\n";
+    cout<<"speedup "<<perGame / batched<<"x"<<endl;
+
+    tetris_env_destroy(env);
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
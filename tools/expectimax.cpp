@@ -0,0 +1,142 @@
+// tetris-expectimax: speed and scaling of the expectimax search.
+//
+//   tetris-expectimax [--depth d] [--time ms] [--threads n] [--positions n]
+//                     [--tt-mb n] [--seed s] [--scaling]
+//
+// Builds n positions from a game the 2-ply Bot plays, each with the piece
+// to place and its preview, then searches every one to --depth chance
+// layers, or for --time milliseconds each, and reports nodes per second,
+// the transposition table's hit rate and the depth reached. The table is
+// kept from one position to the next, as it would be in a game.
+// --scaling runs the positions again on 1, 2, 4 ... up to --threads
+// threads, each with a fresh table, reports the speedup over one thread
+// and checks that every thread count picks the same placements.
+
+#include "Expectimax.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+struct Position {
+    BoardRows rows;
+    int shape, next;
+};
+
+struct RunTotals {
+    ExpectimaxStats stats;
+    double seconds = 0;
+    long long depths = 0;
+    vector<Placement> picks;
+};
+
+static RunTotals runAll(const vector<Position>& positions, int threads, int depth, double budgetMs, size_t ttMegabytes) {
+    Expectimax search(threads, ttMegabytes);
+    RunTotals totals;
+    for(const Position& p: positions){
+        Expectimax::Result result;
+        if(!search.search(p.rows, p.shape, 0, SPAWN_X, SPAWN_Y, p.next, depth, budgetMs, result)) continue;
+        totals.stats.add(result.stats);
+        totals.seconds += result.seconds;
+        totals.depths += result.depth;
+        totals.picks.push_back(result.best);
+    }
+    return totals;
+}
+
+static void report(const char* label, const RunTotals& r, size_t positions) {
+    cout<<label<<": "<<r.stats.nodes / max(r.seconds, 1e-9) / 1e6<<" M nodes/s, "
+        <<r.stats.nodes / max<size_t>(1, positions)<<" nodes and "<<r.seconds * 1000 / max<size_t>(1, positions)
+        <<" ms per position, depth "<<(double)r.depths / max<size_t>(1, r.picks.size())<<", TT hits "
+        <<100.0 * r.stats.hits / max(1LL, r.stats.probes)<<"% of "<<r.stats.probes<<endl;
+}
+
+int main(int argc, char **argv) {
+    int depth = 1;
+    double budgetMs = 0;
+    int threads = thread::hardware_concurrency();
+    int count = 20;
+    size_t ttMegabytes = 64;
+    unsigned int rng = 1;
+    bool scaling = false;
+    for(int i=1; i<argc; i++){
+        if(strcmp(argv[i], "--depth") == 0 && i+1 < argc) depth = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--time") == 0 && i+1 < argc) budgetMs = atof(argv[++i]);
+        else if(strcmp(argv[i], "--threads") == 0 && i+1 < argc) threads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--positions") == 0 && i+1 < argc) count = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--tt-mb") == 0 && i+1 < argc) ttMegabytes = strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "--seed") == 0 && i+1 < argc) rng = strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "--scaling") == 0) scaling = true;
+        else {
+            cerr<<"Usage: "<<argv[0]<<" [--depth d] [--time ms] [--threads n] [--positions n] [--tt-mb n] [--seed s] [--scaling]"<<endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if(depth < 0 || depth > EXPECTIMAX_MAX_DEPTH || count < 1 || rng == 0){
+        cerr<<"--depth goes from 0 to "<<EXPECTIMAX_MAX_DEPTH<<endl;
+        return EXIT_FAILURE;
+    }
+    threads = max(1, threads);
+    auto random = [&rng](){
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+    };
+
+    // boards a decent player leaves, rather than random stacks
+    const PieceTable& t = pieceTable();
+    Bot bot;
+    vector<Position> positions(count);
+    BoardRows rows = {};
+    int shape = random() % NUM_SHAPES;
+    for(Position& p: positions){
+        p.shape = shape;
+        p.next = random() % NUM_SHAPES;
+        Placement pick;
+        if(!bot.choose(rows, p.shape, 0, SPAWN_X, SPAWN_Y, p.next, pick)){
+            memset(rows, 0, sizeof(rows));
+            bot.choose(rows, p.shape, 0, SPAWN_X, SPAWN_Y, p.next, pick);
+        }
+        memcpy(p.rows, rows, sizeof(rows));
+        t.lock(rows, p.shape, pick.orient, pick.x, pick.y);
+        shape = p.next;
+    }
+
+    Expectimax probe(1, ttMegabytes);
+    cout<<count<<" positions, depth "<<depth;
+    if(budgetMs > 0) cout<<" or "<<budgetMs<<" ms";
+    cout<<", "<<probe.table().entries()<<" TT entries"<<endl;
+
+    if(!scaling){
+        RunTotals r = runAll(positions, threads, depth, budgetMs, ttMegabytes);
+        report((to_string(threads) + " threads").c_str(), r, positions.size());
+        return EXIT_SUCCESS;
+    }
+
+    int errors = 0;
+    RunTotals one;
+    for(int n=1; ; n=min(n*2, threads)){
+        RunTotals r = runAll(positions, n, depth, budgetMs, ttMegabytes);
+        if(n == 1) one = r;
+        string label = to_string(n) + " threads";
+        report(label.c_str(), r, positions.size());
+        cout<<"  speedup "<<one.seconds / max(r.seconds, 1e-9)<<endl;
+        // a time budget can stop thread counts at different depths
+        if(budgetMs <= 0){
+            for(size_t i=0; i<min(r.picks.size(), one.picks.size()); i++){
+                const Placement& a = r.picks[i];
+                const Placement& b = one.picks[i];
+                if(r.picks.size() != one.picks.size() || a.x != b.x || a.y != b.y || a.orient != b.orient) errors++;
+            }
+        }
+        if(n == threads) break;
+    }
+    if(budgetMs <= 0) cout<<"placements that differ from 1 thread: "<<errors<<endl;
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
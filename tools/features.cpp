@@ -0,0 +1,118 @@
+// tetris-features: speed and correctness of the board feature kernels.
+//
+//   tetris-features [--boards n] [--passes n] [--seed s]
+//
+// Builds n boards by playing random placements, some stacked high and
+// holey, some close to empty, checks every one through each kernel
+// against the cell by cell reference, then reports boards per second for
+// the reference, for boardFeatureSet() one board at a time and for the
+// batch boardFeatureSets() (AVX2 when built with -mavx2).
+
+#include "Features.h"
+#include "Placement.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static void toCells(const unsigned short* rows, Cells& board) {
+    for(int r=0; r<NUM_ROWS; r++){
+        for(int c=0; c<NUM_COLS; c++) board[r][c] = (rows[r] >> c) & 1 ? 1 : EMPTY_CELL;
+    }
+}
+
+// keeps the optimizer from dropping a loop whose results go unused
+static long long checksum(const BoardFeatureSet& f) {
+    return f.aggregateHeight + f.holes + f.wells + f.rowTransitions + f.colTransitions + f.bumpiness;
+}
+
+int main(int argc, char **argv) {
+    int count = 100000;
+    int passes = 20;
+    unsigned int rng = 1;
+    for(int i=1; i<argc; i++){
+        if(strcmp(argv[i], "--boards") == 0 && i+1 < argc) count = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--passes") == 0 && i+1 < argc) passes = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0 && i+1 < argc) rng = strtoul(argv[++i], nullptr, 10);
+        else {
+            cerr<<"Usage: "<<argv[0]<<" [--boards n] [--passes n] [--seed s]"<<endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if(count < 1 || passes < 1 || rng == 0) return EXIT_FAILURE;
+    auto random = [&rng](){
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+    };
+
+    const PieceTable& t = pieceTable();
+    PlacementFinder finder;
+    static Placement out[MAX_PLACEMENTS];
+    vector<BoardRows> rows(count);
+    vector<Cells> cells(count);
+    BoardRows board = {};
+    for(int i=0; i<count; i++){
+        int shape = random() % NUM_SHAPES;
+        int found = finder.find(board, shape, out);
+        if(found == 0 || random() % 64 == 0){
+            memset(board, 0, sizeof(board));
+            found = finder.find(board, shape, out);
+        }
+        const Placement& pick = out[random() % found];
+        t.lock(board, shape, pick.orient, pick.x, pick.y);
+        memcpy(rows[i], board, sizeof(board));
+        toCells(board, cells[i]);
+    }
+
+    vector<BoardFeatureSet> batch(count);
+    boardFeatureSets(rows.data(), count, batch.data());
+    long long errors = 0;
+    for(int i=0; i<count; i++){
+        BoardFeatureSet expected, single;
+        boardFeatureSetReference(cells[i], expected);
+        boardFeatureSet(rows[i], single);
+        if(!(single == expected)) errors++;
+        if(!(batch[i] == expected)) errors++;
+    }
+    cout<<"checked "<<count<<" boards against the cell by cell reference: "<<errors<<" mismatches"<<endl;
+
+    long long sum = 0;
+    auto time = [&](const char* label, int rounds, const function<void()>& pass){
+        auto t0 = chrono::steady_clock::now();
+        for(int p=0; p<rounds; p++) pass();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        double rate = (double)count * rounds / seconds;
+        cout<<label<<": "<<rate / 1e6<<" M boards/s ("<<1e9 / rate<<" ns each)"<<endl;
+        return rate;
+    };
+    double reference = time("reference", max(1, passes / 10), [&](){
+        BoardFeatureSet f;
+        for(int i=0; i<count; i++){
+            boardFeatureSetReference(cells[i], f);
+            sum += checksum(f);
+        }
+    });
+    double single = time("boardFeatureSet", passes, [&](){
+        BoardFeatureSet f;
+        for(int i=0; i<count; i++){
+            boardFeatureSet(rows[i], f);
+            sum += checksum(f);
+        }
+    });
+    double batched = time((string("boardFeatureSets, ") + boardFeatureKernel()).c_str(), passes, [&](){
+        boardFeatureSets(rows.data(), count, batch.data());
+        for(int i=0; i<count; i++) sum += checksum(batch[i]);
+    });
+    cout<<"speedup over the reference: "<<single / reference<<"x one at a time, "<<batched / reference
+        <<"x batched (checksum "<<sum<<")"<<endl;
+
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,214 @@
+// tetris-loadgen: synthetic thin clients for tetris-server.
+//
+//   tetris-loadgen [--connect unix:path | tcp:host:port] [--sessions n]
+//                  [--rate presses_per_second] [--duration seconds] [--threads n]
+//
+// Opens n connections, each one a game on the server, presses random keys
+// at the given average rate, restarts games that end and applies every
+// delta the server sends to a local copy of the board, checking the
+// stream stays well formed.
+
+#include "Game.h"
+#include "ServerProtocol.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+// how often each thread decides on new key presses
+const int INPUT_PERIOD_MS = 10;
+
+struct Client {
+    int fd = -1;
+    BoardView view;
+    long long tick = 0;
+    bool over = false;
+    bool restartSent = false;
+    vector<unsigned char> in;
+};
+
+struct LoadStats {
+    long long connected = 0;
+    long long failed = 0;
+    long long deltas = 0;
+    long long bytes = 0;
+    long long inputs = 0;
+    long long restarts = 0;
+    long long malformed = 0;
+    long long disconnects = 0;
+
+    void add(const LoadStats& o){
+        connected += o.connected;
+        failed += o.failed;
+        deltas += o.deltas;
+        bytes += o.bytes;
+        inputs += o.inputs;
+        restarts += o.restarts;
+        malformed += o.malformed;
+        disconnects += o.disconnects;
+    }
+};
+
+void dropClient(int epoll, Client& c, LoadStats& stats) {
+    epoll_ctl(epoll, EPOLL_CTL_DEL, c.fd, nullptr);
+    close(c.fd);
+    c.fd = -1;
+    stats.disconnects++;
+}
+
+bool sendKey(Client& c, Input in, LoadStats& stats) {
+    unsigned char b = in;
+    if(send(c.fd, &b, 1, MSG_NOSIGNAL | MSG_DONTWAIT) != 1) return false;
+    stats.inputs++;
+    return true;
+}
+
+void receive(int epoll, Client& c, LoadStats& stats) {
+    unsigned char buf[4096];
+    for(;;){
+        ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+        if(n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)){
+            dropClient(epoll, c, stats);
+            return;
+        }
+        if(n < 0) break;
+        stats.bytes += n;
+        c.in.insert(c.in.end(), buf, buf + n);
+    }
+
+    size_t used = 0;
+    for(;;){
+        const unsigned char* start = c.in.data() + used;
+        int taken = applyDelta(start, c.in.data() + c.in.size(), c.view, c.tick, c.over);
+        if(taken == 0) break;
+        if(taken < 0){
+            stats.malformed++;
+            dropClient(epoll, c, stats);
+            return;
+        }
+        used += taken;
+        stats.deltas++;
+    }
+    c.in.erase(c.in.begin(), c.in.begin() + used);
+
+    if(!c.over) c.restartSent = false;
+    else if(!c.restartSent && sendKey(c, INPUT_RESTART, stats)){
+        c.restartSent = true;
+        stats.restarts++;
+    }
+}
+
+void runClients(const SocketAddress& addr, int count, double rate, double duration,
+                unsigned int seed, LoadStats& stats) {
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    vector<Client> clients(count);
+    for(int i=0; i<count; i++){
+        Client& c = clients[i];
+        c.fd = connectTo(addr);
+        if(c.fd < 0){
+            stats.failed++;
+            continue;
+        }
+        stats.connected++;
+        memset(c.view, EMPTY_CELL, sizeof(c.view));
+        c.in.reserve(2 * MAX_DELTA_BYTES);
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u32 = i;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, c.fd, &ev);
+    }
+
+    unsigned int rng = seed ? seed : 1;
+    auto next = [&rng]{
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+    };
+    // chance per client per period of a key press, in 1/65536ths
+    unsigned int pressChance = (unsigned int)min(65536.0, rate * INPUT_PERIOD_MS / 1000.0 * 65536);
+
+    auto start = chrono::steady_clock::now();
+    auto end = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(duration));
+    auto nextInput = start;
+    epoll_event events[256];
+    while(chrono::steady_clock::now() < end){
+        int timeout = max(0, (int)chrono::duration_cast<chrono::milliseconds>(nextInput - chrono::steady_clock::now()).count());
+        int n = epoll_wait(epoll, events, 256, timeout);
+        for(int i=0; i<n; i++){
+            Client& c = clients[events[i].data.u32];
+            if(c.fd >= 0) receive(epoll, c, stats);
+        }
+
+        if(chrono::steady_clock::now() < nextInput) continue;
+        nextInput += chrono::milliseconds(INPUT_PERIOD_MS);
+        for(Client& c: clients){
+            if(c.fd < 0 || c.over || (next() & 0xFFFF) >= pressChance) continue;
+            sendKey(c, Input(next() % INPUT_RESTART), stats);
+        }
+    }
+
+    for(Client& c: clients){
+        if(c.fd >= 0) close(c.fd);
+    }
+    close(epoll);
+}
+
+int main(int argc, char **argv) {
+    string connectAddr = "tcp:127.0.0.1:47200";
+    int sessions = 1000;
+    double rate = 3, duration = 10;
+    int threads = 1;
+    for(int i=1; i<argc; i++){
+        if(strcmp(argv[i], "--connect") == 0 && i+1 < argc) connectAddr = argv[++i];
+        else if(strcmp(argv[i], "--sessions") == 0 && i+1 < argc) sessions = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--rate") == 0 && i+1 < argc) rate = atof(argv[++i]);
+        else if(strcmp(argv[i], "--duration") == 0 && i+1 < argc) duration = atof(argv[++i]);
+        else if(strcmp(argv[i], "--threads") == 0 && i+1 < argc) threads = atoi(argv[++i]);
+        else {
+            cerr<<"Usage: "<<argv[0]<<" [--connect unix:path | tcp:host:port] [--sessions n] [--rate presses_per_second] [--duration seconds] [--threads n]"<<endl;
+            return EXIT_FAILURE;
+        }
+    }
+    threads = max(1, min(threads, sessions));
+
+    SocketAddress addr;
+    if(!parseAddress(connectAddr, addr)){
+        cerr<<"Bad address "<<connectAddr<<endl;
+        return EXIT_FAILURE;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    long long files = raiseFileLimit();
+    if(sessions > files - 16) cerr<<"warning: only "<<files<<" descriptors available"<<endl;
+
+    vector<LoadStats> stats(threads);
+    vector<thread> pool;
+    for(int t=0; t<threads; t++){
+        int count = sessions / threads + (t < sessions % threads);
+        pool.push_back(thread(runClients, cref(addr), count, rate, duration, 12345u + t, ref(stats[t])));
+    }
+    for(thread& t: pool) t.join();
+
+    LoadStats total;
+    for(const LoadStats& s: stats) total.add(s);
+    cout<<total.connected<<" sessions connected";
+    if(total.failed) cout<<", "<<total.failed<<" failed to connect";
+    cout<<"\n"<<total.deltas / duration<<" deltas/s, "<<total.bytes / duration / 1024<<" KB/s, "
+        <<total.inputs / duration<<" key presses/s, "<<total.restarts<<" games restarted\n";
+    cout<<total.malformed<<" malformed streams, "<<total.disconnects<<" disconnects"<<endl;
+    return total.malformed || total.failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
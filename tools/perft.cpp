@@ -0,0 +1,218 @@
+// tetris-perft: counts the move tree, like perft in chess.
+//
+//   tetris-perft [--depth d] [--pieces OISZLJT] [--board file] [--threads n]
+//                [--dedupe] [--expect n]
+//
+// From a board (empty, or the first board in a file in the writeBoardText
+// format) and a fixed piece sequence, repeated as needed, counts every
+// way to place the next d pieces: each distinct lock position of a piece,
+// with its line clears applied, is a node. With --dedupe each depth
+// counts distinct boards instead, since different placements often leave
+// the same one.
+//
+// The counts depend on nothing but the rules, so they are an oracle for
+// changes to collision, rotation or line clear code: run before and after
+// and compare, or pass --expect with the count at depth d. The time taken
+// is the engine's standard throughput figure, in nodes per second; as in
+// chess, the last level is counted straight off the placement list
+// rather than visited.
+
+#include "Placement.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+const int MAX_DEPTH = 16;
+
+struct Board {
+    BoardRows rows;
+
+    bool operator<(const Board& other) const { return memcmp(rows, other.rows, sizeof(rows)) < 0; }
+    bool operator==(const Board& other) const { return memcmp(rows, other.rows, sizeof(rows)) == 0; }
+};
+
+// everything one thread needs to walk a subtree
+struct Walker {
+    PlacementFinder finder;
+    Placement out[MAX_DEPTH][MAX_PLACEMENTS];
+    long long counts[MAX_DEPTH + 1] = {};
+};
+
+// Counts the nodes below rows, whose next piece is pieces[level].
+static void walk(Walker& w, const unsigned short* rows, int level, int depth, const vector<int>& pieces) {
+    const PieceTable& t = pieceTable();
+    int shape = pieces[level];
+    int n = w.finder.find(rows, shape, w.out[level]);
+    w.counts[level + 1] += n;
+    if(level + 1 == depth) return;
+    for(int i=0; i<n; i++){
+        const Placement& p = w.out[level][i];
+        BoardRows child;
+        memcpy(child, rows, sizeof(child));
+        t.lock(child, shape, p.orient, p.x, p.y);
+        walk(w, child, level + 1, depth, pieces);
+    }
+}
+
+// Expands the tree level by level, keeping only distinct boards.
+static void countDistinct(const Board& root, int depth, const vector<int>& pieces, int threads, long long* counts, long long& generated) {
+    const PieceTable& t = pieceTable();
+    vector<Board> level(1, root);
+    for(int d=0; d<depth; d++){
+        atomic<size_t> next(0);
+        mutex mergeLock;
+        vector<Board> children;
+        const size_t CHUNK = 64;
+
+        auto work = [&]{
+            unique_ptr<PlacementFinder> finder(new PlacementFinder());
+            unique_ptr<Placement[]> out(new Placement[MAX_PLACEMENTS]);
+            vector<Board> mine;
+            size_t squeezeAt = 1 << 16;
+            long long found = 0;
+            for(size_t i=next.fetch_add(CHUNK); i<level.size(); i=next.fetch_add(CHUNK)){
+                for(size_t k=i; k<min(i + CHUNK, level.size()); k++){
+                    int n = finder->find(level[k].rows, pieces[d], out.get());
+                    found += n;
+                    for(int j=0; j<n; j++){
+                        Board child = level[k];
+                        t.lock(child.rows, pieces[d], out[j].orient, out[j].x, out[j].y);
+                        mine.push_back(child);
+                    }
+                }
+                // keep what a thread holds down as it goes
+                if(mine.size() > squeezeAt){
+                    sort(mine.begin(), mine.end());
+                    mine.erase(unique(mine.begin(), mine.end()), mine.end());
+                    squeezeAt = max(squeezeAt, mine.size() * 2);
+                }
+            }
+            lock_guard<mutex> guard(mergeLock);
+            generated += found;
+            children.insert(children.end(), mine.begin(), mine.end());
+        };
+
+        vector<thread> workers;
+        for(int k=1; k<threads; k++) workers.emplace_back(work);
+        work();
+        for(auto& w: workers) w.join();
+
+        sort(children.begin(), children.end());
+        children.erase(unique(children.begin(), children.end()), children.end());
+        counts[d + 1] = children.size();
+        level.swap(children);
+    }
+}
+
+int main(int argc, char **argv) {
+    int depth = 3;
+    string sequence = SHAPE_NAMES;
+    const char* boardFile = nullptr;
+    int threads = thread::hardware_concurrency();
+    bool dedupe = false;
+    long long expect = -1;
+    for(int i=1; i<argc; i++){
+        if(strcmp(argv[i], "--depth") == 0 && i+1 < argc) depth = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--pieces") == 0 && i+1 < argc) sequence = argv[++i];
+        else if(strcmp(argv[i], "--board") == 0 && i+1 < argc) boardFile = argv[++i];
+        else if(strcmp(argv[i], "--threads") == 0 && i+1 < argc) threads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--dedupe") == 0) dedupe = true;
+        else if(strcmp(argv[i], "--expect") == 0 && i+1 < argc) expect = atoll(argv[++i]);
+        else {
+            cerr<<"Usage: "<<argv[0]<<" [--depth d] [--pieces "<<SHAPE_NAMES<<"] [--board file] [--threads n] [--dedupe] [--expect n]"<<endl;
+            return EXIT_FAILURE;
+        }
+    }
+    threads = max(1, threads);
+    if(depth < 1 || depth > MAX_DEPTH || sequence.empty()){
+        cerr<<"Depth must be 1-"<<MAX_DEPTH<<" and the piece sequence not empty"<<endl;
+        return EXIT_FAILURE;
+    }
+    vector<int> pieces;
+    for(int d=0; d<depth; d++){
+        int s = shapeFromName(sequence[d % sequence.size()]);
+        if(s < 0){
+            cerr<<"Unknown piece "<<sequence[d % sequence.size()]<<", expected one of "<<SHAPE_NAMES<<endl;
+            return EXIT_FAILURE;
+        }
+        pieces.push_back(s);
+    }
+
+    Board root = {};
+    if(boardFile){
+        ifstream in(boardFile);
+        BoardSnapshot snap;
+        if(!in || !readBoardText(in, snap)){
+            cerr<<"Failed to read a board from "<<boardFile<<endl;
+            return EXIT_FAILURE;
+        }
+        rowsFromCells(snap.cells, root.rows);
+    }
+    pieceTable();
+
+    long long counts[MAX_DEPTH + 1] = {};
+    long long generated = 0;
+    auto start = chrono::steady_clock::now();
+    if(dedupe){
+        countDistinct(root, depth, pieces, threads, counts, generated);
+    }
+    else {
+        // the top two levels in one thread, the subtrees below them shared
+        // out between all of them
+        int split = min(depth - 1, 2);
+        unique_ptr<Walker> top(new Walker());
+        vector<Board> tasks(1, root);
+        const PieceTable& t = pieceTable();
+        for(int d=0; d<split; d++){
+            vector<Board> next;
+            for(const Board& b: tasks){
+                int n = top->finder.find(b.rows, pieces[d], top->out[0]);
+                top->counts[d + 1] += n;
+                for(int j=0; j<n; j++){
+                    Board child = b;
+                    t.lock(child.rows, pieces[d], top->out[0][j].orient, top->out[0][j].x, top->out[0][j].y);
+                    next.push_back(child);
+                }
+            }
+            tasks.swap(next);
+        }
+        for(int d=0; d<=depth; d++) counts[d] = top->counts[d];
+
+        atomic<size_t> next(0);
+        mutex mergeLock;
+        auto work = [&]{
+            unique_ptr<Walker> w(new Walker());
+            for(size_t i=next++; i<tasks.size(); i=next++) walk(*w, tasks[i].rows, split, depth, pieces);
+            lock_guard<mutex> guard(mergeLock);
+            for(int d=0; d<=depth; d++) counts[d] += w->counts[d];
+        };
+        vector<thread> workers;
+        for(int k=1; k<threads; k++) workers.emplace_back(work);
+        work();
+        for(auto& w: workers) w.join();
+        for(int d=1; d<=depth; d++) generated += counts[d];
+    }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    for(int d=1; d<=depth; d++) cout<<"depth "<<d<<" ("<<SHAPE_NAMES[pieces[d-1]]<<"): "<<counts[d]<<"\n";
+    cout<<generated<<" nodes"<<(dedupe ? " generated" : "")<<", "<<threads<<" threads, "<<secs<<" s, "
+        <<generated / max(secs, 1e-9) / 1e6<<" M nodes/s"<<endl;
+
+    if(expect >= 0 && counts[depth] != expect){
+        cerr<<"MISMATCH: expected "<<expect<<" at depth "<<depth<<endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
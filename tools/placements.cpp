@@ -0,0 +1,185 @@
+// tetris-placements: speed and correctness of the placement enumerator.
+//
+//   tetris-placements [--positions n] [--calls n] [--check n] [--seed s]
+//
+// Builds n positions by playing random placements, then times
+// PlacementFinder::find over them and reports calls per second. Before
+// that, the first --check positions, and as many boards taken from Games
+// in mid fall, are searched again the slow way - a breadth-first search
+// over Shape objects moved with the Game's own moveHorizontal, moveDown
+// and rotate - and the two sets of lock positions must agree; every path()
+// is replayed on a Shape and has to end where it says.
+
+#include "Placement.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <set>
+#include <vector>
+
+using namespace std;
+
+struct Position {
+    BoardRows rows;
+    int shape;
+};
+
+typedef vector<pair<int,int>> CellSet;
+
+static CellSet cellsOf(const Shape& piece) {
+    CellSet cells;
+    for(const coord& v: piece.getPos()) cells.push_back(make_pair(v.x, v.y));
+    return cells;
+}
+
+static CellSet cellsOf(int shape, const Placement& p) {
+    const PieceTable& t = pieceTable();
+    CellSet cells;
+    for(int k=0; k<PIECE_CELLS; k++) cells.push_back(make_pair(p.x + t.dx[shape][p.orient][k], p.y + t.dy[shape][p.orient][k]));
+    return cells;
+}
+
+static CellSet sorted(CellSet cells) {
+    sort(cells.begin(), cells.end());
+    return cells;
+}
+
+// lock positions found with Shape moves alone
+static set<CellSet> slowPlacements(const Cells& board, const Shape& start) {
+    set<CellSet> seen, locks;
+    deque<Shape> queue;
+    if(start.hasCollision(board)) return locks;
+    seen.insert(cellsOf(start));
+    queue.push_back(start);
+    while(!queue.empty()){
+        Shape at = queue.front();
+        queue.pop_front();
+        Shape down = at;
+        if(down.moveDown(board)) locks.insert(sorted(cellsOf(at)));
+
+        Shape moves[4] = { down, at, at, at };
+        moves[1].moveHorizontal(false, board);
+        moves[2].moveHorizontal(true, board);
+        moves[3].rotate(board);
+        for(const Shape& next: moves){
+            if(seen.insert(cellsOf(next)).second) queue.push_back(next);
+        }
+    }
+    return locks;
+}
+
+static void toCells(const unsigned short* rows, Cells& board) {
+    for(int r=0; r<NUM_ROWS; r++){
+        for(int c=0; c<NUM_COLS; c++) board[r][c] = (rows[r] >> c) & 1 ? 1 : EMPTY_CELL;
+    }
+}
+
+// compares find() and path() with the slow search; returns the mismatches
+static int check(PlacementFinder& finder, const Cells& board, const Shape& start, int found, const Placement* out) {
+    int shape = 0, orient, x, y;
+    pieceTable().locate(start, shape, orient, x, y);
+    set<CellSet> fast;
+    for(int i=0; i<found; i++) fast.insert(sorted(cellsOf(shape, out[i])));
+    int errors = fast.size() != (size_t)found || fast != slowPlacements(board, start);
+
+    Placement_move moves[MAX_PLACEMENTS];
+    for(int i=0; i<found; i++){
+        int len = finder.path(out[i], moves, MAX_PLACEMENTS);
+        Shape piece = start;
+        bool ok = len >= 0;
+        for(int m=0; m<len && ok; m++){
+            switch(moves[m]){
+                case MOVE_LEFT: piece.moveHorizontal(false, board); break;
+                case MOVE_RIGHT: piece.moveHorizontal(true, board); break;
+                case MOVE_ROTATE: piece.rotate(board); break;
+                case MOVE_DOWN: ok = !piece.moveDown(board); break;
+            }
+        }
+        if(!ok || sorted(cellsOf(piece)) != sorted(cellsOf(shape, out[i]))) errors++;
+    }
+    return errors;
+}
+
+int main(int argc, char **argv) {
+    int positions = 10000;
+    long long calls = 2000000;
+    int checks = 2000;
+    unsigned int rng = 1;
+    for(int i=1; i<argc; i++){
+        if(strcmp(argv[i], "--positions") == 0 && i+1 < argc) positions = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--calls") == 0 && i+1 < argc) calls = atoll(argv[++i]);
+        else if(strcmp(argv[i], "--check") == 0 && i+1 < argc) checks = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0 && i+1 < argc) rng = strtoul(argv[++i], nullptr, 10);
+        else {
+            cerr<<"Usage: "<<argv[0]<<" [--positions n] [--calls n] [--check n] [--seed s]"<<endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if(positions < 1 || calls < 1 || rng == 0) return EXIT_FAILURE;
+    auto random = [&rng](){
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+    };
+
+    // random placements make rough, holey boards, which is where tucks
+    // and slides show up
+    const PieceTable& t = pieceTable();
+    PlacementFinder finder;
+    static Placement out[MAX_PLACEMENTS];
+    vector<Position> boards(positions);
+    BoardRows rows = {};
+    for(Position& p: boards){
+        p.shape = random() % NUM_SHAPES;
+        int found = finder.find(rows, p.shape, out);
+        if(found == 0){
+            memset(rows, 0, sizeof(rows));
+            found = finder.find(rows, p.shape, out);
+        }
+        memcpy(p.rows, rows, sizeof(rows));
+        const Placement& pick = out[random() % found];
+        t.lock(rows, p.shape, pick.orient, pick.x, pick.y);
+    }
+
+    long long errors = 0, checked = 0;
+    for(int i=0; i<min(checks, positions); i++){
+        Cells board;
+        toCells(boards[i].rows, board);
+        Shape start = SHAPES[boards[i].shape];
+        int found = finder.find(boards[i].rows, boards[i].shape, out);
+        errors += check(finder, board, start, found, out);
+        checked++;
+    }
+    // and from wherever a falling piece happens to be
+    Game game(rng);
+    for(int i=0; i<checks; ){
+        if(game.isOver()) game.input(INPUT_RESTART);
+        unsigned int r = random() % 8;
+        if(r <= INPUT_DOWN_RELEASE) game.input(Input(r));
+        game.tick();
+        if(random() % 4) continue;
+        int found = finder.find(game, out);
+        if(game.isOver()) continue;
+        errors += check(finder, game.cells(), game.current(), found, out);
+        checked++;
+        i++;
+    }
+    cout<<"checked "<<checked<<" positions against Shape moves: "<<errors<<" mismatches"<<endl;
+
+    long long placements = 0;
+    auto t0 = chrono::steady_clock::now();
+    for(long long c=0; c<calls; c++){
+        const Position& p = boards[c % positions];
+        placements += finder.find(p.rows, p.shape, out);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    cout<<calls / seconds / 1e6<<" M calls/s ("<<seconds * 1e9 / calls<<" ns each), "
+        <<(double)placements / calls<<" placements per call"<<endl;
+
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,79 @@
+// tetris-raster: renders board snapshots (see Board.h for the text format)
+// to PPM or PNG images without a GL context.
+//
+//   tetris-raster [-j threads] [--png] boards.txt out_prefix
+//
+// Writes out_prefix00000.ppm, out_prefix00001.ppm, ... one per board.
+// Many boards are spread over the threads one image each; a single board
+// is split into horizontal tiles instead.
+
+#include "Board.h"
+#include "SoftRaster.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+int main(int argc, char **argv) {
+    int threads = thread::hardware_concurrency();
+    bool png = false;
+    vector<const char*> args;
+    for(int i=1; i<argc; i++){
+        if(strcmp(argv[i], "-j") == 0 && i+1 < argc) threads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--png") == 0) png = true;
+        else args.push_back(argv[i]);
+    }
+    if(args.size() != 2){
+        cerr<<"usage: "<<argv[0]<<" [-j threads] [--png] boards.txt out_prefix"<<endl;
+        return EXIT_FAILURE;
+    }
+    threads = max(1, threads);
+
+    ifstream in(args[0]);
+    if(!in){
+        cerr<<"Failed to read "<<args[0]<<endl;
+        return EXIT_FAILURE;
+    }
+    vector<BoardSnapshot> boards;
+    BoardSnapshot snap;
+    while(readBoardText(in, snap)) boards.push_back(snap);
+
+    string prefix = args[1];
+    const char* extension = png ? ".png" : ".ppm";
+    auto start = chrono::steady_clock::now();
+
+    atomic<size_t> next(0);
+    atomic<int> failures(0);
+    int tileThreads = boards.size() == 1 ? threads : 1;
+    auto work = [&]{
+        Image image(WINDOW_SIZE_X, WINDOW_SIZE_Y);
+        char name[32];
+        for(size_t i=next++; i<boards.size(); i=next++){
+            rasterizeBoard(boards[i], image, tileThreads);
+            snprintf(name, sizeof(name), "%05zu", i);
+            string path = prefix + name + extension;
+            if(!(png ? writePNG(image, path.c_str()) : writePPM(image, path.c_str()))){
+                cerr<<"Failed to write "<<path<<endl;
+                failures++;
+            }
+        }
+    };
+
+    vector<thread> workers;
+    for(int t=1; t<threads && t<(int)boards.size(); t++) workers.emplace_back(work);
+    work();
+    for(auto& t: workers) t.join();
+
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cerr<<boards.size()<<" boards in "<<secs<<" s ("<<boards.size() / max(secs, 1e-9)<<" frames/s)"<<endl;
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,218 @@
+// tetris-replay: inspects, verifies and plays back replay files headless.
+//
+//   tetris-replay [--seek tick] [--dump] file.ttr...
+//       plays each replay to the end at full speed and checks the result
+//       against the recorded one; --seek prints the board at that tick
+//   tetris-replay --generate count prefix [seed]
+//       records count synthetic games driven by random inputs
+//   tetris-replay --check [seed]
+//       checks that a replay whose game ends before its recorded final
+//       tick fails to verify, and seeking past that end returns, and that
+//       one whose keyframe puts the piece off the board doesn't open
+
+#include "Game.h"
+#include "Replay.h"
+#include "Varint.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+bool readFile(const char* path, vector<unsigned char>& data) {
+    ifstream in(path, ios::binary);
+    if(!in) return false;
+    data.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    return true;
+}
+
+int generate(int count, const string& prefix, unsigned int seed) {
+    unsigned int rng = seed ? seed : 1;
+    auto next = [&rng]{
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+    };
+
+    size_t totalBytes = 0;
+    for(int i=0; i<count; i++){
+        Game game(next());
+        ReplayRecorder recorder;
+        recorder.begin(game);
+        while(!game.isOver()){
+            // a few key presses a second, roughly what a person manages
+            unsigned int r = next() % 16;
+            if(r < 5 || (r == 5 && next() % 8 == 0)){
+                // everything but restart, which a recording never holds;
+                // hard drops are rare so games still run past keyframes
+                Input in = r < 5 ? Input(r) : INPUT_HARD_DROP;
+                recorder.input(game, in);
+                game.input(in);
+            }
+            game.tick();
+            recorder.tick(game);
+        }
+        recorder.finish(game);
+
+        string path = prefix + to_string(i) + ".ttr";
+        if(!recorder.save(path.c_str())){
+            cerr<<"Failed to write "<<path<<endl;
+            return EXIT_FAILURE;
+        }
+        totalBytes += recorder.bytes().size();
+    }
+    cout<<count<<" replays, "<<totalBytes / max(count, 1)<<" bytes on average"<<endl;
+    return EXIT_SUCCESS;
+}
+
+// A game played on gravity alone with its first keyframe's piece moved to
+// column 99; open() must refuse it rather than let a player draw it.
+static bool checkKeyframe(unsigned int seed) {
+    Game game(seed), key;
+    ReplayRecorder recorder;
+    recorder.begin(game);
+    while(!game.isOver()){
+        game.tick();
+        recorder.tick(game);
+        if(game.ticks() == REPLAY_KEYFRAME_INTERVAL) key = game;
+    }
+    recorder.finish(game);
+    if(game.ticks() < REPLAY_KEYFRAME_INTERVAL){
+        cout<<"seed "<<seed<<" ends before its first keyframe\n";
+        return false;
+    }
+
+    // the piece's centre comes before its colour byte, the generator, a
+    // flags byte and the three counters
+    vector<unsigned char> state, counters;
+    key.writeState(state);
+    putVarint(counters, key.ticks());
+    putVarint(counters, key.piecesPlaced());
+    putVarint(counters, key.linesCleared());
+    vector<unsigned char> bytes = recorder.bytes();
+    auto at = search(bytes.begin(), bytes.end(), state.begin(), state.end());
+    Replay replay;
+    if(at == bytes.end() || !replay.open(&bytes[0], bytes.size())){
+        cout<<"the keyframe at tick "<<REPLAY_KEYFRAME_INTERVAL<<" isn't in the replay, or it doesn't open\n";
+        return false;
+    }
+    at[state.size() - counters.size() - 9 - 3] = 99;
+    if(replay.open(&bytes[0], bytes.size())){
+        cout<<"a replay whose keyframe has the piece in column 99 opens\n";
+        return false;
+    }
+    return true;
+}
+
+// One game played holding down, which tops out quickly, recorded with the
+// result of the same pieces played by gravity alone, which lasts several
+// times as long. Replaying it must stop where the game really ends.
+int check(unsigned int seed) {
+    Game fast(seed), slow(seed);
+    ReplayRecorder recorder;
+    recorder.begin(fast);
+    recorder.input(fast, INPUT_DOWN_PRESS);
+    fast.input(INPUT_DOWN_PRESS);
+    while(!fast.isOver()){
+        fast.tick();
+        recorder.tick(fast);
+    }
+    while(!slow.isOver()) slow.tick();
+    if(slow.ticks() <= fast.ticks()){
+        cerr<<"seed "<<seed<<" doesn't give a longer game without the down key"<<endl;
+        return EXIT_FAILURE;
+    }
+    ReplayRecorder honest = recorder;
+    honest.finish(fast);
+    recorder.finish(slow);
+
+    bool ok = true;
+    Replay good, late;
+    if(!good.open(&honest.bytes()[0], honest.bytes().size()) || !ReplayPlayer(good).verify()){
+        cout<<"the recorded game doesn't verify\n";
+        ok = false;
+    }
+    if(!late.open(&recorder.bytes()[0], recorder.bytes().size())){
+        cout<<"the replay with a late end doesn't open\n";
+        return EXIT_FAILURE;
+    }
+    ReplayPlayer player(late);
+    player.seek(late.finalTick);
+    if(player.tick() != fast.ticks()){
+        cout<<"seeking to tick "<<late.finalTick<<" stopped at "<<player.tick()<<", not at the end of the game, "<<fast.ticks()<<"\n";
+        ok = false;
+    }
+    player.seek(0);
+    if(player.verify()){
+        cout<<"a game ending at tick "<<fast.ticks()<<" verifies against a recorded end at "<<late.finalTick<<"\n";
+        ok = false;
+    }
+    if(!checkKeyframe(seed)) ok = false;
+    cout<<"game over at tick "<<fast.ticks()<<", recorded at "<<late.finalTick<<": "<<(ok ? "ok" : "FAILED")<<endl;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char **argv) {
+    long long seekTick = -1;
+    bool dump = false;
+    vector<const char*> files;
+    for(int i=1; i<argc; i++){
+        if(strcmp(argv[i], "--generate") == 0 && i+2 < argc){
+            unsigned int seed = i+3 < argc ? strtoul(argv[i+3], nullptr, 10) : 1;
+            return generate(atoi(argv[i+1]), argv[i+2], seed);
+        }
+        else if(strcmp(argv[i], "--check") == 0) return check(i+1 < argc ? strtoul(argv[i+1], nullptr, 10) : 1);
+        else if(strcmp(argv[i], "--seek") == 0 && i+1 < argc) seekTick = atoll(argv[++i]);
+        else if(strcmp(argv[i], "--dump") == 0) dump = true;
+        else files.push_back(argv[i]);
+    }
+    if(files.empty()){
+        cerr<<"usage: "<<argv[0]<<" [--seek tick] [--dump] file.ttr...\n"
+            <<"       "<<argv[0]<<" --generate count prefix [seed]\n"
+            <<"       "<<argv[0]<<" --check [seed]"<<endl;
+        return EXIT_FAILURE;
+    }
+
+    int failures = 0;
+    long long totalTicks = 0;
+    auto start = chrono::steady_clock::now();
+    for(const char* path: files){
+        vector<unsigned char> data;
+        Replay replay;
+        if(!readFile(path, data) || data.empty() || !replay.open(&data[0], data.size())){
+            cerr<<path<<": not a valid replay"<<endl;
+            failures++;
+            continue;
+        }
+
+        ReplayPlayer player(replay);
+        if(seekTick >= 0){
+            player.seek(seekTick);
+            cout<<path<<" at tick "<<player.tick()<<":\n";
+            writeBoardText(player.game().snapshot(), cout);
+        }
+
+        player.seek(0);
+        bool ok = player.verify();
+        totalTicks += player.tick();
+        if(!ok) failures++;
+        cout<<path<<": "<<data.size()<<" bytes, seed "<<replay.seed<<", "<<replay.finalTick<<" ticks, "
+            <<replay.piecesPlaced<<" pieces, "<<replay.linesCleared<<" lines"
+            <<(replay.gameOver ? ", game over" : "")<<(ok ? ", verified" : ", MISMATCH");
+        if(!ok) cout<<" (replayed to tick "<<player.tick()<<")";
+        cout<<"\n";
+        if(dump) writeBoardText(player.game().snapshot(), cout);
+    }
+
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout<<files.size()<<" replays, "<<totalTicks / max(secs, 1e-9)<<" ticks/s"<<endl;
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,425 @@
+// tetris-server: hosts many independent headless games for thin clients.
+//
+//   tetris-server [--listen unix:path | tcp:host:port] [--threads n]
+//                 [--report seconds] [--duration seconds]
+//
+// Each worker thread owns one epoll loop, pinned to a core, with its own
+// tick timer and the sessions it accepted. Key presses apply as they
+// arrive; every UPDATE_INTERVAL each game ticks and the cells that changed
+// go out as a delta (see ServerProtocol.h). Tick latency is measured per
+// session from the moment the tick was due until its delta has been
+// handed to the socket. Pair it with tetris-loadgen.
+
+#include "Game.h"
+#include "ServerProtocol.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace std;
+
+// a client that lets this much output pile up is dropped
+const size_t MAX_PENDING_OUTPUT = 64 * 1024;
+
+atomic<bool> running(true);
+
+long long nowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// 10 us buckets up to 200 ms, the last one catches everything slower
+struct LatencyHistogram {
+    static const int BUCKET_US = 10;
+    static const int BUCKETS = 20000;
+    vector<long long> counts = vector<long long>(BUCKETS + 1);
+    long long samples = 0;
+    double maxUs = 0;
+
+    void add(double us){
+        counts[min((long long)(us / BUCKET_US), (long long)BUCKETS)]++;
+        samples++;
+        maxUs = max(maxUs, us);
+    }
+
+    void merge(const LatencyHistogram& o){
+        if(o.samples == 0) return;
+        for(int i=0; i<=BUCKETS; i++) counts[i] += o.counts[i];
+        samples += o.samples;
+        maxUs = max(maxUs, o.maxUs);
+    }
+
+    void clear(){
+        fill(counts.begin(), counts.end(), 0);
+        samples = 0;
+        maxUs = 0;
+    }
+
+    // upper edge of the bucket holding the p-th fraction of samples
+    double percentile(double p) const {
+        long long target = (long long)(p * samples);
+        long long seen = 0;
+        for(int i=0; i<=BUCKETS; i++){
+            seen += counts[i];
+            if(seen > target) return min((i + 1.0) * BUCKET_US, maxUs);
+        }
+        return maxUs;
+    }
+};
+
+struct Session {
+    int fd;
+    int index;      // position in Worker::live
+    Game game;
+    BoardView sent;
+    bool sentOver = false;
+    vector<unsigned char> out;
+    size_t outStart = 0;
+    bool writeWatched = false;
+};
+
+struct WorkerReport {
+    long long sessions = 0;
+    long long ticks = 0;
+    long long overruns = 0;
+    long long inputs = 0;
+    long long deltas = 0;
+    long long bytes = 0;
+    long long dropped = 0;
+    LatencyHistogram latency;
+};
+
+class Worker {
+public:
+    Worker(int index, int listenFd, int cpus) : _index(index), _listenFd(listenFd), _cpus(cpus) {}
+
+    void run();
+
+    // copies the counters since the last call and starts new ones
+    void collect(WorkerReport& into){
+        lock_guard<mutex> lock(_reportLock);
+        into.sessions += _sessions;
+        into.ticks += _report.ticks;
+        into.overruns += _report.overruns;
+        into.inputs += _report.inputs;
+        into.deltas += _report.deltas;
+        into.bytes += _report.bytes;
+        into.dropped += _report.dropped;
+        into.latency.merge(_report.latency);
+        _report = WorkerReport();
+    }
+
+private:
+    void accept();
+    void read(Session* s);
+    bool flush(Session* s);
+    void tick(long long due);
+    void close(Session* s);
+
+    int _index, _listenFd, _cpus;
+    int _epoll = -1, _timer = -1;
+    vector<Session*> _byFd;
+    vector<Session*> _live;
+    unsigned int _seed = 0;
+
+    mutex _reportLock;
+    WorkerReport _report;
+    long long _sessions = 0;
+    LatencyHistogram _tickLatency;
+};
+
+void Worker::run() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(_index % _cpus, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+    _seed = (unsigned int)nowNs() ^ (_index * 0x9E3779B9u);
+    _epoll = epoll_create1(EPOLL_CLOEXEC);
+    _timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    // all workers wait on the one listening socket, the kernel wakes one
+    epoll_event ev;
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+    ev.data.fd = _listenFd;
+    epoll_ctl(_epoll, EPOLL_CTL_ADD, _listenFd, &ev);
+
+    const long long interval = (long long)(UPDATE_INTERVAL * 1000000);
+    long long due = nowNs() + interval;
+    itimerspec spec;
+    spec.it_value.tv_sec = due / 1000000000LL;
+    spec.it_value.tv_nsec = due % 1000000000LL;
+    spec.it_interval.tv_sec = interval / 1000000000LL;
+    spec.it_interval.tv_nsec = interval % 1000000000LL;
+    timerfd_settime(_timer, TFD_TIMER_ABSTIME, &spec, nullptr);
+    ev.events = EPOLLIN;
+    ev.data.fd = _timer;
+    epoll_ctl(_epoll, EPOLL_CTL_ADD, _timer, &ev);
+
+    epoll_event events[256];
+    while(running.load(memory_order_relaxed)){
+        int n = epoll_wait(_epoll, events, 256, 100);
+        for(int i=0; i<n; i++){
+            int fd = events[i].data.fd;
+            if(fd == _listenFd) accept();
+            else if(fd == _timer){
+                unsigned long long expired = 0;
+                if(::read(_timer, &expired, sizeof(expired)) != sizeof(expired) || expired == 0) continue;
+                // ticks that were missed are skipped, not caught up
+                due += interval * expired;
+                if(expired > 1){
+                    lock_guard<mutex> lock(_reportLock);
+                    _report.overruns += expired - 1;
+                }
+                tick(due - interval);
+            }
+            else if(fd < (int)_byFd.size() && _byFd[fd]){
+                Session* s = _byFd[fd];
+                if(events[i].events & (EPOLLERR | EPOLLHUP)) close(s);
+                else {
+                    if(events[i].events & EPOLLIN) read(s);
+                    if(fd < (int)_byFd.size() && _byFd[fd] == s && (events[i].events & EPOLLOUT)) flush(s);
+                }
+            }
+        }
+    }
+
+    while(!_live.empty()) close(_live.back());
+    ::close(_timer);
+    ::close(_epoll);
+}
+
+void Worker::accept() {
+    int fd = accept4(_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if(fd < 0) return;
+
+    Session* s = new Session();
+    s->fd = fd;
+    s->index = _live.size();
+    _seed ^= _seed << 13;
+    _seed ^= _seed >> 17;
+    _seed ^= _seed << 5;
+    s->game.reset(_seed);
+    memset(s->sent, EMPTY_CELL, sizeof(s->sent));
+    s->out.reserve(MAX_DELTA_BYTES);
+
+    if((int)_byFd.size() <= fd) _byFd.resize(fd + 1, nullptr);
+    _byFd[fd] = s;
+    _live.push_back(s);
+
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &ev);
+}
+
+void Worker::read(Session* s) {
+    unsigned char buf[256];
+    long long inputs = 0;
+    for(;;){
+        ssize_t n = recv(s->fd, buf, sizeof(buf), 0);
+        if(n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)){
+            close(s);
+            break;
+        }
+        if(n < 0) break;
+        for(ssize_t i=0; i<n; i++){
+            if(buf[i] > INPUT_HARD_DROP){
+                close(s);
+                return;
+            }
+            s->game.input(Input(buf[i]));
+        }
+        inputs += n;
+    }
+    lock_guard<mutex> lock(_reportLock);
+    _report.inputs += inputs;
+}
+
+// Writes what it can. Returns false when the session had to be closed.
+bool Worker::flush(Session* s) {
+    while(s->outStart < s->out.size()){
+        ssize_t n = send(s->fd, &s->out[s->outStart], s->out.size() - s->outStart, MSG_NOSIGNAL);
+        if(n < 0){
+            if(errno == EAGAIN || errno == EWOULDBLOCK) break;
+            close(s);
+            return false;
+        }
+        s->outStart += n;
+    }
+    if(s->outStart == s->out.size()){
+        s->out.clear();
+        s->outStart = 0;
+    }
+
+    bool watch = !s->out.empty();
+    if(watch != s->writeWatched){
+        epoll_event ev;
+        ev.events = EPOLLIN | (watch ? EPOLLOUT : 0);
+        ev.data.fd = s->fd;
+        epoll_ctl(_epoll, EPOLL_CTL_MOD, s->fd, &ev);
+        s->writeWatched = watch;
+    }
+    return true;
+}
+
+void Worker::tick(long long due) {
+    _tickLatency.clear();
+    long long deltas = 0, bytes = 0, dropped = 0;
+    BoardView view;
+
+    // iterate backwards so a close (swap with the last) skips nobody
+    for(int i=(int)_live.size()-1; i>=0; i--){
+        Session* s = _live[i];
+        s->game.tick();
+        renderView(s->game, view);
+        size_t before = s->out.size();
+        if(encodeDelta(s->sent, s->sentOver, view, s->game.isOver(), s->game.ticks(), s->out)){
+            memcpy(s->sent, view, sizeof(view));
+            s->sentOver = s->game.isOver();
+            deltas++;
+            bytes += s->out.size() - before;
+            if(s->out.size() - s->outStart > MAX_PENDING_OUTPUT){
+                dropped++;
+                close(s);
+                continue;
+            }
+            if(!flush(s)) continue;
+        }
+        _tickLatency.add((nowNs() - due) / 1000.0);
+    }
+
+    lock_guard<mutex> lock(_reportLock);
+    _sessions = _live.size();
+    _report.ticks++;
+    _report.deltas += deltas;
+    _report.bytes += bytes;
+    _report.dropped += dropped;
+    _report.latency.merge(_tickLatency);
+}
+
+void Worker::close(Session* s) {
+    epoll_ctl(_epoll, EPOLL_CTL_DEL, s->fd, nullptr);
+    ::close(s->fd);
+    _byFd[s->fd] = nullptr;
+    _live[s->index] = _live.back();
+    _live[s->index]->index = s->index;
+    _live.pop_back();
+    delete s;
+}
+
+//----------------------------------------------------------------------------
+
+void stop(int) {
+    running = false;
+}
+
+void printReport(const WorkerReport& r, const vector<long long>& perWorker, double seconds) {
+    cout<<r.sessions<<" sessions (";
+    for(size_t i=0; i<perWorker.size(); i++) cout<<(i ? "/" : "")<<perWorker[i];
+    cout<<" per core), "<<r.ticks / seconds<<" worker ticks/s, "<<r.overruns<<" overruns, "
+        <<r.inputs / seconds<<" inputs/s, "<<r.deltas / seconds<<" deltas/s, "
+        <<r.bytes / seconds / 1024<<" KB/s";
+    if(r.dropped) cout<<", "<<r.dropped<<" slow clients dropped";
+    cout<<"\n  tick latency p50 "<<r.latency.percentile(0.5)<<" us, p99 "<<r.latency.percentile(0.99)
+        <<" us, max "<<r.latency.maxUs<<" us"<<endl;
+}
+
+int main(int argc, char **argv) {
+    string listenAddr = "tcp:127.0.0.1:47200";
+    int threads = thread::hardware_concurrency();
+    double reportSeconds = 5, duration = 0;
+    for(int i=1; i<argc; i++){
+        if(strcmp(argv[i], "--listen") == 0 && i+1 < argc) listenAddr = argv[++i];
+        else if(strcmp(argv[i], "--threads") == 0 && i+1 < argc) threads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--report") == 0 && i+1 < argc) reportSeconds = atof(argv[++i]);
+        else if(strcmp(argv[i], "--duration") == 0 && i+1 < argc) duration = atof(argv[++i]);
+        else {
+            cerr<<"Usage: "<<argv[0]<<" [--listen unix:path | tcp:host:port] [--threads n] [--report seconds] [--duration seconds]"<<endl;
+            return EXIT_FAILURE;
+        }
+    }
+    int cpus = max(1u, thread::hardware_concurrency());
+    threads = max(threads, 1);
+    if(reportSeconds <= 0) reportSeconds = 5;
+
+    SocketAddress addr;
+    if(!parseAddress(listenAddr, addr)){
+        cerr<<"Bad listen address "<<listenAddr<<endl;
+        return EXIT_FAILURE;
+    }
+    int listenFd = listenOn(addr);
+    if(listenFd < 0) return EXIT_FAILURE;
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    signal(SIGPIPE, SIG_IGN);
+    long long files = raiseFileLimit();
+    cout<<"listening on "<<listenAddr<<" with "<<threads<<" workers, up to "<<files<<" descriptors"<<endl;
+
+    vector<Worker*> workers;
+    vector<thread> pool;
+    for(int i=0; i<threads; i++){
+        workers.push_back(new Worker(i, listenFd, cpus));
+        pool.push_back(thread(&Worker::run, workers.back()));
+    }
+
+    WorkerReport total;
+    vector<long long> busiestPerWorker;
+    long long start = nowNs(), last = start;
+    while(running){
+        this_thread::sleep_for(chrono::milliseconds(100));
+        long long now = nowNs();
+        bool finished = duration > 0 && now - start >= duration * 1e9;
+        if(now - last < reportSeconds * 1e9 && !finished) continue;
+
+        WorkerReport r;
+        vector<long long> perWorker;
+        for(Worker* w: workers){
+            long long before = r.sessions;
+            w->collect(r);
+            perWorker.push_back(r.sessions - before);
+        }
+        printReport(r, perWorker, (now - last) / 1e9);
+        total.ticks += r.ticks;
+        total.overruns += r.overruns;
+        total.inputs += r.inputs;
+        total.deltas += r.deltas;
+        total.bytes += r.bytes;
+        total.dropped += r.dropped;
+        total.latency.merge(r.latency);
+        // the whole run reports its busiest interval
+        if(r.sessions >= total.sessions){
+            total.sessions = r.sessions;
+            busiestPerWorker = perWorker;
+        }
+        last = now;
+        if(finished) running = false;
+    }
+
+    for(thread& t: pool) t.join();
+    for(Worker* w: workers) delete w;
+    ::close(listenFd);
+    if(addr.unixSocket) unlink(addr.path.c_str());
+
+    cout<<"whole run: ";
+    printReport(total, busiestPerWorker, max((last - start) / 1e9, 1e-9));
+    return EXIT_SUCCESS;
+}
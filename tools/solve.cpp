@@ -0,0 +1,164 @@
+// tetris-solve: solves puzzles in bulk.
+//
+//   tetris-solve [--threads n] [--visited-mb n] [--max-nodes n] [--quiet]
+//                [file ...]
+//   tetris-solve --generate n [--pieces k] [--seed s]
+//
+// Reads puzzles (Solver.h) from the files, or standard input, and solves
+// them one after another on all threads. Prints each one's answer as a
+// placement per piece, orientation, x and y as PlacementFinder gives
+// them, then the totals. Every solution is checked by playing it from
+// the puzzle's board; one that fails makes the run fail.
+//
+// --generate writes n puzzles that are known to have a solution: the Bot
+// plays from an empty board, and the board it has after a random number
+// of pieces, with the k pieces it placed next and the lines they cleared,
+// is the puzzle.
+
+#include "Bot.h"
+#include "Solver.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static int generate(int count, int length, unsigned int rng) {
+    auto random = [&rng](){
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+    };
+    const PieceTable& t = pieceTable();
+    Bot bot;
+    for(int made=0; made<count; ){
+        // a few pieces in, so the board isn't empty
+        BoardRows rows = {};
+        int skip = 3 + random() % 12;
+        vector<int> shapes;
+        int lines = 0;
+        BoardRows start;
+        bool lost = false;
+        for(int i=0; i<skip + length && !lost; i++){
+            if(i == skip){
+                memcpy(start, rows, sizeof(start));
+                lines = 0;
+            }
+            int shape = random() % NUM_SHAPES;
+            Placement p;
+            lost = !bot.choose(rows, shape, 0, SPAWN_X, SPAWN_Y, -1, p);
+            if(lost) break;
+            int cleared = t.lock(rows, shape, p.orient, p.x, p.y);
+            if(i >= skip){
+                shapes.push_back(shape);
+                lines += cleared;
+            }
+        }
+        if(lost || lines == 0) continue;
+
+        cout<<"pieces ";
+        for(int s: shapes) cout<<SHAPE_NAMES[s];
+        cout<<"\nlines "<<lines<<"\n";
+        BoardSnapshot snap;
+        for(int r=0; r<NUM_ROWS; r++){
+            for(int c=0; c<NUM_COLS; c++) snap.cells[r][c] = start[r] >> c & 1 ? GARBAGE_CELL : EMPTY_CELL;
+        }
+        writeBoardText(snap, cout);
+        made++;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+    int threads = thread::hardware_concurrency();
+    size_t visitedMb = 64;
+    long long maxNodes = 0;
+    bool quiet = false;
+    int generateCount = 0, length = 8;
+    unsigned int seed = 1;
+    vector<const char*> files;
+    for(int i=1; i<argc; i++){
+        if(strcmp(argv[i], "--threads") == 0 && i+1 < argc) threads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--visited-mb") == 0 && i+1 < argc) visitedMb = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--max-nodes") == 0 && i+1 < argc) maxNodes = atoll(argv[++i]);
+        else if(strcmp(argv[i], "--quiet") == 0) quiet = true;
+        else if(strcmp(argv[i], "--generate") == 0 && i+1 < argc) generateCount = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--pieces") == 0 && i+1 < argc) length = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0 && i+1 < argc) seed = strtoul(argv[++i], nullptr, 10);
+        else if(argv[i][0] != '-') files.push_back(argv[i]);
+        else {
+            cerr<<"Usage: "<<argv[0]<<" [--threads n] [--visited-mb n] [--max-nodes n] [--quiet] [file ...]"<<endl;
+            cerr<<"       "<<argv[0]<<" --generate n [--pieces k] [--seed s]"<<endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if(generateCount > 0){
+        if(length < 1 || length > MAX_PUZZLE_PIECES || seed == 0) return EXIT_FAILURE;
+        return generate(generateCount, length, seed);
+    }
+    threads = max(1, threads);
+
+    Solver solver(threads, max<size_t>(1, visitedMb));
+    long long counts[3] = {}, bad = 0, puzzles = 0;
+    SolverStats total;
+    auto start = chrono::steady_clock::now();
+    auto solveAll = [&](istream& in, const char* name){
+        Puzzle puzzle;
+        string error;
+        while(readPuzzle(in, puzzle, error)){
+            Solver::Result result = solver.solve(puzzle, maxNodes);
+            counts[result.outcome]++;
+            total.add(result.stats);
+            bool ok = result.outcome != Solver::SOLVED || checkSolution(puzzle, result.placements);
+            if(!ok) bad++;
+            if(!quiet || !ok){
+                cout<<"puzzle "<<puzzles<<": ";
+                if(result.outcome == Solver::SOLVED){
+                    cout<<(ok ? "solved" : "WRONG SOLUTION")<<",";
+                    for(size_t i=0; i<result.placements.size(); i++){
+                        const Placement& p = result.placements[i];
+                        cout<<" "<<SHAPE_NAMES[puzzle.pieces[i]]<<" "<<(int)p.orient<<" "<<(int)p.x<<" "<<(int)p.y
+                            <<(i + 1 < result.placements.size() ? "," : "");
+                    }
+                }
+                else cout<<(result.outcome == Solver::NO_SOLUTION ? "no solution" : "gave up");
+                cout<<" ("<<result.stats.nodes<<" nodes, "<<result.seconds * 1000<<" ms)\n";
+            }
+            puzzles++;
+        }
+        if(!error.empty()){
+            cerr<<name<<": puzzle "<<puzzles<<": "<<error<<endl;
+            return false;
+        }
+        return true;
+    };
+    if(files.empty()){
+        if(!solveAll(cin, "stdin")) return EXIT_FAILURE;
+    }
+    for(const char* file: files){
+        ifstream in(file);
+        if(!in){
+            cerr<<"Failed to open "<<file<<endl;
+            return EXIT_FAILURE;
+        }
+        if(!solveAll(in, file)) return EXIT_FAILURE;
+    }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout<<puzzles<<" puzzles: "<<counts[Solver::SOLVED]<<" solved, "<<counts[Solver::NO_SOLUTION]<<" without a solution, "
+        <<counts[Solver::GAVE_UP]<<" given up"<<endl;
+    cout<<threads<<" threads, "<<secs<<" s, "<<puzzles / max(secs, 1e-9) * 60<<" puzzles/min, "
+        <<total.nodes / max(secs, 1e-9) / 1e6<<" M nodes/s; "<<total.repeats<<" repeats, "<<total.cutoffs<<" cut off, "
+        <<total.steals<<" steals"<<endl;
+    if(bad){
+        cerr<<bad<<" solutions failed the check"<<endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+// tetris-spectate: follows a running game through its shared memory
+// spectator feed (Tetris --feed) and rebuilds the board from the events.
+//
+//   tetris-spectate [--show] [--name /feed] [--duration seconds]
+//
+// Once a second it reports events read, how far behind the writer it is,
+// in events and in time from publish to read, and any events lost to
+// being lapped. --show also prints the board after every change.
+
+#include "Board.h"
+#include "SpectatorFeed.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+// the board as the events describe it
+struct SpectatorBoard {
+    BoardSnapshot snap;
+
+    void apply(const FeedEvent& e){
+        switch(e.type){
+            case FEED_BOARD:
+                memcpy(snap.cells, e.cells, sizeof(snap.cells));
+                setPiece(e);
+                snap.gameOver = e.over;
+                break;
+            case FEED_SPAWN:
+                setPiece(e);
+                break;
+            case FEED_LOCK:
+                for(int k=0; k<PIECE_CELLS; k++) snap.cells[e.pieceY[k]][e.pieceX[k]] = e.color;
+                snap.pieceCells = 0;
+                break;
+            case FEED_CLEAR: {
+                int dst = 0;
+                for(int src=0; src<NUM_ROWS; src++){
+                    if(e.rows & (1u << src)) continue;
+                    if(dst != src) memcpy(snap.cells[dst], snap.cells[src], NUM_COLS);
+                    dst++;
+                }
+                for(; dst<NUM_ROWS; dst++) memset(snap.cells[dst], EMPTY_CELL, NUM_COLS);
+                break;
+            }
+            case FEED_GAME_OVER:
+                snap.gameOver = true;
+                break;
+        }
+    }
+
+    void setPiece(const FeedEvent& e){
+        snap.pieceCells = PIECE_CELLS;
+        for(int k=0; k<PIECE_CELLS; k++){
+            snap.pieceX[k] = e.pieceX[k];
+            snap.pieceY[k] = e.pieceY[k];
+        }
+        snap.pieceColor = e.color;
+    }
+};
+
+int main(int argc, char **argv) {
+    const char* name = FEED_DEFAULT_NAME;
+    bool show = false;
+    double duration = 0;
+    for(int i=1; i<argc; i++){
+        if(strcmp(argv[i], "--show") == 0) show = true;
+        else if(strcmp(argv[i], "--name") == 0 && i+1 < argc) name = argv[++i];
+        else if(strcmp(argv[i], "--duration") == 0 && i+1 < argc) duration = atof(argv[++i]);
+        else {
+            cerr<<"Usage: "<<argv[0]<<" [--show] [--name /feed] [--duration seconds]"<<endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    FeedReader reader;
+    if(!reader.open(name)){
+        cerr<<"No spectator feed at "<<name<<" (start the game with --feed)"<<endl;
+        return EXIT_FAILURE;
+    }
+
+    SpectatorBoard board;
+    bool synced = false;
+    long long events = 0, maxBehind = 0;
+    double lagSum = 0, lagMax = 0;
+    long long lastTick = 0;
+    auto start = chrono::steady_clock::now();
+    auto nextReport = start + chrono::seconds(1);
+    for(;;){
+        FeedEvent e;
+        Feed_read_status status;
+        bool changed = false;
+        while((status = reader.next(e)) != FEED_READ_EMPTY){
+            maxBehind = max(maxBehind, (long long)reader.behind());
+            if(status == FEED_READ_LOST){
+                synced = false;
+                continue;
+            }
+            // nothing makes sense before the first full board
+            if(!synced && e.type != FEED_BOARD) continue;
+            synced = true;
+            board.apply(e);
+            double lag = (feedClockNs() - e.timeNs) / 1000.0;
+            lagSum += lag;
+            lagMax = max(lagMax, lag);
+            lastTick = e.tick;
+            events++;
+            changed = true;
+        }
+
+        if(changed && show){
+            writeBoardText(board.snap, cout);
+            cout<<endl;
+        }
+
+        auto now = chrono::steady_clock::now();
+        if(now >= nextReport){
+            cout<<"tick "<<lastTick<<": "<<events<<" events, behind by up to "<<maxBehind<<" events, lag "
+                <<(events ? lagSum / events : 0)<<" us average, "<<lagMax<<" us max, "<<reader.lost()<<" lost in total"<<endl;
+            events = maxBehind = 0;
+            lagSum = lagMax = 0;
+            nextReport += chrono::seconds(1);
+        }
+        if(duration > 0 && now - start >= chrono::duration<double>(duration)) break;
+        // the game ticks every UPDATE_INTERVAL ms, polling faster than that is plenty
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,380 @@
+// tetris-tournament: versus matches between controllers (Controller.h).
+//
+//   tetris-tournament [--swiss] [--rounds n] [--games n] [--frames n]
+//                     [--threads n] [--seed s] [--csv file] [--json file]
+//                     [name=]spec ...
+//
+// Every game is a VersusMatch, garbage included, played headless on the
+// Game's own rules. All pairings in a round play the same seeds, so every
+// controller meets the same piece sequences, and the two sides swap each
+// game. A game ends when a side tops out; one still going after --frames
+// ticks goes to the side that cleared more lines, and is drawn on equal
+// lines.
+//
+// The default is a round robin: every pair plays --games games. --swiss
+// plays --rounds rounds instead (enough to separate the field by
+// default); each round pairs players with equal match points where it
+// can, and never twice the same where there is a way to avoid it. With
+// an odd number, one gets a bye worth a win.
+// Games are shared out over all threads as they come, a round's worth
+// at a time.
+//
+// Reports each controller's score, a win being 1 and a draw 1/2, with a
+// 95% confidence interval, then each pairing's. --csv writes the
+// standings, --json the standings and every pairing.
+
+#include "Controller.h"
+#include "Versus.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+struct Entrant {
+    string name, spec;
+    double points = 0;              // Swiss match points
+    vector<int> met;
+    bool bye = false;
+    // game results from this side's point of view
+    long long games = 0, wins = 0, draws = 0, losses = 0;
+    long long lines = 0;
+};
+
+struct GameJob {
+    int a, b;                       // entrants
+    unsigned int seed;
+    bool swapped;                   // a plays side 1
+    // filled in by the game
+    int winner;                     // 0 for a, 1 for b, -1 for a draw
+    long long lines[2];
+    long long frames;
+};
+
+struct Pairing {
+    int a, b;
+    long long games = 0, winsA = 0, draws = 0, winsB = 0;
+};
+
+// a score between 0 and 1 and its 95% interval: the Wilson interval,
+// with draws as half a win, which stays open at all wins or all losses
+struct Score {
+    double mean, low, high;
+};
+
+static Score score(long long games, double sum) {
+    Score s = { 0, 0, 1 };
+    if(games == 0) return s;
+    const double z2 = 1.96 * 1.96;
+    double n = games;
+    s.mean = sum / n;
+    double center = (s.mean + z2 / (2 * n)) / (1 + z2 / n);
+    double half = sqrt(s.mean * (1 - s.mean) / n + z2 / (4 * n * n)) * 1.96 / (1 + z2 / n);
+    s.low = max(0.0, center - half);
+    s.high = min(1.0, center + half);
+    return s;
+}
+
+// names and specs come from the command line, so they're quoted for
+// the files they go into
+static string csvField(const string& s) {
+    string out = "\"";
+    for(char c: s){
+        if(c == '"') out += '"';
+        out += c;
+    }
+    return out + "\"";
+}
+
+static string jsonString(const string& s) {
+    string out = "\"";
+    for(char c: s){
+        if(c == '"' || c == '\\') out += '\\';
+        if((unsigned char)c < 0x20){
+            char hex[8];
+            snprintf(hex, sizeof(hex), "\\u%04x", c);
+            out += hex;
+        }
+        else out += c;
+    }
+    return out + "\"";
+}
+
+static void playGame(const vector<Entrant>& entrants, long long maxFrames, GameJob& job) {
+    int side[2] = { job.swapped ? job.b : job.a, job.swapped ? job.a : job.b };
+    unique_ptr<Controller> players[2];
+    string error;
+    for(int i=0; i<2; i++) players[i] = makeController(entrants[side[i]].spec, job.seed * 2 + i + 1, error);
+
+    VersusMatch match;
+    match.reset(job.seed);
+    while(!match.isOver() && match.frame < maxFrames){
+        FrameInput in[2];
+        for(int i=0; i<2; i++){
+            Input key;
+            in[i] = players[i]->step(match.players[i], key) ? 1 << key : 0;
+        }
+        match.step(in);
+    }
+
+    long long lines[2] = { match.players[0].linesCleared(), match.players[1].linesCleared() };
+    int winner = match.winner();
+    if(!match.isOver() && lines[0] != lines[1]) winner = lines[0] > lines[1] ? 0 : 1;
+    // back to a and b
+    job.winner = winner < 0 ? -1 : (winner == 1) == job.swapped ? 0 : 1;
+    job.lines[0] = lines[job.swapped ? 1 : 0];
+    job.lines[1] = lines[job.swapped ? 0 : 1];
+    job.frames = match.frame;
+}
+
+// Plays every job, taking them off a shared counter so no thread waits
+// while there are games left.
+static void playAll(const vector<Entrant>& entrants, long long maxFrames, int threads, vector<GameJob>& jobs) {
+    atomic<size_t> next(0);
+    auto work = [&]{
+        for(size_t i=next++; i<jobs.size(); i=next++) playGame(entrants, maxFrames, jobs[i]);
+    };
+    vector<thread> workers;
+    for(int t=1; t<threads && t<(int)jobs.size(); t++) workers.emplace_back(work);
+    work();
+    for(auto& w: workers) w.join();
+}
+
+// The games between each pair, both sides in turn, on the round's seeds.
+static void addPairing(int a, int b, int games, unsigned int seed, vector<GameJob>& jobs) {
+    for(int g=0; g<games; g++){
+        GameJob job;
+        job.a = a;
+        job.b = b;
+        job.seed = seed + g;
+        job.swapped = g % 2 == 1;
+        jobs.push_back(job);
+    }
+}
+
+// Pairs order[from...] down the standings, each with the highest placed
+// one left that it hasn't met, backing up when that strands someone.
+// Gives up after so many tries.
+static bool pairFresh(const vector<Entrant>& entrants, const vector<int>& order, vector<bool>& paired,
+                      vector<pair<int, int>>& pairs, int& tries) {
+    size_t i = 0;
+    while(i < order.size() && paired[i]) i++;
+    if(i == order.size()) return true;
+    const vector<int>& met = entrants[order[i]].met;
+    for(size_t j=i+1; j<order.size() && tries > 0; j++){
+        if(paired[j] || find(met.begin(), met.end(), order[j]) != met.end()) continue;
+        tries--;
+        paired[i] = paired[j] = true;
+        pairs.push_back(make_pair(order[i], order[j]));
+        if(pairFresh(entrants, order, paired, pairs, tries)) return true;
+        pairs.pop_back();
+        paired[i] = paired[j] = false;
+    }
+    return false;
+}
+
+// Swiss pairings by match points, without rematches when there is a way,
+// and otherwise simply down the standings. The bye goes to the lowest
+// placed that hasn't had one.
+static vector<pair<int, int>> swissPairs(vector<Entrant>& entrants) {
+    vector<int> order(entrants.size());
+    for(size_t i=0; i<order.size(); i++) order[i] = i;
+    stable_sort(order.begin(), order.end(), [&](int x, int y){ return entrants[x].points > entrants[y].points; });
+
+    if(order.size() % 2 == 1){
+        int pick = order.size() - 1;
+        while(pick > 0 && entrants[order[pick]].bye) pick--;
+        entrants[order[pick]].bye = true;
+        entrants[order[pick]].points += 1;
+        order.erase(order.begin() + pick);
+    }
+    vector<pair<int, int>> pairs;
+    vector<bool> paired(order.size(), false);
+    int tries = 100000;
+    if(pairFresh(entrants, order, paired, pairs, tries)) return pairs;
+    pairs.clear();
+    for(size_t i=0; i<order.size(); i+=2) pairs.push_back(make_pair(order[i], order[i+1]));
+    return pairs;
+}
+
+int main(int argc, char **argv) {
+    bool swiss = false;
+    int rounds = 0, games = 8;
+    long long maxFrames = 3000;
+    int threads = thread::hardware_concurrency();
+    unsigned int seed = 1;
+    string csvPath, jsonPath;
+    vector<Entrant> entrants;
+    for(int i=1; i<argc; i++){
+        if(strcmp(argv[i], "--swiss") == 0) swiss = true;
+        else if(strcmp(argv[i], "--rounds") == 0 && i+1 < argc) rounds = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--games") == 0 && i+1 < argc) games = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--frames") == 0 && i+1 < argc) maxFrames = atoll(argv[++i]);
+        else if(strcmp(argv[i], "--threads") == 0 && i+1 < argc) threads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0 && i+1 < argc) seed = strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "--csv") == 0 && i+1 < argc) csvPath = argv[++i];
+        else if(strcmp(argv[i], "--json") == 0 && i+1 < argc) jsonPath = argv[++i];
+        else if(argv[i][0] != '-'){
+            Entrant e;
+            e.spec = argv[i];
+            size_t eq = e.spec.find('=');
+            e.name = e.spec.substr(0, eq);
+            if(eq != string::npos) e.spec = e.spec.substr(eq + 1);
+            entrants.push_back(e);
+        }
+        else {
+            entrants.clear();
+            break;
+        }
+    }
+    if(entrants.size() < 2 || games < 1 || maxFrames < 1){
+        cerr<<"Usage: "<<argv[0]<<" [--swiss] [--rounds n] [--games n] [--frames n] [--threads n] [--seed s]"
+            <<" [--csv file] [--json file] [name=]spec [name=]spec ..."<<endl;
+        cerr<<"Controller specs: "<<CONTROLLER_SPECS<<endl;
+        return EXIT_FAILURE;
+    }
+    for(const Entrant& e: entrants){
+        string error;
+        if(!makeController(e.spec, 1, error)){
+            cerr<<error<<endl;
+            return EXIT_FAILURE;
+        }
+    }
+    threads = max(1, threads);
+    int n = entrants.size();
+    if(!swiss) rounds = 1;
+    else if(rounds < 1){
+        // enough for one player to win every round
+        for(rounds = 1; (1 << rounds) < n; rounds++);
+        rounds++;
+    }
+
+    map<pair<int, int>, Pairing> pairings;
+    long long totalGames = 0, totalFrames = 0;
+    auto start = chrono::steady_clock::now();
+    for(int r=0; r<rounds; r++){
+        vector<pair<int, int>> pairs;
+        if(swiss) pairs = swissPairs(entrants);
+        else {
+            for(int a=0; a<n; a++){
+                for(int b=a+1; b<n; b++) pairs.push_back(make_pair(a, b));
+            }
+        }
+        vector<GameJob> jobs;
+        for(const auto& p: pairs) addPairing(min(p.first, p.second), max(p.first, p.second), games, seed + r * games, jobs);
+        playAll(entrants, maxFrames, threads, jobs);
+
+        map<pair<int, int>, double> roundScore;
+        for(const GameJob& job: jobs){
+            totalGames++;
+            totalFrames += job.frames;
+            Pairing& p = pairings[make_pair(job.a, job.b)];
+            p.a = job.a;
+            p.b = job.b;
+            p.games++;
+            double scoreA = job.winner == 0 ? 1 : job.winner < 0 ? 0.5 : 0;
+            (job.winner == 0 ? p.winsA : job.winner < 0 ? p.draws : p.winsB)++;
+            roundScore[make_pair(job.a, job.b)] += scoreA;
+
+            const int side[2] = { job.a, job.b };
+            for(int i=0; i<2; i++){
+                Entrant& e = entrants[side[i]];
+                double s = i == 0 ? scoreA : 1 - scoreA;
+                e.games++;
+                (s == 1 ? e.wins : s == 0 ? e.losses : e.draws)++;
+                e.lines += job.lines[i];
+            }
+        }
+        for(const auto& p: pairs){
+            double s = roundScore[make_pair(min(p.first, p.second), max(p.first, p.second))] / games;
+            if(p.first > p.second) s = 1 - s;
+            entrants[p.first].points += s > 0.5 ? 1 : s < 0.5 ? 0 : 0.5;
+            entrants[p.second].points += s < 0.5 ? 1 : s > 0.5 ? 0 : 0.5;
+            entrants[p.first].met.push_back(p.second);
+            entrants[p.second].met.push_back(p.first);
+        }
+        if(swiss) cerr<<"round "<<r + 1<<" of "<<rounds<<" done"<<endl;
+    }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    vector<int> order(n);
+    vector<Score> scores(n);
+    for(int i=0; i<n; i++){
+        order[i] = i;
+        const Entrant& e = entrants[i];
+        scores[i] = score(e.games, e.wins + 0.5 * e.draws);
+    }
+    stable_sort(order.begin(), order.end(), [&](int x, int y){
+        if(swiss && entrants[x].points != entrants[y].points) return entrants[x].points > entrants[y].points;
+        return scores[x].mean > scores[y].mean;
+    });
+
+    cout<<(swiss ? "Swiss, " + to_string(rounds) + " rounds" : string("round robin"))<<", "<<games<<" games a pairing, "
+        <<totalGames<<" games, "<<threads<<" threads, "<<secs<<" s, "<<totalFrames / max(secs, 1e-9)<<" frames/s\n";
+    for(int i: order){
+        const Entrant& e = entrants[i];
+        cout<<e.name<<": score "<<scores[i].mean<<" ["<<scores[i].low<<", "<<scores[i].high<<"] over "<<e.games<<" games, "
+            <<e.wins<<"-"<<e.draws<<"-"<<e.losses<<", "<<(double)e.lines / max(1LL, e.games)<<" lines a game";
+        if(swiss) cout<<", "<<e.points<<" match points"<<(e.bye ? " (bye)" : "");
+        cout<<"\n";
+    }
+    for(const auto& kv: pairings){
+        const Pairing& p = kv.second;
+        Score s = score(p.games, p.winsA + 0.5 * p.draws);
+        cout<<"  "<<entrants[p.a].name<<" vs "<<entrants[p.b].name<<": "<<p.winsA<<"-"<<p.draws<<"-"<<p.winsB
+            <<", score "<<s.mean<<" ["<<s.low<<", "<<s.high<<"]\n";
+    }
+
+    if(!csvPath.empty()){
+        ofstream out(csvPath);
+        out<<"name,spec,games,wins,draws,losses,score,score_low,score_high,lines_per_game,match_points\n";
+        for(int i: order){
+            const Entrant& e = entrants[i];
+            out<<csvField(e.name)<<","<<csvField(e.spec)<<","<<e.games<<","<<e.wins<<","<<e.draws<<","<<e.losses<<","<<scores[i].mean<<","
+               <<scores[i].low<<","<<scores[i].high<<","<<(double)e.lines / max(1LL, e.games)<<","<<e.points<<"\n";
+        }
+        if(!out){
+            cerr<<"Failed to write "<<csvPath<<endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if(!jsonPath.empty()){
+        ofstream out(jsonPath);
+        out<<"{\n  \"format\": \""<<(swiss ? "swiss" : "round-robin")<<"\", \"rounds\": "<<rounds<<", \"games\": "<<games
+           <<", \"frames\": "<<maxFrames<<", \"seed\": "<<seed<<",\n  \"standings\": [\n";
+        for(int k=0; k<n; k++){
+            int i = order[k];
+            const Entrant& e = entrants[i];
+            out<<"    {\"name\": "<<jsonString(e.name)<<", \"spec\": "<<jsonString(e.spec)<<", \"games\": "<<e.games<<", \"wins\": "<<e.wins
+               <<", \"draws\": "<<e.draws<<", \"losses\": "<<e.losses<<", \"score\": "<<scores[i].mean<<", \"score_low\": "
+               <<scores[i].low<<", \"score_high\": "<<scores[i].high<<", \"lines_per_game\": "<<(double)e.lines / max(1LL, e.games)
+               <<", \"match_points\": "<<e.points<<"}"<<(k + 1 < n ? "," : "")<<"\n";
+        }
+        out<<"  ],\n  \"pairings\": [\n";
+        size_t k = 0;
+        for(const auto& kv: pairings){
+            const Pairing& p = kv.second;
+            Score s = score(p.games, p.winsA + 0.5 * p.draws);
+            out<<"    {\"a\": "<<jsonString(entrants[p.a].name)<<", \"b\": "<<jsonString(entrants[p.b].name)<<", \"games\": "<<p.games
+               <<", \"wins_a\": "<<p.winsA<<", \"draws\": "<<p.draws<<", \"wins_b\": "<<p.winsB<<", \"score_a\": "<<s.mean
+               <<", \"score_a_low\": "<<s.low<<", \"score_a_high\": "<<s.high<<"}"<<(++k < pairings.size() ? "," : "")<<"\n";
+        }
+        out<<"  ]\n}\n";
+        if(!out){
+            cerr<<"Failed to write "<<jsonPath<<endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
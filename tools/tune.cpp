@@ -0,0 +1,299 @@
+// tetris-tune: evolves the Bot's evaluation weights.
+//
+//   tetris-tune [--population n] [--generations n] [--games n] [--pieces n]
+//               [--threads n] [--seed s] [--two-ply] [--checkpoint file]
+//
+// A genetic algorithm over BotWeights. Every generation each candidate
+// plays the same seeded games, a fresh set per generation, straight on row
+// bitboards: the Bot places each piece where it chooses, with no ticks in
+// between, for at most --pieces pieces or until it tops out. Its fitness
+// is the lines it cleared. The games are shared out over all cores.
+//
+// Only the weights' directions matter, as scaling them all by the same
+// positive factor keeps every choice the same, so candidates are kept as
+// unit vectors. The best 70% go on to the next generation unchanged; the
+// rest are replaced with children of two parents picked by tournament,
+// their fitness weighted average, now and then mutated in one weight.
+//
+// With --checkpoint the population is written to the file after every
+// generation and read back from it on start, seed and all, so a stopped
+// run picks up where it left off and goes on as if it never stopped. The
+// file also holds --games, --pieces and --two-ply, which make up the
+// fitness, and a run given other values refuses to resume it.
+//
+// The weights found can be tried with tetris-autoplay --weights.
+
+#include "Bot.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+const int NUM_WEIGHTS = 4;
+const char CHECKPOINT_MAGIC[] = "tetris-tune 2";
+
+struct Candidate {
+    float w[NUM_WEIGHTS];
+    long long fitness = 0;
+
+    BotWeights weights() const {
+        BotWeights b;
+        b.height = w[0];
+        b.lines = w[1];
+        b.holes = w[2];
+        b.bumpiness = w[3];
+        return b;
+    }
+
+    void normalize() {
+        float len = 0;
+        for(float v: w) len += v * v;
+        len = sqrt(len);
+        if(len == 0) return;
+        for(float& v: w) v /= len;
+    }
+};
+
+struct Tuner {
+    unsigned int seed = 1;      // of the games
+    int generation = 0;
+    unsigned int rng = 1;
+    vector<Candidate> population;
+    // what fitness is measured on
+    int games = 0;
+    long long maxPieces = 0;
+    bool lookahead = false;
+
+    unsigned int random() {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+    }
+    // uniform in [-1, 1]
+    float uniform() { return random() / 2147483647.5f - 1.0f; }
+};
+
+// the piece sequence of a game, the same for every candidate
+static unsigned int gameSeed(unsigned int seed, int generation, int game) {
+    unsigned int h = seed * 2654435761u ^ (generation + 1) * 2246822519u ^ (game + 1) * 3266489917u;
+    h ^= h >> 15;
+    h *= 668265263u;
+    h ^= h >> 13;
+    return h ? h : 1;
+}
+
+// lines cleared placing up to maxPieces pieces
+static long long playGame(Bot& bot, unsigned int rng, long long maxPieces, bool lookahead, long long& pieces) {
+    auto random = [&rng](){
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+    };
+    const PieceTable& t = pieceTable();
+    BoardRows rows = {};
+    long long lines = 0;
+    int shape = random() % NUM_SHAPES;
+    int next = random() % NUM_SHAPES;
+    for(pieces=0; pieces<maxPieces; pieces++){
+        Placement p;
+        if(!bot.choose(rows, shape, 0, SPAWN_X, SPAWN_Y, lookahead ? next : -1, p)) break;
+        lines += t.lock(rows, shape, p.orient, p.x, p.y);
+        shape = next;
+        next = random() % NUM_SHAPES;
+    }
+    return lines;
+}
+
+static bool saveCheckpoint(const string& path, const Tuner& tuner) {
+    string temp = path + ".tmp";
+    FILE* fp = fopen(temp.c_str(), "w");
+    if(fp == NULL) return false;
+    fprintf(fp, "%s\nseed %u\ngeneration %d\nrng %u\ngames %d\npieces %lld\ntwo-ply %d\npopulation %zu\n",
+            CHECKPOINT_MAGIC, tuner.seed, tuner.generation, tuner.rng, tuner.games, tuner.maxPieces,
+            (int)tuner.lookahead, tuner.population.size());
+    for(const Candidate& c: tuner.population){
+        for(float v: c.w) fprintf(fp, "%.9g ", v);
+        fprintf(fp, "%lld\n", c.fitness);
+    }
+    // written in full before it replaces the last one
+    if(fclose(fp) != 0) return false;
+    return rename(temp.c_str(), path.c_str()) == 0;
+}
+
+static bool loadCheckpoint(const string& path, Tuner& tuner) {
+    FILE* fp = fopen(path.c_str(), "r");
+    if(fp == NULL) return false;
+    char magic[32] = {};
+    size_t size = 0;
+    int lookahead = 0;
+    bool ok = fgets(magic, sizeof(magic), fp) != NULL && strncmp(magic, CHECKPOINT_MAGIC, strlen(CHECKPOINT_MAGIC)) == 0
+              && fscanf(fp, " seed %u generation %d rng %u games %d pieces %lld two-ply %d population %zu",
+                        &tuner.seed, &tuner.generation, &tuner.rng, &tuner.games, &tuner.maxPieces, &lookahead,
+                        &size) == 7
+              && size > 0 && tuner.rng != 0;
+    tuner.lookahead = lookahead != 0;
+    tuner.population.assign(ok ? size : 0, Candidate());
+    for(size_t i=0; ok && i<size; i++){
+        Candidate& c = tuner.population[i];
+        ok = fscanf(fp, "%f %f %f %f %lld", &c.w[0], &c.w[1], &c.w[2], &c.w[3], &c.fitness) == 5;
+    }
+    fclose(fp);
+    return ok;
+}
+
+// replaces the worst with children of the best
+static void breed(Tuner& tuner) {
+    vector<Candidate>& pop = tuner.population;
+    int size = pop.size();
+    stable_sort(pop.begin(), pop.end(), [](const Candidate& a, const Candidate& b){ return a.fitness > b.fitness; });
+    int children = size * 3 / 10;
+    int tournament = max(2, size / 10);
+    vector<Candidate> born;
+    for(int k=0; k<children; k++){
+        // the best two of a random handful; the population is sorted, so
+        // the lowest indices drawn
+        int first = size, second = size;
+        for(int i=0; i<tournament; i++){
+            int pick = tuner.random() % size;
+            if(pick < first){
+                second = first;
+                first = pick;
+            }
+            else if(pick < second && pick != first) second = pick;
+        }
+        if(second == size) second = first;
+        const Candidate& a = pop[first];
+        const Candidate& b = pop[second];
+        double fa = a.fitness, fb = b.fitness;
+        if(fa + fb == 0) fa = fb = 1;
+        Candidate child;
+        for(int i=0; i<NUM_WEIGHTS; i++) child.w[i] = (a.w[i] * fa + b.w[i] * fb) / (fa + fb);
+        if(tuner.random() % 100 < 5) child.w[tuner.random() % NUM_WEIGHTS] += 0.2f * tuner.uniform();
+        child.normalize();
+        born.push_back(child);
+    }
+    copy(born.begin(), born.end(), pop.end() - children);
+}
+
+static int usage(const char* name) {
+    cerr<<"Usage: "<<name<<" [--population n] [--generations n] [--games n] [--pieces n]"
+        <<" [--threads n] [--seed s] [--two-ply] [--checkpoint file]"<<endl;
+    return EXIT_FAILURE;
+}
+
+int main(int argc, char **argv) {
+    int populationSize = 50;
+    int generations = 10;
+    int games = 8;
+    long long maxPieces = 1000;
+    int threads = thread::hardware_concurrency();
+    unsigned int seed = 1;
+    bool lookahead = false;
+    string checkpoint;
+    for(int i=1; i<argc; i++){
+        if(strcmp(argv[i], "--population") == 0 && i+1 < argc) populationSize = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--generations") == 0 && i+1 < argc) generations = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--games") == 0 && i+1 < argc) games = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--pieces") == 0 && i+1 < argc) maxPieces = atoll(argv[++i]);
+        else if(strcmp(argv[i], "--threads") == 0 && i+1 < argc) threads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0 && i+1 < argc) seed = strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "--two-ply") == 0) lookahead = true;
+        else if(strcmp(argv[i], "--checkpoint") == 0 && i+1 < argc) checkpoint = argv[++i];
+        else return usage(argv[0]);
+    }
+    if(populationSize < 2 || generations < 1 || games < 1 || maxPieces < 1) return usage(argv[0]);
+    threads = max(1, threads);
+
+    Tuner tuner;
+    if(!checkpoint.empty() && loadCheckpoint(checkpoint, tuner)){
+        // other games would be a different fitness, not a continuation
+        if(tuner.games != games || tuner.maxPieces != maxPieces || tuner.lookahead != lookahead){
+            cerr<<checkpoint<<" was made with --games "<<tuner.games<<" --pieces "<<tuner.maxPieces
+                <<(tuner.lookahead ? " --two-ply" : "")<<"; resume it with the same"<<endl;
+            return EXIT_FAILURE;
+        }
+        cout<<"resuming "<<checkpoint<<" at generation "<<tuner.generation<<", "<<tuner.population.size()
+            <<" candidates"<<endl;
+    }
+    else {
+        tuner.seed = seed;
+        tuner.rng = seed ? seed : 1;
+        tuner.games = games;
+        tuner.maxPieces = maxPieces;
+        tuner.lookahead = lookahead;
+        tuner.population.resize(populationSize);
+        for(Candidate& c: tuner.population){
+            for(float& v: c.w) v = tuner.uniform();
+            c.normalize();
+        }
+    }
+
+    vector<Bot*> bots;
+    for(int t=0; t<threads; t++) bots.push_back(new Bot());
+    const int size = tuner.population.size();
+    const int stop = tuner.generation + generations;
+    long long totalGames = 0;
+    double totalSecs = 0;
+    for(; tuner.generation<stop; tuner.generation++){
+        vector<long long> lines(size * games), pieces(size * games);
+        atomic<int> next(0);
+        auto work = [&](int thread){
+            Bot& bot = *bots[thread];
+            for(int job=next++; job<size*games; job=next++){
+                int c = job / games, g = job % games;
+                bot.setWeights(tuner.population[c].weights());
+                lines[job] = playGame(bot, gameSeed(tuner.seed, tuner.generation, g), maxPieces, lookahead, pieces[job]);
+            }
+        };
+
+        auto start = chrono::steady_clock::now();
+        vector<thread> workers;
+        for(int t=1; t<threads; t++) workers.emplace_back(work, t);
+        work(0);
+        for(auto& t: workers) t.join();
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        totalGames += size * games;
+        totalSecs += secs;
+
+        long long allPieces = 0, sum = 0;
+        for(int c=0; c<size; c++){
+            Candidate& cand = tuner.population[c];
+            cand.fitness = 0;
+            for(int g=0; g<games; g++){
+                cand.fitness += lines[c * games + g];
+                allPieces += pieces[c * games + g];
+            }
+            sum += cand.fitness;
+        }
+        const Candidate& best = *max_element(tuner.population.begin(), tuner.population.end(),
+                                             [](const Candidate& a, const Candidate& b){ return a.fitness < b.fitness; });
+        printf("generation %d: best %.1f lines/game, mean %.1f, %.0f games/s, %.0f pieces/s\n"
+               "  best weights %.6f,%.6f,%.6f,%.6f (height, lines, holes, bumpiness)\n",
+               tuner.generation, (double)best.fitness / games, (double)sum / size / games,
+               size * games / max(secs, 1e-9), allPieces / max(secs, 1e-9),
+               best.w[0], best.w[1], best.w[2], best.w[3]);
+        fflush(stdout);
+
+        breed(tuner);
+        Tuner saved = tuner;
+        saved.generation++;
+        if(!checkpoint.empty() && !saveCheckpoint(checkpoint, saved)) cerr<<"Failed to write "<<checkpoint<<endl;
+    }
+    for(Bot* b: bots) delete b;
+
+    printf("%lld games in %.1f s on %d threads: %.0f games/s\n", totalGames, totalSecs, threads,
+           totalGames / max(totalSecs, 1e-9));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+// tetris-versus: plays a versus match between two random input bots, each
+// with its own rollback session, over real UDP sockets on 127.0.0.1, and
+// checks both sides end up with the same match.
+//
+//   tetris-versus [--frames n] [--fps f] [--delay ms] [--loss percent]
+//                 [--port p] [--seed s]
+//
+// Reports rollbacks, how many frames they resimulated and how long that
+// took, next to the frame budget.
+
+#include "Game.h"
+#include "Versus.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+void printStats(int side, const VersusStats& s) {
+    cout<<"side "<<side<<": "<<s.frames<<" frames, "<<s.stalls<<" stalled, "
+        <<s.rollbacks<<" rollbacks resimulating "<<s.resimulated<<" frames (max "<<s.maxRollback<<")\n";
+    if(s.rollbacks > 0){
+        cout<<"  rollback time "<<s.rollbackUs / s.rollbacks<<" us average, "<<s.maxRollbackUs<<" us max\n";
+    }
+    cout<<"  packets "<<s.packetsSent<<" sent, "<<s.packetsDropped<<" dropped, "<<s.packetsReceived<<" received\n";
+}
+
+bool sameMatch(const VersusMatch& a, const VersusMatch& b) {
+    vector<unsigned char> sa, sb;
+    for(int i=0; i<2; i++){
+        a.players[i].writeState(sa);
+        b.players[i].writeState(sb);
+    }
+    return sa == sb && a.pendingGarbage[0] == b.pendingGarbage[0] &&
+        a.pendingGarbage[1] == b.pendingGarbage[1] && a.rng == b.rng && a.frame == b.frame;
+}
+
+int main(int argc, char **argv) {
+    long long frames = 600;
+    double fps = 60, delay = 50, loss = 5;
+    int port = 47100;
+    unsigned int seed = 1;
+    for(int i=1; i<argc; i++){
+        if(strcmp(argv[i], "--frames") == 0 && i+1 < argc) frames = atoll(argv[++i]);
+        else if(strcmp(argv[i], "--fps") == 0 && i+1 < argc) fps = atof(argv[++i]);
+        else if(strcmp(argv[i], "--delay") == 0 && i+1 < argc) delay = atof(argv[++i]);
+        else if(strcmp(argv[i], "--loss") == 0 && i+1 < argc) loss = atof(argv[++i]);
+        else if(strcmp(argv[i], "--port") == 0 && i+1 < argc) port = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0 && i+1 < argc) seed = strtoul(argv[++i], nullptr, 10);
+        else {
+            cerr<<"Usage: "<<argv[0]<<" [--frames n] [--fps f] [--delay ms] [--loss percent] [--port p] [--seed s]"<<endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if(fps <= 0) fps = 60;
+
+    VersusLink links[2];
+    for(int i=0; i<2; i++){
+        if(!links[i].open(port + i, port + 1 - i, delay, loss, seed + i + 1)){
+            cerr<<"Failed to bind 127.0.0.1:"<<port + i<<endl;
+            return EXIT_FAILURE;
+        }
+    }
+    // sessions are large (they keep VERSUS_HISTORY matches), keep them off the stack
+    vector<RollbackSession> sessions(2);
+    sessions[0].start(0, seed);
+    sessions[1].start(1, 0);
+
+    unsigned int rng = seed ? seed : 1;
+    auto next = [&rng]{
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+    };
+
+    const auto frameTime = chrono::duration_cast<chrono::steady_clock::duration>(
+        chrono::duration<double>(1.0 / fps));
+    auto nextFrame = chrono::steady_clock::now();
+    auto deadline = nextFrame + frameTime * (frames + 2 * VERSUS_MAX_ROLLBACK) +
+        chrono::milliseconds((long long)(4 * delay) + 5000);
+
+    while(sessions[0].frame() < frames || sessions[1].frame() < frames ||
+          !sessions[0].confirmed() || !sessions[1].confirmed()){
+        if(chrono::steady_clock::now() > deadline){
+            cerr<<"Peers did not catch up with each other"<<endl;
+            return EXIT_FAILURE;
+        }
+        for(int i=0; i<2; i++){
+            if(sessions[i].frame() < frames){
+                // a few key presses a second, roughly what a person manages
+                unsigned int r = next() % 32;
+                if(r < 5) sessions[i].localInput(Input(r));
+                sessions[i].advance(links[i]);
+            }
+            else sessions[i].send(links[i]);
+        }
+        nextFrame += frameTime;
+        while(chrono::steady_clock::now() < nextFrame){
+            for(int i=0; i<2; i++) sessions[i].poll(links[i]);
+            this_thread::sleep_for(chrono::microseconds(200));
+        }
+    }
+
+    for(int i=0; i<2; i++) printStats(i, sessions[i].stats());
+    cout<<"frame budget "<<1e6 / fps<<" us\n";
+
+    const VersusMatch& m = sessions[0].match();
+    cout<<"match: ";
+    if(!m.isOver()) cout<<"still running";
+    else if(m.winner() < 0) cout<<"draw";
+    else cout<<"side "<<m.winner()<<" won";
+    cout<<" after "<<m.frame<<" frames, lines "<<m.players[0].linesCleared()<<" / "<<m.players[1].linesCleared()<<"\n";
+
+    if(!sameMatch(sessions[0].match(), sessions[1].match())){
+        cout<<"DESYNC: the two sides disagree on the match state"<<endl;
+        return EXIT_FAILURE;
+    }
+    cout<<"both sides in sync"<<endl;
+    return EXIT_SUCCESS;
+}
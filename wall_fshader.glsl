@@ -0,0 +1,25 @@
+#version 140
+
+// Texel (row, board) of boards holds the row's settled cells and its
+// cells with the falling piece, a bit per column.
+
+uniform usampler2D boards;
+uniform vec3 palette[6];
+uniform vec3 emptyColor;
+
+flat in int board;
+in vec2 cell;
+
+out vec4 fColor;
+
+void
+main()
+{
+    ivec2 c = ivec2(cell);
+    uvec2 row = texelFetch(boards, ivec2(c.y, board), 0).rg;
+    uint bit = 1u << uint(c.x);
+    vec3 color = palette[board % 6];
+    if((row.r & bit) != 0u) fColor = vec4(color, 1.0);
+    else if((row.g & bit) != 0u) fColor = vec4(mix(color, vec3(1.0), 0.6), 1.0);
+    else fColor = vec4(emptyColor, 1.0);
+}
@@ -0,0 +1,25 @@
+#version 140
+
+// One instance per board: the unit quad is moved to the board's tile in
+// the wall, and the fragment shader gets the cell under each pixel.
+
+in vec2 vCorner;
+
+uniform int columns;        // tiles across
+uniform vec2 origin;        // top left of the wall
+uniform vec2 tileSize;      // a tile, board plus margin
+uniform vec2 boardSize;     // the board in it
+uniform vec2 cellCount;     // columns and rows of a board
+
+flat out int board;
+out vec2 cell;
+
+void
+main()
+{
+    vec2 tile = vec2(gl_InstanceID % columns, gl_InstanceID / columns);
+    vec2 corner = origin + vec2(tile.x, -tile.y - 1.0) * tileSize + (tileSize - boardSize) * 0.5;
+    gl_Position = vec4(corner + vCorner * boardSize, 0.0, 1.0);
+    board = gl_InstanceID;
+    cell = vCorner * cellCount;
+}